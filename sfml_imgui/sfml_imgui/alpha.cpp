@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "alpha.h"
+#include "parallel.h"
+#include "perf_counters.h"
+#include <array>
+
+namespace {
+    // Exact round(c * a / 255) without a division
+    inline std::uint8_t MulDiv255(unsigned int c, unsigned int a)
+    {
+        unsigned int t = c * a + 128;
+        return static_cast<std::uint8_t>((t + (t >> 8)) >> 8);
+    }
+
+    // Fixed-point reciprocals (16.16) so unpremultiplying is a multiply per channel
+    const std::array<std::uint32_t, 256>& ReciprocalTable()
+    {
+        static const std::array<std::uint32_t, 256> table = [] {
+            std::array<std::uint32_t, 256> t{};
+            for (unsigned int a = 1; a < 256; ++a) t[a] = (255u * 65536u + a / 2) / a;
+            return t;
+        }();
+        return table;
+    }
+}
+
+sf::Image PremultiplyAlpha(const sf::Image& src)
+{
+    sf::Vector2u size = src.getSize();
+    size_t totalPixels = static_cast<size_t>(size.x) * size.y;
+    if (totalPixels == 0) return src;
+
+    std::vector<std::uint8_t> pixels(totalPixels * 4);
+    const std::uint8_t* pSrc = src.getPixelsPtr();
+    std::uint8_t* pDst = pixels.data();
+
+    ParallelFor(size.y, [&](unsigned int rowBegin, unsigned int rowEnd) {
+        KernelCounterScope counters("premultiply", static_cast<std::uint64_t>(rowEnd - rowBegin) * size.x);
+        size_t begin = static_cast<size_t>(rowBegin) * size.x * 4;
+        size_t end = static_cast<size_t>(rowEnd) * size.x * 4;
+        for (size_t i = begin; i < end; i += 4) {
+            unsigned int a = pSrc[i + 3];
+            pDst[i] = MulDiv255(pSrc[i], a);
+            pDst[i + 1] = MulDiv255(pSrc[i + 1], a);
+            pDst[i + 2] = MulDiv255(pSrc[i + 2], a);
+            pDst[i + 3] = static_cast<std::uint8_t>(a);
+        }
+    }, 16);
+
+    return sf::Image(size, pixels.data());
+}
+
+void UnpremultiplyAlpha(std::uint8_t* rgba, size_t totalPixels)
+{
+    const auto& recip = ReciprocalTable();
+    for (size_t i = 0; i < totalPixels * 4; i += 4) {
+        unsigned int a = rgba[i + 3];
+        if (a == 255) continue;
+        if (a == 0) { rgba[i] = rgba[i + 1] = rgba[i + 2] = 0; continue; }
+        std::uint32_t r = recip[a];
+        for (int c = 0; c < 3; ++c) {
+            std::uint32_t v = (rgba[i + c] * r + 32768) >> 16;
+            rgba[i + c] = static_cast<std::uint8_t>(v > 255 ? 255 : v);
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef ALPHA_H
+#define ALPHA_H
+
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+// Returns a copy of 'src' with RGB multiplied by alpha. Inputs are converted once at
+// load time when the alpha-preserving pipeline is enabled; afterwards every draw and
+// every CPU kernel works on premultiplied data.
+sf::Image PremultiplyAlpha(const sf::Image& src);
+
+// Converts premultiplied RGBA8 back to straight alpha in place (fully transparent pixels become 0,0,0,0)
+void UnpremultiplyAlpha(std::uint8_t* rgba, size_t totalPixels);
+
+#endif //ALPHA_H
@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "async_jobs.h"
+#include "transitions.h"
+#include "render_graph.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    // CPU stages on the pool, then the upload on 'gui'
+    Task<bool> PrepareFromSource(PreparedInput& input, LoadedImage source, bool premultiply,
+        TaskQueue& gui, CancellationToken token)
+    {
+        co_await ResumeOn(SharedWorkerPool());
+        InputStages stages;
+        bool ok = !token.IsCancelled() && ComputeInputStages(*source.image, source.key, premultiply, stages);
+
+        co_await ResumeOn(gui);
+        // Checked again here: cancellation on the GUI thread is ordered with this step
+        if (!ok || token.IsCancelled()) co_return false;
+        input.source = source.image;
+        input.sourceKey = source.key;
+        co_return ApplyInputStages(input, stages);
+    }
+}
+
+Task<LoadedImage> LoadImageAsync(fs::path path, CancellationToken token)
+{
+    co_await ResumeOn(SharedWorkerPool());
+    LoadedImage loaded;
+    if (!token.IsCancelled()) loaded.image = DecodeInputSource(path, loaded.key);
+    co_return loaded;
+}
+
+Task<bool> PrepareInputAsync(PreparedInput& input, TaskQueue& gui, CancellationToken token)
+{
+    if (!input.source) co_return false;
+    if (input.sourceKey == 0) input.sourceKey = HashImage(*input.source);
+    LoadedImage current{ input.source, input.sourceKey };
+    co_return co_await PrepareFromSource(input, std::move(current), premultipliedPipeline, gui, token);
+}
+
+Task<bool> LoadInputAsync(PreparedInput& input, fs::path path, TaskQueue& gui, CancellationToken token)
+{
+    bool premultiply = premultipliedPipeline;
+    LoadedImage loaded = co_await LoadImageAsync(std::move(path), token);
+    if (!loaded.image) {
+        co_await ResumeOn(gui);
+        co_return false;
+    }
+    co_return co_await PrepareFromSource(input, std::move(loaded), premultiply, gui, token);
+}
+
+Task<ExportResult> ExportRangeAsync(PreparedInput& in1, PreparedInput& in2, SequenceSettings settings,
+    fs::path folder, FrameCallback onFrame, CancellationToken token)
+{
+    bool premultiply = premultipliedPipeline;
+    bool dither = blueNoiseDither;
+    bool deterministic = deterministicRendering;
+    co_await ResumeOn(SharedWorkerPool());
+    premultipliedPipeline = premultiply;
+    blueNoiseDither = dither;
+    deterministicRendering = deterministic;
+
+    ExportResult result;
+    result.frames = ExportSequence(in1, in2, settings, folder, [&](int frame, int total) {
+        if (token.IsCancelled()) return false;
+        return !onFrame || onFrame(frame, total);
+    }, &result.error);
+    result.cancelled = token.IsCancelled();
+    co_return result;
+}
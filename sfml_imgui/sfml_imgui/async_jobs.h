@@ -0,0 +1,48 @@
+#ifndef ASYNC_JOBS_H
+#define ASYNC_JOBS_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "async_task.h"
+#include "worker_pool.h"
+#include "prepared_input.h"
+#include "sequence_export.h"
+
+// --- ASYNC STAGES ---
+// Awaitable versions of loading, preparing and exporting. CPU work runs on
+// SharedWorkerPool(); anything that touches a PreparedInput's texture or fields is posted
+// to 'gui', the queue of the thread that draws the inputs, so a PreparedInput only ever
+// changes on that thread. Inputs passed by reference must outlive the task.
+// The render switches (premultipliedPipeline, blueNoiseDither) are taken from the thread
+// that starts a task and carried over to the pool thread that runs it.
+
+struct LoadedImage {
+    std::shared_ptr<const sf::Image> image;   // nullptr: failed or cancelled
+    std::uint64_t key = 0;                    // Render graph content key
+};
+
+// Decodes on the pool (memoized like LoadInput). Resumes the awaiter on a pool thread.
+Task<LoadedImage> LoadImageAsync(std::filesystem::path path, CancellationToken token);
+
+// Re-derives 'input' from its current source with the caller's alpha mode.
+// Resumes the awaiter on 'gui'. A token cancelled before then leaves 'input' untouched.
+Task<bool> PrepareInputAsync(PreparedInput& input, TaskQueue& gui, CancellationToken token);
+
+// LoadImageAsync followed by the prepare stages. Resumes the awaiter on 'gui';
+// 'input' is untouched on failure or cancellation.
+Task<bool> LoadInputAsync(PreparedInput& input, std::filesystem::path path, TaskQueue& gui, CancellationToken token);
+
+struct ExportResult {
+    int frames = 0;
+    bool cancelled = false;
+    std::string error;
+};
+
+// ExportSequence on a pool thread; cancelling stops it after the frame in progress.
+// 'onFrame' is called on that thread. Resumes the awaiter on the pool thread, and the
+// inputs must not change until then.
+Task<ExportResult> ExportRangeAsync(PreparedInput& in1, PreparedInput& in2, SequenceSettings settings,
+    std::filesystem::path folder, FrameCallback onFrame, CancellationToken token);
+
+#endif //ASYNC_JOBS_H
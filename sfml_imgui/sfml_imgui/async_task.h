@@ -0,0 +1,171 @@
+#ifndef ASYNC_TASK_H
+#define ASYNC_TASK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// --- ASYNC TASKS ---
+// Coroutine tasks for chaining slow stages (decode, prepare, export) without parking a
+// thread on each wait:
+//
+//   Task<bool> Reload(PreparedInput& in, std::filesystem::path path, TaskQueue& gui) {
+//       co_return co_await LoadInputAsync(in, path, gui, CancellationToken());
+//   }
+//
+// A Task does nothing until it is awaited, or handed to Spawn / SyncWait. When it finishes
+// it resumes its awaiter directly, on whichever thread it finished on; stages move between
+// threads explicitly with co_await ResumeOn(executor). The project doesn't use exceptions,
+// so one escaping a task terminates; failures travel in the result type.
+
+// Shared flag; all copies observe the same state. Long stages poll it between units of work.
+class CancellationToken {
+public:
+    CancellationToken() : state(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() const { state->store(true); }
+    bool IsCancelled() const { return state->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> state;
+};
+
+namespace detail {
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> done) noexcept
+        {
+            std::coroutine_handle<> next = done.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    template <typename T> struct ResultStore {
+        std::optional<T> value;
+        void return_value(T v) { value = std::move(v); }
+        T Take() { return std::move(*value); }
+    };
+
+    template <> struct ResultStore<void> {
+        void return_void() {}
+        void Take() {}
+    };
+
+    // Fire-and-forget coroutine frame that frees itself when done
+    struct DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+}
+
+template <typename T = void>
+class Task {
+public:
+    struct promise_type : detail::PromiseBase, detail::ResultStore<T> {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { if (handle) handle.destroy(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;   // Start the body right away on this thread
+            }
+            T await_resume() { return handle.promise().Take(); }
+        };
+        return Awaiter{ handle };
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Suspends the awaiting coroutine and resumes it from 'executor', which is anything with
+// Post(std::function<void()>): the shared WorkerPool, or a TaskQueue drained by the GUI thread.
+template <typename Executor>
+auto ResumeOn(Executor& executor)
+{
+    struct Awaiter {
+        Executor& executor;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { executor.Post([h] { h.resume(); }); }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{ executor };
+}
+
+// Starts 'task' on the calling thread and lets it run to completion on its own;
+// the result is dropped, so the task reports through its own side effects
+template <typename T>
+void Spawn(Task<T> task)
+{
+    [](Task<T> t) -> detail::DetachedTask { co_await std::move(t); }(std::move(task));
+}
+
+// Blocks the calling thread until 'task' is done. Only for entry points that have no
+// event loop (command-line modes); never call it from a pool thread the task needs.
+template <typename T>
+T SyncWait(Task<T> task)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    detail::ResultStore<T> result;
+
+    auto signal = [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_one();
+    };
+    [](Task<T> t, detail::ResultStore<T>& out, decltype(signal)& finish) -> detail::DetachedTask {
+        if constexpr (std::is_void_v<T>) co_await std::move(t);
+        else out.return_value(co_await std::move(t));
+        finish();
+    }(std::move(task), result, signal);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return done; });
+    return result.Take();
+}
+
+#endif //ASYNC_TASK_H
@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "child_process.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#include <climits>
+#endif
+
+namespace {
+#ifdef _WIN32
+    // CommandLineToArgvW rules: quotes around every argument, backslashes doubled
+    // only when they precede a quote
+    void AppendQuoted(std::string& cmd, const std::string& arg)
+    {
+        if (!cmd.empty()) cmd += ' ';
+        cmd += '"';
+        size_t slashes = 0;
+        for (char c : arg) {
+            if (c == '\\') { ++slashes; continue; }
+            if (c == '"') cmd.append(slashes * 2 + 1, '\\');
+            else cmd.append(slashes, '\\');
+            slashes = 0;
+            cmd += c;
+        }
+        cmd.append(slashes * 2, '\\');
+        cmd += '"';
+    }
+
+    HANDLE ToHandle(std::intptr_t h) { return reinterpret_cast<HANDLE>(h); }
+#endif
+}
+
+ChildProcess::~ChildProcess()
+{
+    if (running) {
+        Kill();
+        Wait();
+    }
+    ClosePipe();
+}
+
+void ChildProcess::ClosePipe()
+{
+    if (readPipe == -1) return;
+#ifdef _WIN32
+    CloseHandle(ToHandle(readPipe));
+#else
+    ::close(static_cast<int>(readPipe));
+#endif
+    readPipe = -1;
+}
+
+bool ChildProcess::Start(const std::string& program, const std::vector<std::string>& args)
+{
+    if (running) return false;
+    ClosePipe();
+    readBuffer.clear();
+
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    HANDLE readEnd = nullptr, writeEnd = nullptr;
+    if (!CreatePipe(&readEnd, &writeEnd, &sa, 0)) return false;
+    // Shards start concurrently. The write end has to be inheritable, so the handle list
+    // below limits the child to its own pipe: a worker holding another worker's write end
+    // would keep that pipe open after its owner crashed, and its EOF would never arrive.
+    SetHandleInformation(writeEnd, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+
+    std::string cmd;
+    AppendQuoted(cmd, program);
+    for (const std::string& a : args) AppendQuoted(cmd, a);
+
+    STARTUPINFOEXA si = {};
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.StartupInfo.hStdOutput = writeEnd;
+    si.StartupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    // Every listed handle has to be inheritable and listed once
+    std::vector<HANDLE> inherit = { writeEnd };
+    for (HANDLE h : { si.StartupInfo.hStdInput, si.StartupInfo.hStdError }) {
+        DWORD flags = 0;
+        if (h && h != INVALID_HANDLE_VALUE && GetHandleInformation(h, &flags) && (flags & HANDLE_FLAG_INHERIT) &&
+            std::find(inherit.begin(), inherit.end(), h) == inherit.end())
+            inherit.push_back(h);
+    }
+    SIZE_T attributeBytes = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeBytes);
+    std::vector<std::uint8_t> attributeMemory(attributeBytes);
+    auto* attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeMemory.data());
+    BOOL ok = InitializeProcThreadAttributeList(attributes, 1, 0, &attributeBytes);
+    if (ok) {
+        si.lpAttributeList = attributes;
+        PROCESS_INFORMATION pi = {};
+        ok = UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherit.data(),
+                inherit.size() * sizeof(HANDLE), nullptr, nullptr) &&
+            CreateProcessA(program.c_str(), cmd.data(), nullptr, nullptr, TRUE, EXTENDED_STARTUPINFO_PRESENT,
+                nullptr, nullptr, &si.StartupInfo, &pi);
+        DeleteProcThreadAttributeList(attributes);
+        if (ok) {
+            CloseHandle(pi.hThread);
+            process = reinterpret_cast<std::intptr_t>(pi.hProcess);
+        }
+    }
+    CloseHandle(writeEnd);
+    if (!ok) {
+        CloseHandle(readEnd);
+        return false;
+    }
+    readPipe = reinterpret_cast<std::intptr_t>(readEnd);
+#else
+    // Close-on-exec, so workers started concurrently do not inherit each other's pipes;
+    // dup2 clears the flag on the child's stdout
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) return false;
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (const std::string& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        if (fds[1] == STDOUT_FILENO) ::fcntl(fds[1], F_SETFD, 0);
+        else ::dup2(fds[1], STDOUT_FILENO);
+        ::execv(program.c_str(), argv.data());
+        ::_exit(127);
+    }
+    ::close(fds[1]);
+    process = pid;
+    readPipe = fds[0];
+#endif
+    running = true;
+    return true;
+}
+
+bool ChildProcess::ReadLine(std::string& line)
+{
+    for (;;) {
+        size_t nl = readBuffer.find('\n');
+        if (nl != std::string::npos) {
+            line = readBuffer.substr(0, nl);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            readBuffer.erase(0, nl + 1);
+            return true;
+        }
+        if (readPipe == -1) return false;
+
+        char chunk[4096];
+#ifdef _WIN32
+        DWORD n = 0;
+        if (!ReadFile(ToHandle(readPipe), chunk, sizeof(chunk), &n, nullptr) || n == 0) {
+            ClosePipe();
+            return false;
+        }
+#else
+        ssize_t n = ::read(static_cast<int>(readPipe), chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ClosePipe();
+            return false;
+        }
+#endif
+        readBuffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+int ChildProcess::Wait()
+{
+    if (!running) return -1;
+    running = false;
+#ifdef _WIN32
+    HANDLE h = ToHandle(process);
+    WaitForSingleObject(h, INFINITE);
+    DWORD code = 1;
+    GetExitCodeProcess(h, &code);
+    CloseHandle(h);
+    process = -1;
+    return static_cast<int>(code);
+#else
+    int status = 0;
+    while (::waitpid(static_cast<pid_t>(process), &status, 0) < 0 && errno == EINTR) {}
+    process = -1;
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+#endif
+}
+
+void ChildProcess::Kill()
+{
+    if (!running) return;
+#ifdef _WIN32
+    TerminateProcess(ToHandle(process), 1);
+#else
+    ::kill(static_cast<pid_t>(process), SIGKILL);
+#endif
+}
+
+std::string CurrentExecutablePath()
+{
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD n = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    return std::string(path, n);
+#else
+    char path[PATH_MAX];
+    ssize_t n = ::readlink("/proc/self/exe", path, sizeof(path) - 1);
+    return n > 0 ? std::string(path, static_cast<size_t>(n)) : std::string();
+#endif
+}
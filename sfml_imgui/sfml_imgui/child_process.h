@@ -0,0 +1,40 @@
+#ifndef CHILD_PROCESS_H
+#define CHILD_PROCESS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Child process whose stdout is captured through a pipe; stdin and stderr are inherited.
+// Used by the shard coordinator to drive worker instances of this executable.
+// Not copyable; a child still running on destruction is killed.
+class ChildProcess {
+public:
+    ChildProcess() = default;
+    ~ChildProcess();
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // Starts 'program' with 'args' (not including the program itself)
+    bool Start(const std::string& program, const std::vector<std::string>& args);
+    // Reads up to the next '\n' of the child's stdout. Returns false at EOF.
+    bool ReadLine(std::string& line);
+    // Waits for the child to exit and returns its exit code (-1 if it never started)
+    int Wait();
+    void Kill();
+
+    bool IsRunning() const { return running; }
+
+private:
+    std::intptr_t process = -1;   // HANDLE on Windows, pid elsewhere
+    std::intptr_t readPipe = -1;
+    std::string readBuffer;
+    bool running = false;
+
+    void ClosePipe();
+};
+
+// Full path of the running executable, used to spawn copies of ourselves
+std::string CurrentExecutablePath();
+
+#endif //CHILD_PROCESS_H
@@ -0,0 +1,315 @@
+#include "pch.h"
+#include "clip_source.h"
+#include "transitions.h"
+#include "alpha.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // --- Y4M ---
+    // Planar 8-bit YUV as written by ffmpeg/x264 tools: one text header line, then
+    // "FRAME[ params]\n" followed by the Y, U, V (and optional alpha) planes per frame.
+    class Y4mDecoder : public ClipDecoder {
+    public:
+        bool Open(const fs::path& path, std::string& error)
+        {
+            file.open(path, std::ios::binary);
+            std::string header;
+            if (!file || !std::getline(file, header) || header.rfind("YUV4MPEG2 ", 0) != 0) {
+                error = "not a Y4M file: " + path.string();
+                return false;
+            }
+
+            std::string chroma = "420jpeg";
+            std::istringstream tokens(header.substr(10));
+            std::string token;
+            while (tokens >> token) {
+                if (token[0] == 'W') width = std::atoi(token.c_str() + 1);
+                else if (token[0] == 'H') height = std::atoi(token.c_str() + 1);
+                else if (token[0] == 'C') chroma = token.substr(1);
+            }
+            if (width <= 0 || height <= 0) { error = "Y4M header has no frame size"; return false; }
+
+            if (chroma == "420" || chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2") { shiftX = 1; shiftY = 1; }
+            else if (chroma == "422") { shiftX = 1; shiftY = 0; }
+            else if (chroma == "444") { shiftX = 0; shiftY = 0; }
+            else if (chroma == "444alpha") { shiftX = 0; shiftY = 0; alpha = true; }
+            else if (chroma == "mono") { mono = true; }
+            else { error = "unsupported Y4M colour space C" + chroma; return false; }
+
+            chromaWidth = mono ? 0 : (width + (1 << shiftX) - 1) >> shiftX;
+            chromaHeight = mono ? 0 : (height + (1 << shiftY) - 1) >> shiftY;
+            size_t lumaBytes = static_cast<size_t>(width) * height;
+            frameBytes = lumaBytes * (alpha ? 2 : 1) + 2 * static_cast<size_t>(chromaWidth) * chromaHeight;
+
+            // Frames without parameters all take the same space, which gives the count
+            std::error_code ec;
+            std::uintmax_t fileSize = fs::file_size(path, ec);
+            std::uintmax_t payload = ec ? 0 : fileSize - header.size() - 1;
+            size_t record = frameBytes + 6;   // "FRAME\n"
+            frameCount = (!ec && payload % record == 0) ? static_cast<int>(payload / record) : -1;
+            return true;
+        }
+
+        int FrameCount() const override { return frameCount; }
+
+        bool Next(sf::Image& frame) override
+        {
+            if (!ReadFrameHeader()) return false;
+            planes.resize(frameBytes);
+            if (!file.read(reinterpret_cast<char*>(planes.data()), static_cast<std::streamsize>(frameBytes))) return false;
+            ConvertToRgba();
+            frame.resize({ static_cast<unsigned int>(width), static_cast<unsigned int>(height) }, rgba.data());
+            return true;
+        }
+
+        bool Skip() override
+        {
+            if (!ReadFrameHeader()) return false;
+            file.seekg(static_cast<std::streamoff>(frameBytes), std::ios::cur);
+            return static_cast<bool>(file);
+        }
+
+    private:
+        bool ReadFrameHeader()
+        {
+            std::string line;
+            return std::getline(file, line) && line.rfind("FRAME", 0) == 0;
+        }
+
+        void ConvertToRgba()
+        {
+            rgba.resize(static_cast<size_t>(width) * height * 4);
+            const std::uint8_t* yPlane = planes.data();
+            const std::uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+            const std::uint8_t* vPlane = uPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+            const std::uint8_t* aPlane = vPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+            ConvertYuvToRgba(yPlane, mono ? nullptr : uPlane, mono ? nullptr : vPlane, alpha ? aPlane : nullptr,
+                width, height, chromaWidth, shiftX, shiftY, rgba.data());
+        }
+
+        std::ifstream file;
+        int width = 0, height = 0;
+        int chromaWidth = 0, chromaHeight = 0;
+        int shiftX = 0, shiftY = 0;
+        bool mono = false, alpha = false;
+        size_t frameBytes = 0;
+        int frameCount = -1;
+        std::vector<std::uint8_t> planes, rgba;
+    };
+
+    // --- IMAGE SEQUENCE ---
+    // "a_####.png" matches a_0001.png, a_0002.png, ... (at least as many digits as '#').
+    // The folder is listed once at open; gaps in the numbering are skipped.
+    class ImageSequenceDecoder : public ClipDecoder {
+    public:
+        bool Open(const fs::path& pattern, std::string& error)
+        {
+            std::string name = pattern.filename().string();
+            size_t hashBegin = name.find('#');
+            size_t hashEnd = name.find_first_not_of('#', hashBegin);
+            if (hashEnd == std::string::npos) hashEnd = name.size();
+            std::string prefix = name.substr(0, hashBegin);
+            std::string suffix = name.substr(hashEnd);
+            size_t digits = hashEnd - hashBegin;
+
+            fs::path folder = pattern.has_parent_path() ? pattern.parent_path() : fs::path(".");
+            std::vector<std::pair<long long, fs::path>> found;
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(folder, ec)) {
+                std::string file = entry.path().filename().string();
+                if (file.size() < prefix.size() + suffix.size() + digits) continue;
+                if (file.compare(0, prefix.size(), prefix) != 0) continue;
+                if (file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+                std::string number = file.substr(prefix.size(), file.size() - prefix.size() - suffix.size());
+                if (number.empty() || number.size() > 18 || number.find_first_not_of("0123456789") != std::string::npos) continue;
+                found.emplace_back(std::stoll(number), entry.path());
+            }
+            if (found.empty()) {
+                error = "no frames match " + pattern.string();
+                return false;
+            }
+            std::sort(found.begin(), found.end());
+            for (auto& f : found) files.push_back(std::move(f.second));
+            return true;
+        }
+
+        int FrameCount() const override { return static_cast<int>(files.size()); }
+
+        bool Next(sf::Image& frame) override
+        {
+            return next < files.size() && frame.loadFromFile(files[next++]);
+        }
+
+        bool Skip() override
+        {
+            if (next >= files.size()) return false;
+            next++;
+            return true;
+        }
+
+    private:
+        std::vector<fs::path> files;
+        size_t next = 0;
+    };
+}
+
+// BT.601 studio range, the Y4M default
+void ConvertYuvToRgba(const std::uint8_t* yPlane, const std::uint8_t* uPlane, const std::uint8_t* vPlane,
+    const std::uint8_t* aPlane, int width, int height, int chromaWidth, int shiftX, int shiftY, std::uint8_t* rgba)
+{
+    const bool mono = !uPlane || !vPlane;
+    for (int y = 0; y < height; ++y) {
+        const std::uint8_t* yRow = yPlane + static_cast<size_t>(y) * width;
+        const std::uint8_t* uRow = mono ? nullptr : uPlane + static_cast<size_t>(y >> shiftY) * chromaWidth;
+        const std::uint8_t* vRow = mono ? nullptr : vPlane + static_cast<size_t>(y >> shiftY) * chromaWidth;
+        std::uint8_t* out = rgba + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            int c = 298 * (yRow[x] - 16);
+            int d = mono ? 0 : uRow[x >> shiftX] - 128;
+            int e = mono ? 0 : vRow[x >> shiftX] - 128;
+            out[x * 4] = static_cast<std::uint8_t>(std::clamp((c + 409 * e + 128) >> 8, 0, 255));
+            out[x * 4 + 1] = static_cast<std::uint8_t>(std::clamp((c - 100 * d - 208 * e + 128) >> 8, 0, 255));
+            out[x * 4 + 2] = static_cast<std::uint8_t>(std::clamp((c + 516 * d + 128) >> 8, 0, 255));
+            out[x * 4 + 3] = aPlane ? aPlane[static_cast<size_t>(y) * width + x] : 255;
+        }
+    }
+}
+
+bool IsClipPath(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".y4m" || path.filename().string().find('#') != std::string::npos;
+}
+
+std::unique_ptr<ClipDecoder> OpenClipDecoder(const fs::path& path, std::string& error)
+{
+    if (path.filename().string().find('#') != std::string::npos) {
+        auto sequence = std::make_unique<ImageSequenceDecoder>();
+        if (!sequence->Open(path, error)) return nullptr;
+        return sequence;
+    }
+    auto y4m = std::make_unique<Y4mDecoder>();
+    if (!y4m->Open(path, error)) return nullptr;
+    return y4m;
+}
+
+// --- PREFETCH ---
+ClipStream::~ClipStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+bool ClipStream::Open(std::unique_ptr<ClipDecoder> clip, int startFrame, bool premultiplyFrames, std::string& error)
+{
+    decoder = std::move(clip);
+    premultiply = premultiplyFrames;
+    for (int i = 0; i < startFrame; ++i) {
+        if (!decoder->Skip()) {
+            error = "clip ends before frame " + std::to_string(startFrame);
+            return false;
+        }
+    }
+    slots.resize(PREFETCH_FRAMES);
+    worker = std::thread([this] { DecodeLoop(); });
+    return true;
+}
+
+void ClipStream::DecodeLoop()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [&] { return stopping || writeCount - readCount < PREFETCH_FRAMES; });
+            if (stopping) return;
+        }
+
+        // The slot at writeCount is not visible to the reader until writeCount moves
+        Slot& slot = slots[writeCount % PREFETCH_FRAMES];
+        bool ok = decoder->Next(slot.cache);
+        if (ok) {
+            if (premultiply) slot.cache = PremultiplyAlpha(slot.cache);
+            slot.histogram = ComputeHistogramParallel(slot.cache);
+            slot.luma = ComputeLumaPlane(slot.cache);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) writeCount++;
+            else decoderDone = true;
+        }
+        frameReady.notify_one();
+        if (!ok) return;
+    }
+}
+
+bool ClipStream::Present(PreparedInput& input, std::string& error)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (readCount == writeCount && !decoderDone) {
+        stalls++;
+        frameReady.wait(lock, [&] { return readCount != writeCount || decoderDone; });
+    }
+    if (readCount == writeCount) {
+        // Clip is over: hold the last frame
+        if (input.IsLoaded()) return true;
+        error = "clip has no decodable frames";
+        return false;
+    }
+    Slot& slot = slots[readCount % PREFETCH_FRAMES];
+    lock.unlock();
+
+    // Swapping hands the previous frame's buffers back to the ring for reuse
+    std::swap(input.cache, slot.cache);
+    std::swap(input.luma, slot.luma);
+    input.histogram = slot.histogram;
+
+    lock.lock();
+    readCount++;
+    lock.unlock();
+    slotFree.notify_one();
+
+    if (input.texture.getSize() != input.cache.getSize()) {
+        if (!input.texture.loadFromImage(input.cache)) {
+            error = "cannot create clip texture";
+            return false;
+        }
+        input.sprite.setTexture(input.texture, true);
+    }
+    else {
+        input.texture.update(input.cache);
+    }
+    input.generation++;
+    return true;
+}
+
+std::shared_ptr<PreparedInput> OpenClipInput(const fs::path& path, int offset, int frames, int firstFrame,
+    std::string* error)
+{
+    std::string message;
+    std::unique_ptr<ClipDecoder> decoder = OpenClipDecoder(path, message);
+    if (!decoder) {
+        if (error) *error = message;
+        return nullptr;
+    }
+
+    int start = offset;
+    if (start < 0) start = std::max(0, decoder->FrameCount() - (frames + 1));
+
+    auto input = std::make_shared<PreparedInput>();
+    input->clip = std::make_shared<ClipStream>();
+    if (!input->clip->Open(std::move(decoder), start + firstFrame, premultipliedPipeline, message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return input;
+}
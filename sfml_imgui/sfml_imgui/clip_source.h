@@ -0,0 +1,88 @@
+#ifndef CLIP_SOURCE_H
+#define CLIP_SOURCE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+#include "prepared_input.h"
+
+// Video-clip inputs: a Y4M file ("a.y4m") or a numbered image sequence written as a
+// pattern with a run of '#' for the frame number ("shots/a_####.png").
+bool IsClipPath(const std::filesystem::path& path);
+
+// Planar 8-bit YUV to RGBA8 (width * height * 4 bytes). The chroma planes are 'chromaWidth'
+// wide and subsampled by 1 << shiftX / 1 << shiftY; without them (mono) pixels are grey,
+// without 'aPlane' opaque.
+void ConvertYuvToRgba(const std::uint8_t* yPlane, const std::uint8_t* uPlane, const std::uint8_t* vPlane,
+    const std::uint8_t* aPlane, int width, int height, int chromaWidth, int shiftX, int shiftY, std::uint8_t* rgba);
+
+// Sequential decoder for one clip. Frames come out as straight-alpha RGBA8.
+class ClipDecoder {
+public:
+    virtual ~ClipDecoder() = default;
+    // Number of frames, or -1 when it cannot be known without decoding everything
+    virtual int FrameCount() const = 0;
+    // Decodes the next frame into 'frame' (reusing its storage). False at the end or on errors.
+    virtual bool Next(sf::Image& frame) = 0;
+    // Moves past the next frame without converting it
+    virtual bool Skip() = 0;
+};
+
+std::unique_ptr<ClipDecoder> OpenClipDecoder(const std::filesystem::path& path, std::string& error);
+
+// Decodes a clip on its own thread into a bounded ring of prepared frames (CPU copy,
+// histogram and luma plane, like PrepareInput). The render thread only swaps buffers
+// and uploads the texture, so decoding never sits on the render path as long as it
+// keeps up on average. Memory is PREFETCH_FRAMES frames no matter how long the clip is.
+class ClipStream {
+public:
+    static constexpr unsigned int PREFETCH_FRAMES = 6;
+
+    ~ClipStream();
+
+    // Starts decoding at clip frame 'startFrame'. 'premultiply' is the alpha mode of the
+    // export; it is captured here because the render switches are per thread.
+    bool Open(std::unique_ptr<ClipDecoder> decoder, int startFrame, bool premultiply, std::string& error);
+
+    // Moves 'input' to the next clip frame. After the last frame the input keeps showing
+    // it, so a clip shorter than the transition holds its end. False only if the clip
+    // produced no frame at all.
+    bool Present(PreparedInput& input, std::string& error);
+
+    // Times Present had to wait for the decoder
+    unsigned int Stalls() const { return stalls; }
+
+private:
+    struct Slot {
+        sf::Image cache;
+        ChannelHistogram histogram;
+        std::vector<std::uint8_t> luma;
+    };
+
+    void DecodeLoop();
+
+    std::unique_ptr<ClipDecoder> decoder;
+    bool premultiply = false;
+    std::vector<Slot> slots;
+    size_t readCount = 0, writeCount = 0;   // Monotonic; slot = count % PREFETCH_FRAMES
+    bool decoderDone = false, stopping = false;
+    unsigned int stalls = 0;
+    std::mutex mutex;
+    std::condition_variable frameReady, slotFree;
+    std::thread worker;
+};
+
+// PreparedInput fed by a ClipStream. 'offset' is the clip frame shown at transition
+// frame 0; -1 aligns the clip's last frame with the transition's last frame (the tail
+// of an outgoing clip). 'frames' and 'firstFrame' come from the export settings, so a
+// shard starting mid-range picks up the matching clip frame.
+std::shared_ptr<PreparedInput> OpenClipInput(const std::filesystem::path& path, int offset, int frames,
+    int firstFrame, std::string* error = nullptr);
+
+#endif //CLIP_SOURCE_H
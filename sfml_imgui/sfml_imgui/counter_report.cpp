@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "counter_report.h"
+#include "perf_counters.h"
+#include "render_job.h"
+#include "transitions.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const int SETUP_TRANSITION = -1;
+    const int ALL_TRANSITIONS = -2;
+
+    std::string ReportTransitionName(int transition)
+    {
+        if (transition == SETUP_TRANSITION) return "setup";
+        if (transition == ALL_TRANSITIONS) return "all";
+        return TRANSITION_NAMES[transition];
+    }
+
+    void AddInto(KernelCounterTotals& sum, const KernelCounterTotals& totals)
+    {
+        sum.calls += totals.calls;
+        sum.pixels += totals.pixels;
+        sum.ms += totals.ms;
+        for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+            if (!totals.counted[e]) continue;
+            sum.values[e] += totals.values[e];
+            sum.countedPixels[e] += totals.countedPixels[e];
+            sum.counted[e] = true;
+        }
+    }
+
+    void PrintKernel(int transition, const KernelCounterTotals& totals)
+    {
+        const int cycles = static_cast<int>(CounterEvent::Cycles);
+        const int instructions = static_cast<int>(CounterEvent::Instructions);
+
+        JsonWriter event;
+        event.Add("event", "kernel").Add("transition", ReportTransitionName(transition)).Add("kernel", totals.kernel)
+            .Add("calls", static_cast<long long>(totals.calls)).Add("pixels", static_cast<long long>(totals.pixels))
+            .Add("ms", totals.ms);
+        if (totals.pixels > 0) event.Add("nsPerPixel", totals.ms * 1e6 / totals.pixels);
+        for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+            if (!totals.counted[e]) continue;
+            std::string name = CounterEventName(static_cast<CounterEvent>(e));
+            event.Add(name, static_cast<long long>(totals.values[e]));
+            if (totals.countedPixels[e] > 0)
+                event.Add(name + "PerPixel", static_cast<double>(totals.values[e]) / totals.countedPixels[e]);
+        }
+        if (totals.counted[cycles] && totals.counted[instructions] && totals.values[cycles] > 0)
+            event.Add("ipc", static_cast<double>(totals.values[instructions]) / totals.values[cycles]);
+        std::cout << event.str() << std::endl;
+    }
+
+    // Kernel rows of one transition, then their sum. "frame" already contains the kernels
+    // that ran on the exporting thread, so it is left out of the sum.
+    void PrintTransition(int transition, const std::vector<KernelCounterTotals>& rows)
+    {
+        KernelCounterTotals kernels;
+        kernels.kernel = "kernels";
+        for (const KernelCounterTotals& row : rows) {
+            PrintKernel(transition, row);
+            if (row.kernel != "frame") AddInto(kernels, row);
+        }
+        if (kernels.calls > 0) PrintKernel(transition, kernels);
+    }
+}
+
+int RunCounterReport(const std::string& jobText, bool allTransitions)
+{
+    RenderJob job;
+    std::string error;
+    auto fail = [&](const std::string& message) {
+        DisableKernelCounters();
+        std::cout << JsonWriter().Add("event", "error").Add("id", job.id).Add("message", message).str() << std::endl;
+        return 1;
+    };
+    if (!LoadRenderJob(jobText, job, error)) return fail(error);
+    if (!job.slideshow.empty()) return fail("slideshow jobs are not supported; give two images");
+
+    std::vector<int> transitions;
+    if (allTransitions) {
+        for (int t = 0; t < EXPRESSION_TRANSITION; ++t) transitions.push_back(t);
+        if (!job.expression.empty()) transitions.push_back(EXPRESSION_TRANSITION);
+    }
+    else {
+        transitions.push_back(job.settings.transition);
+    }
+    // Frames are only hashed
+    job.settings.onFrameHash = [](int, std::uint64_t) {};
+
+    std::string status;
+    bool available = EnableKernelCounters(status);
+    std::cout << JsonWriter().Add("event", "counters").Add("id", job.id).Add("available", available)
+        .Add("message", status).str() << std::endl;
+
+    InputCache cache;
+    SetCounterTransition(SETUP_TRANSITION);
+    RenderJob warmUp = job;
+    warmUp.settings.transition = transitions.front();
+    if (warmUp.settings.transition != EXPRESSION_TRANSITION) warmUp.expression.clear();
+    warmUp.settings.lastFrame = std::max(0, warmUp.settings.firstFrame);
+    ExecuteRenderJob(warmUp, cache, nullptr, error);
+    if (!error.empty()) return fail(error);
+    PrintTransition(SETUP_TRANSITION, TakeKernelCounterTotals());
+
+    std::vector<KernelCounterTotals> overall;
+    for (int transition : transitions) {
+        RenderJob run = job;
+        run.settings.transition = transition;
+        if (transition != EXPRESSION_TRANSITION) run.expression.clear();
+
+        SetCounterTransition(transition);
+        auto start = std::chrono::steady_clock::now();
+        int written = ExecuteRenderJob(run, cache, nullptr, error);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!error.empty()) return fail(error);
+
+        std::vector<KernelCounterTotals> rows = TakeKernelCounterTotals();
+        PrintTransition(transition, rows);
+        std::cout << JsonWriter().Add("event", "transition").Add("id", job.id).Add("transition", transition)
+            .Add("name", ReportTransitionName(transition)).Add("frames", written).Add("ms", ms).str() << std::endl;
+
+        for (const KernelCounterTotals& row : rows) {
+            auto it = std::find_if(overall.begin(), overall.end(),
+                [&](const KernelCounterTotals& sum) { return sum.kernel == row.kernel; });
+            if (it == overall.end()) {
+                overall.emplace_back();
+                overall.back().kernel = row.kernel;
+                it = overall.end() - 1;
+            }
+            AddInto(*it, row);
+        }
+    }
+    if (transitions.size() > 1) PrintTransition(ALL_TRANSITIONS, overall);
+
+    SetCounterTransition(-1);
+    DisableKernelCounters();
+    std::cout << JsonWriter().Add("event", "done").Add("id", job.id)
+        .Add("transitions", static_cast<int>(transitions.size())).Add("counters", available).str() << std::endl;
+    return 0;
+}
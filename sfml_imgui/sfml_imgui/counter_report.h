@@ -0,0 +1,22 @@
+#ifndef COUNTER_REPORT_H
+#define COUNTER_REPORT_H
+
+#include <string>
+
+// --- COUNTER REPORT ---
+// --counter-report: renders a job with the kernel counters of perf_counters.h enabled and
+// reports, per transition and per kernel, where the cycles go: IPC, cycles per pixel and
+// LLC / branch misses per pixel next to the time. Low IPC with many LLC misses per pixel
+// means a kernel waits on memory; high IPC means it is compute-bound.
+// Frames are only hashed, nothing is written. Input preparation and one warm-up frame
+// are booked as "setup" so the transitions start with warm caches and a running pool.
+// With 'allTransitions' every transition is rendered in turn (the expression only when
+// the job has one) and the kernels are also summed over all of them ("all").
+// Without hardware counters the report still has calls, pixels and times.
+
+// Prints one "counters" event (available + message), one "kernel" event per kernel and
+// transition, one "transition" event per transition and a final "done". Returns the
+// process exit code.
+int RunCounterReport(const std::string& job, bool allTransitions);
+
+#endif //COUNTER_REPORT_H
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "cpu_features.h"
+#include <array>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+    const char* const ISA_NAMES[CPU_ISA_COUNT] = { "scalar", "sse2", "sse4.1", "avx2", "avx512", "neon" };
+
+#ifdef CPU_FEATURES_X86
+    void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+    {
+#ifdef _MSC_VER
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    // Register state the OS saves on a context switch (XCR0)
+    unsigned long long EnabledXState()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    std::array<bool, CPU_ISA_COUNT> DetectIsas()
+    {
+        std::array<bool, CPU_ISA_COUNT> supported{};
+        supported[static_cast<int>(CpuIsa::Scalar)] = true;
+#ifdef CPU_FEATURES_X86
+        unsigned int regs[4];
+        CpuId(0, 0, regs);
+        unsigned int maxLeaf = regs[0];
+        if (maxLeaf < 1) return supported;
+
+        CpuId(1, 0, regs);
+        bool sse2 = (regs[3] >> 26) & 1;
+        bool sse41 = (regs[2] >> 19) & 1;
+        bool osxsave = (regs[2] >> 27) & 1;
+        bool avx = (regs[2] >> 28) & 1;
+
+        // The wide registers are only usable when the OS saves them: YMM needs XCR0 bits 1-2,
+        // ZMM additionally the opmask and upper-ZMM bits 5-7
+        unsigned long long xcr0 = osxsave ? EnabledXState() : 0;
+        bool ymmState = (xcr0 & 0x6) == 0x6;
+        bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+        bool avx2 = false, avx512 = false;
+        if (maxLeaf >= 7) {
+            CpuId(7, 0, regs);
+            avx2 = avx && ymmState && ((regs[1] >> 5) & 1);
+            avx512 = avx2 && zmmState && ((regs[1] >> 16) & 1);   // AVX-512F
+        }
+        supported[static_cast<int>(CpuIsa::Sse2)] = sse2;
+        supported[static_cast<int>(CpuIsa::Sse41)] = sse2 && sse41;
+        supported[static_cast<int>(CpuIsa::Avx2)] = sse41 && avx2;
+        supported[static_cast<int>(CpuIsa::Avx512)] = sse41 && avx512;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        // Advanced SIMD is mandatory on ARMv8-A
+        supported[static_cast<int>(CpuIsa::Neon)] = true;
+#endif
+        return supported;
+    }
+
+    const std::array<bool, CPU_ISA_COUNT>& SupportedIsas()
+    {
+        static const std::array<bool, CPU_ISA_COUNT> supported = DetectIsas();
+        return supported;
+    }
+
+    CpuIsa InitialLimit()
+    {
+        CpuIsa best = BestSupportedIsa();
+        const char* value = std::getenv(ISA_ENV_VAR);
+        if (!value || !*value) return best;
+
+        CpuIsa isa;
+        if (!ParseCpuIsa(value, isa) || !CpuSupportsIsa(isa)) {
+            std::cerr << "Ignoring " << ISA_ENV_VAR << "=" << value << ": not an instruction set this CPU supports"
+                << std::endl;
+            return best;
+        }
+        return isa;
+    }
+
+    CpuIsa& LimitStorage()
+    {
+        static CpuIsa limit = InitialLimit();
+        return limit;
+    }
+}
+
+const char* CpuIsaName(CpuIsa isa)
+{
+    int index = static_cast<int>(isa);
+    return index >= 0 && index < CPU_ISA_COUNT ? ISA_NAMES[index] : "unknown";
+}
+
+bool ParseCpuIsa(const std::string& name, CpuIsa& isa)
+{
+    for (int i = 0; i < CPU_ISA_COUNT; ++i) {
+        if (name == ISA_NAMES[i]) {
+            isa = static_cast<CpuIsa>(i);
+            return true;
+        }
+    }
+    if (name == "sse41") { isa = CpuIsa::Sse41; return true; }
+    return false;
+}
+
+bool CpuSupportsIsa(CpuIsa isa)
+{
+    int index = static_cast<int>(isa);
+    return index >= 0 && index < CPU_ISA_COUNT && SupportedIsas()[index];
+}
+
+CpuIsa BestSupportedIsa()
+{
+    for (int i = CPU_ISA_COUNT - 1; i > 0; --i) {
+        if (SupportedIsas()[i]) return static_cast<CpuIsa>(i);
+    }
+    return CpuIsa::Scalar;
+}
+
+CpuIsa KernelIsaLimit()
+{
+    return LimitStorage();
+}
+
+bool KernelIsaAllowed(CpuIsa isa)
+{
+    // NEON is never supported together with the x86 sets, so plain ordering works for both families
+    return CpuSupportsIsa(isa) && static_cast<int>(isa) <= static_cast<int>(KernelIsaLimit());
+}
+
+bool SetKernelIsaLimit(const std::string& name, std::string& error)
+{
+    CpuIsa isa;
+    if (!ParseCpuIsa(name, isa)) {
+        error = "unknown instruction set '" + name + "' (scalar, sse2, sse4.1, avx2, avx512, neon)";
+        return false;
+    }
+    if (!CpuSupportsIsa(isa)) {
+        error = std::string(CpuIsaName(isa)) + " is not supported by this CPU";
+        return false;
+    }
+    LimitStorage() = isa;
+#ifdef _WIN32
+    _putenv_s(ISA_ENV_VAR, CpuIsaName(isa));
+#else
+    setenv(ISA_ENV_VAR, CpuIsaName(isa), 1);
+#endif
+    return true;
+}
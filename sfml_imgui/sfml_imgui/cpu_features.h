@@ -0,0 +1,37 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <string>
+
+// --- CPU FEATURES ---
+// Instruction sets the CPU kernels have hand-written versions for. One binary runs on
+// every machine: the kernel table (cpu_kernels.h) picks the best version the CPU
+// supports at start-up. On x86 the order is also the preference order; NEON is the
+// only choice on ARM64.
+enum class CpuIsa { Scalar = 0, Sse2 = 1, Sse41 = 2, Avx2 = 3, Avx512 = 4, Neon = 5 };
+const int CPU_ISA_COUNT = 6;
+
+// Environment variable that caps the ISA, e.g. TRANSITIONS_ISA=sse2 or =scalar
+const char* const ISA_ENV_VAR = "TRANSITIONS_ISA";
+
+// "scalar", "sse2", "sse4.1", "avx2", "avx512", "neon"
+const char* CpuIsaName(CpuIsa isa);
+bool ParseCpuIsa(const std::string& name, CpuIsa& isa);
+
+// Detected once (cpuid/xgetbv on x86, so OS support of the wider registers is included)
+bool CpuSupportsIsa(CpuIsa isa);
+CpuIsa BestSupportedIsa();
+
+// Highest ISA the kernels may use: the best supported one unless capped by the
+// environment variable or SetKernelIsaLimit. Read when the kernel table is built.
+CpuIsa KernelIsaLimit();
+// True when kernels may use 'isa' (supported and within the limit)
+bool KernelIsaAllowed(CpuIsa isa);
+
+// Caps the kernel ISA, e.g. for --isa on the command line. Has to run before the first
+// kernel call. The cap is also put into the environment, so worker processes started
+// later (shard workers) use the same code paths. Fails for unknown names and
+// ISAs this CPU does not support.
+bool SetKernelIsaLimit(const std::string& name, std::string& error);
+
+#endif //CPU_FEATURES_H
@@ -0,0 +1,441 @@
+#include "pch.h"
+#include "cpu_kernels.h"
+#include "cpu_kernels_isa.h"
+#include "json_lite.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+    template <PixelLayout Layout>
+    constexpr int BytesPerPixel() { return Layout == PixelLayout::Rgba8 ? 4 : 1; }
+
+    template <PixelLayout Layout>
+    void ResizeNearest(const std::uint8_t* src, unsigned int srcW, unsigned int srcH,
+        std::uint8_t* dst, unsigned int dstW, unsigned int dstH)
+    {
+        constexpr int BPP = BytesPerPixel<Layout>();
+        float scaleX = static_cast<float>(srcW) / dstW;
+        float scaleY = static_cast<float>(srcH) / dstH;
+
+        // Source column of every output column, resolved once instead of per row
+        std::vector<unsigned int> columns(dstW);
+        for (unsigned int x = 0; x < dstW; ++x)
+            columns[x] = std::min(srcW - 1, static_cast<unsigned int>(x * scaleX)) * BPP;
+
+        for (unsigned int y = 0; y < dstH; ++y) {
+            unsigned int origY = std::min(srcH - 1, static_cast<unsigned int>(y * scaleY));
+            const std::uint8_t* row = src + static_cast<size_t>(origY) * srcW * BPP;
+            std::uint8_t* out = dst + static_cast<size_t>(y) * dstW * BPP;
+            for (unsigned int x = 0; x < dstW; ++x)
+                std::memcpy(out + static_cast<size_t>(x) * BPP, row + columns[x], BPP);
+        }
+    }
+
+    template <PixelLayout Layout>
+    void SelectByMask(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+        std::uint8_t* dst, std::size_t pixels, int threshold)
+    {
+        // One integer holds a whole pixel, so the choice is a bit select on all channels at once
+        using Pixel = std::conditional_t<Layout == PixelLayout::Rgba8, std::uint32_t, std::uint8_t>;
+        static_assert(sizeof(Pixel) == BytesPerPixel<Layout>());
+
+        for (std::size_t i = 0; i < pixels; ++i) {
+            Pixel pa, pb;
+            std::memcpy(&pa, a + i * sizeof(Pixel), sizeof(Pixel));
+            std::memcpy(&pb, b + i * sizeof(Pixel), sizeof(Pixel));
+            Pixel m = static_cast<Pixel>(Pixel(0) - static_cast<Pixel>(static_cast<int>(mask[i]) >= threshold));
+            Pixel v = static_cast<Pixel>((pa & static_cast<Pixel>(~m)) | (pb & m));
+            std::memcpy(dst + i * sizeof(Pixel), &v, sizeof(Pixel));
+        }
+    }
+
+    void LumaPortable(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels)
+    {
+        for (std::size_t i = 0; i < pixels; ++i) {
+            const std::uint8_t* p = rgba + i * 4;
+            luma[i] = static_cast<std::uint8_t>((299 * p[0] + 587 * p[1] + 114 * p[2]) / 1000);
+        }
+    }
+
+    // Radius 0 selects the generic instance, which reads the radius at run time
+    template <int R>
+    constexpr int EffectiveRadius(int radius) { return R != 0 ? R : radius; }
+
+    // Sums of up to 2 * MAX_SPECIALIZED_RADIUS + 1 bytes fit in 16 bits, which doubles the
+    // lanes per vector; only the generic instance needs 32-bit sums
+    template <int R>
+    using TapSum = std::conditional_t<R != 0, std::uint16_t, std::uint32_t>;
+    static_assert((2 * MAX_SPECIALIZED_RADIUS + 1) * 255 <= 0xffff);
+
+    // Portable averaging primitives. With R != 0 the tap count is a constant and the tap
+    // loop unrolls; the drivers below call them directly, so they inline.
+    template <int R>
+    void AverageTapsPortable(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst)
+    {
+        const int t = R != 0 ? 2 * R + 1 : taps;
+        for (std::size_t i = 0; i < n; ++i) {
+            TapSum<R> sum = 0;
+            for (int k = 0; k < t; ++k) sum += rows[k][i];
+            dst[i] = static_cast<std::uint8_t>(sum / t);
+        }
+    }
+
+    template <int R>
+    void AverageTapsWidePortable(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst)
+    {
+        const int t = R != 0 ? 2 * R + 1 : taps;
+        for (std::size_t i = 0; i < n; ++i) {
+            TapSum<R> sum = 0;
+            for (int k = 0; k < t; ++k) sum += rows[k][i];
+            dst[i] = static_cast<std::uint16_t>(static_cast<std::uint32_t>(sum) * 256 / t);
+        }
+    }
+
+    // The blur drivers handle edges and tap rows; the interior goes to 'Average', the
+    // portable primitive or a hand-written one from cpu_kernels_isa.h
+    template <PixelLayout Layout, int R, AverageTapsKernel Average>
+    void BlurRows(const std::uint8_t* src, std::uint8_t* dst, int w, int h, int radius)
+    {
+        constexpr int C = BytesPerPixel<Layout>();
+        const int r = EffectiveRadius<R>(radius);
+        const int taps = 2 * r + 1;
+
+        // Pixels whose whole window lies inside the row; the rest go through the clamped loop
+        int interiorBegin = std::min(r, w);
+        int interiorEnd = std::max(interiorBegin, w - r);
+
+        std::vector<const std::uint8_t*> shifted(static_cast<size_t>(taps));
+        for (int y = 0; y < h; ++y) {
+            const std::uint8_t* row = src + static_cast<size_t>(y) * w * C;
+            std::uint8_t* out = dst + static_cast<size_t>(y) * w * C;
+
+            auto border = [&](int x) {
+                for (int c = 0; c < C; ++c) {
+                    unsigned int sum = 0;
+                    for (int k = -r; k <= r; ++k) sum += row[std::clamp(x + k, 0, w - 1) * C + c];
+                    out[x * C + c] = static_cast<std::uint8_t>(sum / taps);
+                }
+            };
+            for (int x = 0; x < interiorBegin; ++x) border(x);
+
+            // Byte i of the interior sums byte i of every tap's view of the row: the same
+            // contiguous loop over shifted rows as the vertical pass
+            if (interiorEnd > interiorBegin) {
+                for (int k = 0; k < taps; ++k) shifted[k] = row + (interiorBegin - r + k) * C;
+                Average(shifted.data(), taps, static_cast<size_t>(interiorEnd - interiorBegin) * C, out + interiorBegin * C);
+            }
+
+            for (int x = interiorEnd; x < w; ++x) border(x);
+        }
+    }
+
+    template <PixelLayout Layout, BlurOutput Output, int R, AverageTapsKernel Average, AverageTapsWideKernel AverageWide>
+    void BlurColumns(const std::uint8_t* src, std::uint8_t* dst, std::uint16_t* wide, int w, int h, int radius,
+        void (*emitRow)(const std::uint16_t* wide, std::uint8_t* dst, int w, int y))
+    {
+        constexpr int C = BytesPerPixel<Layout>();
+        const int r = EffectiveRadius<R>(radius);
+        const int taps = 2 * r + 1;
+        const size_t stride = static_cast<size_t>(w) * C;
+
+        // Edge clamping happens here, once per output row; the byte loop never checks bounds
+        std::vector<const std::uint8_t*> rows(static_cast<size_t>(taps));
+        for (int y = 0; y < h; ++y) {
+            for (int k = 0; k < taps; ++k)
+                rows[k] = src + static_cast<size_t>(std::clamp(y + k - r, 0, h - 1)) * stride;
+            std::uint8_t* out = dst + static_cast<size_t>(y) * stride;
+
+            if constexpr (Output == BlurOutput::Wide) {
+                AverageWide(rows.data(), taps, stride, wide);
+                emitRow(wide, out, w, y);
+            }
+            else {
+                Average(rows.data(), taps, stride, out);
+            }
+        }
+    }
+
+    template <PixelLayout Layout, int R, AverageTapsKernel Average, AverageTapsWideKernel AverageWide>
+    void SetBlurEntries(CpuKernelTable& table)
+    {
+        constexpr int L = static_cast<int>(Layout);
+        table.blurRows[L][R] = &BlurRows<Layout, R, Average>;
+        table.blurColumns[L][static_cast<int>(BlurOutput::Truncate)][R] =
+            &BlurColumns<Layout, BlurOutput::Truncate, R, Average, AverageWide>;
+        table.blurColumns[L][static_cast<int>(BlurOutput::Wide)][R] =
+            &BlurColumns<Layout, BlurOutput::Wide, R, Average, AverageWide>;
+    }
+
+    template <PixelLayout Layout, int... Radii>
+    void FillPortableBlur(CpuKernelTable& table, std::integer_sequence<int, Radii...>)
+    {
+        (SetBlurEntries<Layout, Radii, &AverageTapsPortable<Radii>, &AverageTapsWidePortable<Radii>>(table), ...);
+    }
+
+    template <PixelLayout Layout>
+    void FillPortableLayout(CpuKernelTable& table)
+    {
+        constexpr int L = static_cast<int>(Layout);
+        table.resize[L] = &ResizeNearest<Layout>;
+        table.select[L] = &SelectByMask<Layout>;
+        FillPortableBlur<Layout>(table, std::make_integer_sequence<int, MAX_SPECIALIZED_RADIUS + 1>());
+    }
+
+    CpuKernelTable PortableKernels()
+    {
+        CpuKernelTable table{};
+        FillPortableLayout<PixelLayout::Luma8>(table);
+        FillPortableLayout<PixelLayout::Rgba8>(table);
+        table.luma = &LumaPortable;
+        return table;
+    }
+
+    // Hand-written primitives only cover the specialized radii (their sums are 16 bits);
+    // the generic entry stays portable
+    template <AverageTapsKernel Average, AverageTapsWideKernel AverageWide, int... Radii>
+    void InstallBlur(CpuKernelTable& table, std::integer_sequence<int, Radii...>)
+    {
+        (SetBlurEntries<PixelLayout::Luma8, Radii + 1, Average, AverageWide>(table), ...);
+        (SetBlurEntries<PixelLayout::Rgba8, Radii + 1, Average, AverageWide>(table), ...);
+    }
+
+    template <AverageTapsKernel Average, AverageTapsWideKernel AverageWide>
+    void InstallBlur(CpuKernelTable& table)
+    {
+        InstallBlur<Average, AverageWide>(table, std::make_integer_sequence<int, MAX_SPECIALIZED_RADIUS>());
+    }
+
+    // --- VARIANTS ---
+    struct KernelVariant {
+        const char* kernel;
+        CpuIsa isa;
+        void (*install)(CpuKernelTable& table);
+    };
+
+    // In ascending preference; a later variant of the same kernel replaces an earlier one
+    const std::vector<KernelVariant>& KernelVariants()
+    {
+        static const std::vector<KernelVariant> variants = {
+#ifdef CPU_KERNELS_X86
+            { "select", CpuIsa::Sse2, [](CpuKernelTable& t) { t.select[static_cast<int>(PixelLayout::Rgba8)] = &SelectRgba8Sse2; } },
+            { "blur", CpuIsa::Sse2, [](CpuKernelTable& t) { InstallBlur<&AverageTapsSse2, &AverageTapsWideSse2>(t); } },
+            { "luma", CpuIsa::Sse41, [](CpuKernelTable& t) { t.luma = &LumaSse41; } },
+            { "select", CpuIsa::Avx2, [](CpuKernelTable& t) { t.select[static_cast<int>(PixelLayout::Rgba8)] = &SelectRgba8Avx2; } },
+            { "luma", CpuIsa::Avx2, [](CpuKernelTable& t) { t.luma = &LumaAvx2; } },
+            { "blur", CpuIsa::Avx2, [](CpuKernelTable& t) { InstallBlur<&AverageTapsAvx2, &AverageTapsWideAvx2>(t); } },
+            { "select", CpuIsa::Avx512, [](CpuKernelTable& t) { t.select[static_cast<int>(PixelLayout::Rgba8)] = &SelectRgba8Avx512; } },
+#endif
+#ifdef CPU_KERNELS_NEON
+            { "select", CpuIsa::Neon, [](CpuKernelTable& t) { t.select[static_cast<int>(PixelLayout::Rgba8)] = &SelectRgba8Neon; } },
+            { "luma", CpuIsa::Neon, [](CpuKernelTable& t) { t.luma = &LumaNeon; } },
+#endif
+        };
+        return variants;
+    }
+
+    // --- SELF-TEST ---
+    // Sizes are odd and not multiples of any vector width so every tail path runs
+
+    void FillNoise(std::vector<std::uint8_t>& bytes, std::uint32_t seed)
+    {
+        for (std::uint8_t& b : bytes) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            b = static_cast<std::uint8_t>(seed >> 24);
+        }
+    }
+
+    bool TestSelect(const CpuKernelTable& candidate, const CpuKernelTable& reference)
+    {
+        const size_t pixels = 173;
+        std::vector<std::uint8_t> a(pixels * 4), b(pixels * 4), mask(pixels), out(pixels * 4), expected(pixels * 4);
+        FillNoise(a, 1); FillNoise(b, 2); FillNoise(mask, 3);
+        for (int threshold : { -40, 0, 1, 97, 128, 255, 256, 300 }) {
+            for (int l = 0; l < PIXEL_LAYOUT_COUNT; ++l) {
+                candidate.select[l](a.data(), b.data(), mask.data(), out.data(), pixels, threshold);
+                reference.select[l](a.data(), b.data(), mask.data(), expected.data(), pixels, threshold);
+                if (out != expected) return false;
+            }
+        }
+        return true;
+    }
+
+    bool TestLuma(const CpuKernelTable& candidate, const CpuKernelTable& reference)
+    {
+        const size_t pixels = 1031;
+        std::vector<std::uint8_t> rgba(pixels * 4), out(pixels), expected(pixels);
+        FillNoise(rgba, 4);
+        // Extremes of the weighted sum, including exact multiples of 1000
+        for (size_t i = 0; i < 8; ++i) std::memset(&rgba[i * 4], i % 2 ? 255 : 0, 4);
+        for (size_t count : { size_t(1), size_t(7), size_t(33), pixels }) {
+            candidate.luma(rgba.data(), out.data(), count);
+            reference.luma(rgba.data(), expected.data(), count);
+            if (!std::equal(out.begin(), out.begin() + count, expected.begin())) return false;
+        }
+        return true;
+    }
+
+    // The wide rows go through emitRow; the self-test collects them here
+    thread_local std::vector<std::uint16_t>* collectedRows = nullptr;
+
+    void CollectRow(const std::uint16_t* wide, std::uint8_t*, int w, int)
+    {
+        // Only the Rgba8 layout is collected, so a row holds w * 4 values
+        collectedRows->insert(collectedRows->end(), wide, wide + static_cast<size_t>(w) * 4);
+    }
+
+    bool TestBlur(const CpuKernelTable& candidate, const CpuKernelTable& reference)
+    {
+        const int sizes[][2] = { { 1, 1 }, { 2, 3 }, { 5, 2 }, { 19, 7 }, { 67, 11 } };
+        for (const auto& size : sizes) {
+            int w = size[0], h = size[1];
+            for (int l = 0; l < PIXEL_LAYOUT_COUNT; ++l) {
+                size_t bytes = static_cast<size_t>(w) * h * (l == static_cast<int>(PixelLayout::Rgba8) ? 4 : 1);
+                std::vector<std::uint8_t> src(bytes), out(bytes), expected(bytes);
+                FillNoise(src, static_cast<std::uint32_t>(w * 131 + h));
+                for (int radius = 1; radius <= MAX_SPECIALIZED_RADIUS; ++radius) {
+                    int slot = BlurRadiusSlot(radius);
+                    candidate.blurRows[l][slot](src.data(), out.data(), w, h, radius);
+                    reference.blurRows[l][slot](src.data(), expected.data(), w, h, radius);
+                    if (out != expected) return false;
+
+                    int truncate = static_cast<int>(BlurOutput::Truncate);
+                    candidate.blurColumns[l][truncate][slot](src.data(), out.data(), nullptr, w, h, radius, nullptr);
+                    reference.blurColumns[l][truncate][slot](src.data(), expected.data(), nullptr, w, h, radius, nullptr);
+                    if (out != expected) return false;
+
+                    if (l != static_cast<int>(PixelLayout::Rgba8)) continue;
+                    int wideOut = static_cast<int>(BlurOutput::Wide);
+                    std::vector<std::uint16_t> wide(static_cast<size_t>(w) * 4), rows, expectedRows;
+                    collectedRows = &rows;
+                    candidate.blurColumns[l][wideOut][slot](src.data(), out.data(), wide.data(), w, h, radius, &CollectRow);
+                    collectedRows = &expectedRows;
+                    reference.blurColumns[l][wideOut][slot](src.data(), expected.data(), wide.data(), w, h, radius, &CollectRow);
+                    collectedRows = nullptr;
+                    if (rows != expectedRows) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool TestKernel(const std::string& kernel, const CpuKernelTable& candidate, const CpuKernelTable& reference)
+    {
+        if (kernel == "select") return TestSelect(candidate, reference);
+        if (kernel == "luma") return TestLuma(candidate, reference);
+        if (kernel == "blur") return TestBlur(candidate, reference);
+        return false;
+    }
+
+    struct KernelState {
+        CpuKernelTable portable;
+        CpuKernelTable table;
+        std::vector<KernelVariantReport> report;
+    };
+
+    KernelState BuildKernelState()
+    {
+        KernelState state;
+        state.portable = PortableKernels();
+        state.table = state.portable;
+        for (const KernelVariant& variant : KernelVariants()) {
+            if (!KernelIsaAllowed(variant.isa)) continue;
+            CpuKernelTable trial = state.table;
+            variant.install(trial);
+
+            KernelVariantReport entry;
+            entry.kernel = variant.kernel;
+            entry.isa = variant.isa;
+            entry.passed = TestKernel(variant.kernel, trial, state.portable);
+            if (entry.passed) {
+                state.table = trial;
+                for (KernelVariantReport& previous : state.report) {
+                    if (previous.kernel == entry.kernel) previous.selected = false;
+                }
+                entry.selected = true;
+            }
+            else {
+                std::cerr << "Kernel self-test failed: " << CpuIsaName(variant.isa) << " " << variant.kernel
+                    << ", keeping the previous version" << std::endl;
+            }
+            state.report.push_back(entry);
+        }
+        return state;
+    }
+
+    const KernelState& State()
+    {
+        static const KernelState state = BuildKernelState();
+        return state;
+    }
+}
+
+const CpuKernelTable& CpuKernels()
+{
+    return State().table;
+}
+
+const std::vector<KernelVariantReport>& CpuKernelReport()
+{
+    return State().report;
+}
+
+const CpuKernelTable& PortableCpuKernels()
+{
+    return State().portable;
+}
+
+std::vector<KernelCandidate> CpuKernelCandidates()
+{
+    std::vector<KernelCandidate> candidates;
+    for (const KernelVariant& variant : KernelVariants()) {
+        if (!KernelIsaAllowed(variant.isa)) continue;
+        KernelCandidate candidate;
+        candidate.kernel = variant.kernel;
+        candidate.isa = variant.isa;
+        candidate.table = State().portable;
+        variant.install(candidate.table);
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+std::vector<KernelVariantReport> RunKernelSelfTest()
+{
+    std::vector<KernelVariantReport> results;
+    // Each version on its own against the reference, whatever the table holds now
+    for (const KernelCandidate& candidate : CpuKernelCandidates()) {
+        KernelVariantReport entry;
+        entry.kernel = candidate.kernel;
+        entry.isa = candidate.isa;
+        entry.passed = TestKernel(candidate.kernel, candidate.table, State().portable);
+        for (const KernelVariantReport& installed : State().report) {
+            if (installed.kernel == entry.kernel && installed.isa == entry.isa) entry.selected = installed.selected;
+        }
+        results.push_back(entry);
+    }
+    return results;
+}
+
+int RunIsaReport()
+{
+    std::string detected;
+    for (int i = 1; i < CPU_ISA_COUNT; ++i) {
+        if (!CpuSupportsIsa(static_cast<CpuIsa>(i))) continue;
+        if (!detected.empty()) detected += ",";
+        detected += CpuIsaName(static_cast<CpuIsa>(i));
+    }
+    std::cout << JsonWriter().Add("event", "cpu").Add("detected", detected)
+        .Add("best", CpuIsaName(BestSupportedIsa())).Add("limit", CpuIsaName(KernelIsaLimit())).str() << std::endl;
+
+    bool allPassed = true;
+    for (const KernelVariantReport& entry : RunKernelSelfTest()) {
+        allPassed = allPassed && entry.passed;
+        std::cout << JsonWriter().Add("event", "kernel").Add("kernel", entry.kernel).Add("isa", CpuIsaName(entry.isa))
+            .Add("selfTest", entry.passed ? "pass" : "fail").Add("selected", entry.selected).str() << std::endl;
+    }
+    return allPassed ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#ifndef CPU_KERNELS_H
+#define CPU_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu_features.h"
+
+// --- SPECIALIZED CPU KERNELS ---
+// Inner loops of the CPU transitions, instantiated at compile time for each pixel layout,
+// blur radius and output op the renderer uses. An instance has no per-pixel decisions:
+// layout and radius are template constants, edge pixels go through a separate border
+// loop, and selections are done with masks, so the interior loops vectorize.
+// The dispatch table is built once; callers pick an entry per call, never per pixel.
+//
+// On top of the portable C++ kernels (the reference, vectorized only as far as the
+// compiler manages) some kernels have hand-written SSE2/SSE4.1/AVX2/AVX-512/NEON
+// versions. When the table is built, every version the CPU supports (up to the ISA
+// limit, see cpu_features.h) is compared with the reference on a small self-test; the
+// best one that matches byte for byte is installed, the others are reported and skipped.
+
+// Bytes per pixel of the buffers the kernels work on
+enum class PixelLayout { Luma8 = 0, Rgba8 = 1 };
+const int PIXEL_LAYOUT_COUNT = 2;
+
+// What the vertical blur pass produces
+enum class BlurOutput {
+    Truncate = 0,   // 8 bits, average rounded down (the undithered result)
+    Wide = 1        // 8.8 fixed point, for the blue-noise quantizer
+};
+const int BLUR_OUTPUT_COUNT = 2;
+
+// Radii 1..MAX_SPECIALIZED_RADIUS get their own instances (the blur transition runs its
+// downsampled pass at radius 1-3); larger radii use the generic entry
+const int MAX_SPECIALIZED_RADIUS = 4;
+
+// Nearest-neighbour resize (same sampling as ResizeImageCPU) of a tightly packed image
+using ResizeKernel = void (*)(const std::uint8_t* src, unsigned int srcW, unsigned int srcH,
+    std::uint8_t* dst, unsigned int dstW, unsigned int dstH);
+
+// Box blur along rows: dst = average of the 2r+1 horizontal neighbours, edges clamped
+using BlurRowsKernel = void (*)(const std::uint8_t* src, std::uint8_t* dst, int w, int h, int radius);
+
+// Box blur along columns, edges clamped. Writes 'dst' (Truncate) or 'wide', one
+// row of w pixels that is handed to 'emitRow' after every output row (Wide).
+using BlurColumnsKernel = void (*)(const std::uint8_t* src, std::uint8_t* dst, std::uint16_t* wide,
+    int w, int h, int radius, void (*emitRow)(const std::uint16_t* wide, std::uint8_t* dst, int w, int y));
+
+// Luminance (299 R + 587 G + 114 B) / 1000 of tightly packed RGBA8 pixels
+using LumaKernel = void (*)(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels);
+
+// Takes the whole pixel from 'b' where mask >= threshold and from 'a' elsewhere
+using SelectKernel = void (*)(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold);
+
+struct CpuKernelTable {
+    ResizeKernel resize[PIXEL_LAYOUT_COUNT];
+    SelectKernel select[PIXEL_LAYOUT_COUNT];
+    LumaKernel luma;
+    // Index 0 is the generic instance that takes any radius
+    BlurRowsKernel blurRows[PIXEL_LAYOUT_COUNT][MAX_SPECIALIZED_RADIUS + 1];
+    BlurColumnsKernel blurColumns[PIXEL_LAYOUT_COUNT][BLUR_OUTPUT_COUNT][MAX_SPECIALIZED_RADIUS + 1];
+};
+
+const CpuKernelTable& CpuKernels();
+
+// One hand-written version of a kernel and how it fared in the self-test
+struct KernelVariantReport {
+    std::string kernel;      // "select", "luma" or "blur"
+    CpuIsa isa = CpuIsa::Scalar;
+    bool passed = false;     // Matched the portable reference
+    bool selected = false;   // Installed in the table
+};
+
+// The portable kernels alone: the reference every hand-written version is compared with
+const CpuKernelTable& PortableCpuKernels();
+
+// One hand-written version installed over the portable kernels
+struct KernelCandidate {
+    std::string kernel;
+    CpuIsa isa = CpuIsa::Scalar;
+    CpuKernelTable table{};
+};
+
+// Every version within the ISA limit, each in a table of its own
+std::vector<KernelCandidate> CpuKernelCandidates();
+
+// Results of the self-test that ran when the table was built
+const std::vector<KernelVariantReport>& CpuKernelReport();
+
+// Runs the self-test again, on demand, for every version within the ISA limit
+std::vector<KernelVariantReport> RunKernelSelfTest();
+
+// --isa-report: prints the detected instruction sets, the limit and the self-test
+// results as JSON lines. Returns 1 when a version failed its self-test.
+int RunIsaReport();
+
+// Table entry for 'radius' (the generic one when it is not specialized)
+inline int BlurRadiusSlot(int radius) { return radius >= 1 && radius <= MAX_SPECIALIZED_RADIUS ? radius : 0; }
+
+#endif //CPU_KERNELS_H
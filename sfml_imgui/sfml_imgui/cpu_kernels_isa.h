@@ -0,0 +1,56 @@
+#ifndef CPU_KERNELS_ISA_H
+#define CPU_KERNELS_ISA_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Hand-written versions of the kernel primitives, one translation unit per architecture.
+// Only cpu_kernels.cpp uses these; it installs them into the table after they pass the
+// self-test against the portable reference. Every version produces exactly the bytes
+// of the portable one, so which one runs never shows in the output.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_KERNELS_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_KERNELS_NEON 1
+#endif
+
+// Functions built for a wider ISA than the compiler's default carry the target attribute
+// on GCC/Clang; MSVC accepts the intrinsics without it
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_TARGET(isa)
+#endif
+
+// Byte-wise average of 'taps' rows: dst[i] = sum of rows[k][i] / taps, rounded down.
+// Used for the interior of both blur passes; taps <= 2 * MAX_SPECIALIZED_RADIUS + 1.
+using AverageTapsKernel = void (*)(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst);
+// The same average as 8.8 fixed point: sum * 256 / taps, rounded down
+using AverageTapsWideKernel = void (*)(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst);
+
+#ifdef CPU_KERNELS_X86
+void SelectRgba8Sse2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold);
+void AverageTapsSse2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst);
+void AverageTapsWideSse2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst);
+
+void LumaSse41(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels);
+
+void SelectRgba8Avx2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold);
+void LumaAvx2(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels);
+void AverageTapsAvx2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst);
+void AverageTapsWideAvx2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst);
+
+void SelectRgba8Avx512(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold);
+#endif
+
+#ifdef CPU_KERNELS_NEON
+void SelectRgba8Neon(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold);
+void LumaNeon(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels);
+#endif
+
+#endif //CPU_KERNELS_ISA_H
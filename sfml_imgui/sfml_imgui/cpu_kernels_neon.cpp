@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "cpu_kernels_isa.h"
+
+#ifdef CPU_KERNELS_NEON
+#include <cstring>
+#include <arm_neon.h>
+
+// The blur averages have no NEON version: NEON is the baseline on ARM64, so the
+// portable kernels are already vectorized with it by the compiler.
+
+void SelectRgba8Neon(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold)
+{
+    // Mask bytes are 0..255: below 1 every pixel comes from b, above 255 every pixel from a
+    if (threshold <= 0 || threshold > 255) {
+        std::memcpy(dst, threshold <= 0 ? b : a, pixels * 4);
+        return;
+    }
+    const uint8x16_t t = vdupq_n_u8(static_cast<std::uint8_t>(threshold));
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        // De-interleaving loads put one channel per register, so the mask applies to each as is
+        uint8x16_t sel = vcgeq_u8(vld1q_u8(mask + i), t);
+        uint8x16x4_t pa = vld4q_u8(a + i * 4);
+        uint8x16x4_t pb = vld4q_u8(b + i * 4);
+        uint8x16x4_t out;
+        for (int c = 0; c < 4; ++c) out.val[c] = vbslq_u8(sel, pb.val[c], pa.val[c]);
+        vst4q_u8(dst + i * 4, out);
+    }
+    for (; i < pixels; ++i)
+        std::memcpy(dst + i * 4, (mask[i] >= threshold ? b : a) + i * 4, 4);
+}
+
+void LumaNeon(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        uint8x8x4_t p = vld4_u8(rgba + i * 4);
+        uint16x8_t r = vmovl_u8(p.val[0]), g = vmovl_u8(p.val[1]), b = vmovl_u8(p.val[2]);
+        uint16x4_t halves[2][3] = { { vget_low_u16(r), vget_low_u16(g), vget_low_u16(b) },
+            { vget_high_u16(r), vget_high_u16(g), vget_high_u16(b) } };
+        uint16x4_t q16[2];
+        for (int h = 0; h < 2; ++h) {
+            uint32x4_t x = vmull_n_u16(halves[h][0], 299);
+            x = vmlal_n_u16(x, halves[h][1], 587);
+            x = vmlal_n_u16(x, halves[h][2], 114);
+            // Float estimate of x / 1000, corrected by one step (x < 2^24, so the float is exact)
+            uint32x4_t q = vcvtq_u32_f32(vmulq_n_f32(vcvtq_f32_u32(x), 0.001f));
+            int32x4_t rem = vreinterpretq_s32_u32(vmlsq_n_u32(x, q, 1000));
+            q = vsubq_u32(q, vcgeq_s32(rem, vdupq_n_s32(1000)));   // Masks are all ones where true
+            q = vaddq_u32(q, vcltq_s32(rem, vdupq_n_s32(0)));
+            q16[h] = vmovn_u32(q);
+        }
+        vst1_u8(luma + i, vmovn_u16(vcombine_u16(q16[0], q16[1])));
+    }
+    for (; i < pixels; ++i) {
+        const std::uint8_t* px = rgba + i * 4;
+        luma[i] = static_cast<std::uint8_t>((299 * px[0] + 587 * px[1] + 114 * px[2]) / 1000);
+    }
+}
+#endif
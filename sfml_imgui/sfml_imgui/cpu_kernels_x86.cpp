@@ -0,0 +1,291 @@
+#include "pch.h"
+#include "cpu_kernels_isa.h"
+
+#ifdef CPU_KERNELS_X86
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+    // --- SCALAR TAILS ---
+    // The last pixels that do not fill a whole vector
+
+    void SelectTail(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+        std::uint8_t* dst, std::size_t begin, std::size_t end, int threshold)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            std::memcpy(dst + i * 4, (mask[i] >= threshold ? b : a) + i * 4, 4);
+    }
+
+    void LumaTail(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint8_t* p = rgba + i * 4;
+            luma[i] = static_cast<std::uint8_t>((299 * p[0] + 587 * p[1] + 114 * p[2]) / 1000);
+        }
+    }
+
+    unsigned int SumTaps(const std::uint8_t* const* rows, int taps, std::size_t i)
+    {
+        unsigned int sum = 0;
+        for (int k = 0; k < taps; ++k) sum += rows[k][i];
+        return sum;
+    }
+
+    // --- EXACT DIVISION ---
+    // Integer division has no vector instruction, so quotients are estimated with a float
+    // multiply by the reciprocal and corrected by one step in either direction. Dividends
+    // stay below 2^24, where floats are exact, and the estimate is never off by more than one.
+
+    KERNEL_TARGET("sse2")
+    inline __m128i DivideSse2(__m128i x, __m128 divisor, __m128 reciprocal)
+    {
+        __m128 xf = _mm_cvtepi32_ps(x);
+        __m128i q = _mm_cvttps_epi32(_mm_mul_ps(xf, reciprocal));
+        __m128 qf = _mm_cvtepi32_ps(q);
+        __m128i up = _mm_castps_si128(_mm_cmple_ps(_mm_mul_ps(_mm_add_ps(qf, _mm_set1_ps(1.0f)), divisor), xf));
+        __m128i down = _mm_castps_si128(_mm_cmpgt_ps(_mm_mul_ps(qf, divisor), xf));
+        // Comparison masks are -1 where true
+        return _mm_add_epi32(_mm_sub_epi32(q, up), down);
+    }
+
+    KERNEL_TARGET("avx2")
+    inline __m256i DivideAvx2(__m256i x, __m256 divisor, __m256 reciprocal)
+    {
+        __m256 xf = _mm256_cvtepi32_ps(x);
+        __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(xf, reciprocal));
+        __m256 qf = _mm256_cvtepi32_ps(q);
+        __m256i up = _mm256_castps_si256(
+            _mm256_cmp_ps(_mm256_mul_ps(_mm256_add_ps(qf, _mm256_set1_ps(1.0f)), divisor), xf, _CMP_LE_OQ));
+        __m256i down = _mm256_castps_si256(_mm256_cmp_ps(_mm256_mul_ps(qf, divisor), xf, _CMP_GT_OQ));
+        return _mm256_add_epi32(_mm256_sub_epi32(q, up), down);
+    }
+
+    // Luma of 4 (SSE4.1) or 8 (AVX2) RGBA pixels as 32-bit lanes
+    KERNEL_TARGET("sse4.1")
+    inline __m128i Luma4Sse41(__m128i p)
+    {
+        const __m128i byteMask = _mm_set1_epi32(0xff);
+        __m128i r = _mm_and_si128(p, byteMask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), byteMask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), byteMask);
+        __m128i x = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(299)),
+            _mm_mullo_epi32(g, _mm_set1_epi32(587))), _mm_mullo_epi32(b, _mm_set1_epi32(114)));
+        return DivideSse2(x, _mm_set1_ps(1000.0f), _mm_set1_ps(0.001f));
+    }
+
+    KERNEL_TARGET("avx2")
+    inline __m256i Luma8Avx2(__m256i p)
+    {
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        __m256i r = _mm256_and_si256(p, byteMask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), byteMask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 16), byteMask);
+        __m256i x = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(299)),
+            _mm256_mullo_epi32(g, _mm256_set1_epi32(587))), _mm256_mullo_epi32(b, _mm256_set1_epi32(114)));
+        return DivideAvx2(x, _mm256_set1_ps(1000.0f), _mm256_set1_ps(0.001f));
+    }
+
+    // Sums of 16 bytes over all taps, as 16-bit lanes (2 x 8 for SSE2, 1 x 16 for AVX2)
+    KERNEL_TARGET("sse2")
+    inline void SumTaps16Sse2(const std::uint8_t* const* rows, int taps, std::size_t i, __m128i& lo, __m128i& hi)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        lo = hi = zero;
+        for (int k = 0; k < taps; ++k) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+        }
+    }
+
+    KERNEL_TARGET("avx2")
+    inline __m256i SumTaps16Avx2(const std::uint8_t* const* rows, int taps, std::size_t i)
+    {
+        __m256i sum = _mm256_setzero_si256();
+        for (int k = 0; k < taps; ++k)
+            sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i))));
+        return sum;
+    }
+}
+
+// --- SSE2 ---
+
+KERNEL_TARGET("sse2")
+void SelectRgba8Sse2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold)
+{
+    // Mask bytes are 0..255: below 1 every pixel comes from b, above 255 every pixel from a.
+    // In between the threshold fits the unsigned byte compare.
+    if (threshold <= 0 || threshold > 255) {
+        std::memcpy(dst, threshold <= 0 ? b : a, pixels * 4);
+        return;
+    }
+    const __m128i t = _mm_set1_epi8(static_cast<char>(threshold));
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+        __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(m, t), m);
+        // Widen the byte per pixel to the four bytes of its RGBA value
+        __m128i lo = _mm_unpacklo_epi8(ge, ge), hi = _mm_unpackhi_epi8(ge, ge);
+        __m128i sel[4] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+            _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+        for (int j = 0; j < 4; ++j) {
+            std::size_t offset = (i + j * 4) * 4;
+            __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset));
+            __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset),
+                _mm_or_si128(_mm_andnot_si128(sel[j], pa), _mm_and_si128(sel[j], pb)));
+        }
+    }
+    SelectTail(a, b, mask, dst, i, pixels, threshold);
+}
+
+KERNEL_TARGET("sse2")
+void AverageTapsSse2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst)
+{
+    const __m128 divisor = _mm_set1_ps(static_cast<float>(taps));
+    const __m128 reciprocal = _mm_set1_ps(1.0f / taps);
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo, hi;
+        SumTaps16Sse2(rows, taps, i, lo, hi);
+        __m128i q0 = DivideSse2(_mm_unpacklo_epi16(lo, zero), divisor, reciprocal);
+        __m128i q1 = DivideSse2(_mm_unpackhi_epi16(lo, zero), divisor, reciprocal);
+        __m128i q2 = DivideSse2(_mm_unpacklo_epi16(hi, zero), divisor, reciprocal);
+        __m128i q3 = DivideSse2(_mm_unpackhi_epi16(hi, zero), divisor, reciprocal);
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+    }
+    for (; i < n; ++i) dst[i] = static_cast<std::uint8_t>(SumTaps(rows, taps, i) / taps);
+}
+
+KERNEL_TARGET("sse2")
+void AverageTapsWideSse2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst)
+{
+    const __m128 divisor = _mm_set1_ps(static_cast<float>(taps));
+    const __m128 reciprocal = _mm_set1_ps(1.0f / taps);
+    const __m128i zero = _mm_setzero_si128();
+    // SSE2 only packs to signed 16 bits, so results are biased into that range and back
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo, hi;
+        SumTaps16Sse2(rows, taps, i, lo, hi);
+        __m128i q[4];
+        __m128i sums[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+        for (int j = 0; j < 4; ++j)
+            q[j] = _mm_sub_epi32(DivideSse2(_mm_slli_epi32(sums[j], 8), divisor, reciprocal), bias32);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_packs_epi32(q[0], q[1]), bias16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_xor_si128(_mm_packs_epi32(q[2], q[3]), bias16));
+    }
+    for (; i < n; ++i) dst[i] = static_cast<std::uint16_t>(SumTaps(rows, taps, i) * 256 / taps);
+}
+
+// --- SSE4.1 ---
+
+KERNEL_TARGET("sse4.1")
+void LumaSse41(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i q0 = Luma4Sse41(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4)));
+        __m128i q1 = Luma4Sse41(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4 + 16)));
+        __m128i words = _mm_packus_epi32(q0, q1);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(luma + i), _mm_packus_epi16(words, words));
+    }
+    LumaTail(rgba, luma, i, pixels);
+}
+
+// --- AVX2 ---
+
+KERNEL_TARGET("avx2")
+void SelectRgba8Avx2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold)
+{
+    // Clamping keeps threshold - 1 from overflowing; mask bytes are 0..255 either way
+    threshold = std::clamp(threshold, 0, 256);
+    const __m256i limit = _mm256_set1_epi32(threshold - 1);
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i m = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i)));
+        __m256i sel = _mm256_cmpgt_epi32(m, limit);
+        __m256i pa = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i * 4));
+        __m256i pb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_blendv_epi8(pa, pb, sel));
+    }
+    SelectTail(a, b, mask, dst, i, pixels, threshold);
+}
+
+KERNEL_TARGET("avx2")
+void LumaAvx2(const std::uint8_t* rgba, std::uint8_t* luma, std::size_t pixels)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        __m256i q0 = Luma8Avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + i * 4)));
+        __m256i q1 = Luma8Avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + i * 4 + 32)));
+        // Packing works per 128-bit lane; the permute puts the 16 words back in pixel order
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(luma + i), bytes);
+    }
+    LumaTail(rgba, luma, i, pixels);
+}
+
+KERNEL_TARGET("avx2")
+void AverageTapsAvx2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint8_t* dst)
+{
+    const __m256 divisor = _mm256_set1_ps(static_cast<float>(taps));
+    const __m256 reciprocal = _mm256_set1_ps(1.0f / taps);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i sum = SumTaps16Avx2(rows, taps, i);
+        __m256i q0 = DivideAvx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(sum)), divisor, reciprocal);
+        __m256i q1 = DivideAvx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(sum, 1)), divisor, reciprocal);
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+    }
+    for (; i < n; ++i) dst[i] = static_cast<std::uint8_t>(SumTaps(rows, taps, i) / taps);
+}
+
+KERNEL_TARGET("avx2")
+void AverageTapsWideAvx2(const std::uint8_t* const* rows, int taps, std::size_t n, std::uint16_t* dst)
+{
+    const __m256 divisor = _mm256_set1_ps(static_cast<float>(taps));
+    const __m256 reciprocal = _mm256_set1_ps(1.0f / taps);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i sum = SumTaps16Avx2(rows, taps, i);
+        __m256i x0 = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(sum)), 8);
+        __m256i x1 = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(sum, 1)), 8);
+        __m256i q0 = DivideAvx2(x0, divisor, reciprocal);
+        __m256i q1 = DivideAvx2(x1, divisor, reciprocal);
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), words);
+    }
+    for (; i < n; ++i) dst[i] = static_cast<std::uint16_t>(SumTaps(rows, taps, i) * 256 / taps);
+}
+
+// --- AVX-512 ---
+
+KERNEL_TARGET("avx512f")
+void SelectRgba8Avx512(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask,
+    std::uint8_t* dst, std::size_t pixels, int threshold)
+{
+    threshold = std::clamp(threshold, 0, 256);
+    const __m512i limit = _mm512_set1_epi32(threshold - 1);
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        __m512i m = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i)));
+        __mmask16 sel = _mm512_cmpgt_epi32_mask(m, limit);
+        __m512i pa = _mm512_loadu_si512(a + i * 4);
+        __m512i pb = _mm512_loadu_si512(b + i * 4);
+        _mm512_storeu_si512(dst + i * 4, _mm512_mask_blend_epi32(sel, pa, pb));
+    }
+    SelectTail(a, b, mask, dst, i, pixels, threshold);
+}
+#endif
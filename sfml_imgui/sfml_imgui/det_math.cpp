@@ -0,0 +1,122 @@
+#include "pch.h"
+#include "det_math.h"
+#include <cmath>
+#include <limits>
+
+// A fused multiply-add rounds once instead of twice and would change results
+#ifdef _MSC_VER
+#pragma fp_contract(off)
+#endif
+
+namespace {
+    const double TWO_OVER_PI = 6.36619772367581382433e-01;
+    // pi/2 split into 33-bit pieces (fdlibm), so k * PIO2_1 and k * PIO2_2 are exact for |k| < 2^20
+    const double PIO2_1 = 1.57079632673412561417e+00;
+    const double PIO2_2 = 6.07710050630396597660e-11;
+    const double PIO2_3 = 2.02226624871116645580e-21;
+    const double LN2 = 6.93147180559945286227e-01;
+    const double LOG2E = 1.44269504088896338700e+00;
+    const double SQRT1_2 = 7.07106781186547572737e-01;
+
+    // Taylor series on |r| <= pi/4; the first omitted term is below 1e-18
+    double SinPoly(double r)
+    {
+        double r2 = r * r;
+        double p = 1.0 / 355687428096000.0;             // 1/17!
+        p = p * r2 - 1.0 / 1307674368000.0;              // 1/15!
+        p = p * r2 + 1.0 / 6227020800.0;                 // 1/13!
+        p = p * r2 - 1.0 / 39916800.0;
+        p = p * r2 + 1.0 / 362880.0;
+        p = p * r2 - 1.0 / 5040.0;
+        p = p * r2 + 1.0 / 120.0;
+        p = p * r2 - 1.0 / 6.0;
+        return r + r * r2 * p;
+    }
+
+    double CosPoly(double r)
+    {
+        double r2 = r * r;
+        double p = 1.0 / 6402373705728000.0;            // 1/18!
+        p = p * r2 - 1.0 / 20922789888000.0;             // 1/16!
+        p = p * r2 + 1.0 / 87178291200.0;                // 1/14!
+        p = p * r2 - 1.0 / 479001600.0;
+        p = p * r2 + 1.0 / 3628800.0;
+        p = p * r2 - 1.0 / 40320.0;
+        p = p * r2 + 1.0 / 720.0;
+        p = p * r2 - 1.0 / 24.0;
+        p = p * r2 + 0.5;
+        return 1.0 - r2 * p;
+    }
+
+    // sin(x + quadrant * pi/2), Cody-Waite reduction to |r| <= pi/4
+    float SinQuadrant(float x, int quadrant)
+    {
+        if (!std::isfinite(x)) return std::numeric_limits<float>::quiet_NaN();
+        double d = x;
+        double k = std::floor(d * TWO_OVER_PI + 0.5);
+        double r = ((d - k * PIO2_1) - k * PIO2_2) - k * PIO2_3;
+        int q = static_cast<int>(static_cast<long long>(k) & 3) + quadrant;
+        switch (q & 3) {
+        case 0: return static_cast<float>(SinPoly(r));
+        case 1: return static_cast<float>(CosPoly(r));
+        case 2: return static_cast<float>(-SinPoly(r));
+        default: return static_cast<float>(-CosPoly(r));
+        }
+    }
+
+    // 2^t: exact power of two times e^(f ln 2) with |f| <= 0.5
+    double Exp2(double t)
+    {
+        if (t != t) return t;
+        if (t > 130.0) return std::numeric_limits<double>::infinity();
+        if (t < -160.0) return 0.0;
+        double n = std::floor(t + 0.5);
+        double y = (t - n) * LN2;
+        double p = 1.0 / 6227020800.0;                   // 1/13!
+        p = p * y + 1.0 / 479001600.0;
+        p = p * y + 1.0 / 39916800.0;
+        p = p * y + 1.0 / 3628800.0;
+        p = p * y + 1.0 / 362880.0;
+        p = p * y + 1.0 / 40320.0;
+        p = p * y + 1.0 / 5040.0;
+        p = p * y + 1.0 / 720.0;
+        p = p * y + 1.0 / 120.0;
+        p = p * y + 1.0 / 24.0;
+        p = p * y + 1.0 / 6.0;
+        p = p * y + 0.5;
+        p = p * y + 1.0;
+        p = p * y + 1.0;
+        return std::ldexp(p, static_cast<int>(n));
+    }
+
+    // log2 of a positive finite value: exponent plus 2 atanh((m - 1) / (m + 1)) / ln 2
+    // with the mantissa m in [sqrt(1/2), sqrt(2))
+    double Log2(double v)
+    {
+        int e = 0;
+        double m = std::frexp(v, &e);
+        if (m < SQRT1_2) { m *= 2.0; e--; }
+        double s = (m - 1.0) / (m + 1.0);
+        double s2 = s * s;
+        double p = 1.0 / 23.0;
+        for (int k = 21; k >= 1; k -= 2) p = p * s2 + 1.0 / k;
+        return e + 2.0 * s * p * LOG2E;
+    }
+}
+
+float DetSin(float x) { return SinQuadrant(x, 0); }
+float DetCos(float x) { return SinQuadrant(x, 1); }
+
+float DetExp(float x)
+{
+    return static_cast<float>(Exp2(static_cast<double>(x) * LOG2E));
+}
+
+float DetPow(float a, float b)
+{
+    if (a != a || b != b) return std::numeric_limits<float>::quiet_NaN();
+    if (b == 0.0f || a == 1.0f) return 1.0f;
+    if (a <= 0.0f) return b > 0.0f ? 0.0f : std::numeric_limits<float>::infinity();
+    if (std::isinf(a)) return b > 0.0f ? a : 0.0f;
+    return static_cast<float>(Exp2(static_cast<double>(b) * Log2(a)));
+}
@@ -0,0 +1,20 @@
+#ifndef DET_MATH_H
+#define DET_MATH_H
+
+// --- DETERMINISTIC MATH ---
+// Replacements for the libm functions the renderer uses. The C runtime picks its own
+// code path per CPU (the MSVC CRT has FMA3 versions of sin/cos/exp/pow, glibc selects
+// implementations at load time), so std::sin can return a different last bit on two
+// machines running the same binary. These only use +, -, *, / on doubles plus floor,
+// frexp and ldexp, which IEEE 754 defines exactly, so the float result is the same on
+// every CPU, instruction set and compiler setting that keeps basic operations unfused.
+// Accuracy is within 1 ulp of the float result; inputs are expected in a sane range
+// (|x| < 1e6 for the trigonometric functions).
+
+float DetSin(float x);
+float DetCos(float x);
+float DetExp(float x);
+// pow for a >= 0 (the only case the renderer needs); negative 'a' is treated as 0
+float DetPow(float a, float b);
+
+#endif //DET_MATH_H
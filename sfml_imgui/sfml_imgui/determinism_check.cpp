@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "determinism_check.h"
+#include "child_process.h"
+#include "cpu_features.h"
+#include "render_job.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct CheckConfig {
+        CpuIsa isa = CpuIsa::Scalar;
+        unsigned int threads = 1;
+    };
+
+    std::string HashText(std::uint64_t hash)
+    {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+        return text;
+    }
+
+    // Single-threaded, a count that does not divide the canvas rows evenly, and more
+    // threads than most machines have, so the row bands of ParallelFor differ in each
+    std::vector<unsigned int> CheckThreadCounts()
+    {
+        return { 1u, 3u, std::max(8u, std::thread::hardware_concurrency()) };
+    }
+}
+
+int RunRenderHashes(const std::string& jobText)
+{
+    RenderJob job;
+    std::string error;
+    auto fail = [&](const std::string& message) {
+        std::cout << JsonWriter().Add("event", "error").Add("id", job.id).Add("message", message).str() << std::endl;
+        return 1;
+    };
+    if (!LoadRenderJob(jobText, job, error)) return fail(error);
+
+    job.settings.onFrameHash = [&](int frame, std::uint64_t hash) {
+        std::cout << JsonWriter().Add("event", "hash").Add("id", job.id)
+            .Add("frame", frame).Add("hash", HashText(hash)).str() << std::endl;
+    };
+    InputCache cache;
+    int written = ExecuteRenderJob(job, cache, nullptr, error);
+    if (!error.empty()) return fail(error);
+
+    std::cout << JsonWriter().Add("event", "done").Add("id", job.id).Add("frames", written).str() << std::endl;
+    return 0;
+}
+
+int RunDeterminismCheck(const std::string& jobText)
+{
+    RenderJob job;
+    std::string error;
+    if (!LoadRenderJob(jobText, job, error)) {
+        std::cerr << "Invalid job: " << error << std::endl;
+        return 1;
+    }
+    std::string exe = CurrentExecutablePath();
+    if (exe.empty()) {
+        std::cerr << "Cannot locate this executable to start workers" << std::endl;
+        return 1;
+    }
+    job.deterministic = true;
+    // Inline JSON, so the workers need nothing on disk
+    std::string inlineJob = RenderJobToJson(job);
+
+    std::vector<CheckConfig> configs;
+    for (int i = 0; i < CPU_ISA_COUNT; ++i) {
+        CpuIsa isa = static_cast<CpuIsa>(i);
+        if (!CpuSupportsIsa(isa)) continue;
+        for (unsigned int threads : CheckThreadCounts()) configs.push_back({ isa, threads });
+    }
+
+    std::vector<std::pair<int, std::string>> reference;
+    int mismatches = 0, failures = 0;
+    for (size_t c = 0; c < configs.size(); ++c) {
+        const CheckConfig& config = configs[c];
+        auto start = std::chrono::steady_clock::now();
+        ChildProcess worker;
+        std::vector<std::string> args = { "--isa", CpuIsaName(config.isa), "--threads", std::to_string(config.threads),
+            "--render-hash", inlineJob };
+        std::vector<std::pair<int, std::string>> hashes;
+        std::string workerError;
+        if (worker.Start(exe, args)) {
+            std::string line;
+            while (worker.ReadLine(line)) {
+                JsonObject event;
+                if (!ParseFlatJson(line, event)) continue;
+                std::string name = JsonGetString(event, "event");
+                if (name == "hash")
+                    hashes.emplace_back(static_cast<int>(JsonGetInt(event, "frame", -1)), JsonGetString(event, "hash"));
+                else if (name == "error")
+                    workerError = JsonGetString(event, "message");
+            }
+            int exitCode = worker.Wait();
+            if (exitCode != 0 && workerError.empty()) workerError = "exit code " + std::to_string(exitCode);
+        }
+        else {
+            workerError = "cannot start worker process";
+        }
+        if (workerError.empty() && hashes.empty()) workerError = "no frames rendered";
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        JsonWriter event;
+        event.Add("event", "config").Add("id", job.id).Add("isa", CpuIsaName(config.isa))
+            .Add("threads", config.threads).Add("frames", static_cast<int>(hashes.size())).Add("ms", ms);
+        if (!workerError.empty()) {
+            failures++;
+            std::cout << event.Add("match", false).Add("message", workerError).str() << std::endl;
+            continue;
+        }
+        if (reference.empty()) {
+            // The first configuration that renders at all is the reference
+            reference = hashes;
+            std::cout << event.Add("match", true).Add("reference", true).str() << std::endl;
+            continue;
+        }
+        int firstMismatch = -1;
+        for (size_t i = 0; i < std::max(hashes.size(), reference.size()); ++i) {
+            if (i >= hashes.size() || i >= reference.size() || hashes[i] != reference[i]) {
+                firstMismatch = i < hashes.size() ? hashes[i].first : reference[i].first;
+                break;
+            }
+        }
+        if (firstMismatch >= 0) mismatches++;
+        event.Add("match", firstMismatch < 0);
+        if (firstMismatch >= 0) event.Add("firstMismatch", firstMismatch);
+        std::cout << event.str() << std::endl;
+    }
+
+    bool passed = mismatches == 0 && failures == 0;
+    std::cout << JsonWriter().Add("event", "done").Add("id", job.id).Add("configs", static_cast<int>(configs.size()))
+        .Add("mismatches", mismatches).Add("failures", failures).Add("passed", passed).str() << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#ifndef DETERMINISM_CHECK_H
+#define DETERMINISM_CHECK_H
+
+#include <string>
+
+// --- DETERMINISM CHECK ---
+// Frame caches and sharded exports assume that a frame is the same bytes no matter which
+// process, thread count or instruction set rendered it. The check renders a job in
+// deterministic mode once per configuration - every instruction set this CPU supports
+// times a few thread counts - each in its own worker process (--isa / --threads are
+// process-wide), and compares the per-frame hashes with the first configuration.
+// Only the hashes travel back, nothing is written to the job's output.
+
+// --render-hash: renders the job (JSON file or inline JSON) in this process and prints
+// one {"event":"hash","frame":N,"hash":"<16 hex digits>"} line per frame.
+// Returns the process exit code.
+int RunRenderHashes(const std::string& job);
+
+// --determinism-check: runs the job in every configuration and prints one "config" event
+// per run and a final "done" event. Returns 0 when all hashes match, 1 otherwise.
+int RunDeterminismCheck(const std::string& job);
+
+#endif //DETERMINISM_CHECK_H
@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "directory_watcher.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (directory) {
+        CancelIo(directory);
+        CloseHandle(directory);
+    }
+    if (event) CloseHandle(event);
+}
+
+bool DirectoryWatcher::Start(const fs::path& watchRoot, std::string& error)
+{
+    root = watchRoot;
+    HANDLE dir = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (dir == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + root.string();
+        return false;
+    }
+    directory = dir;
+    event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    overlapped.assign(sizeof(OVERLAPPED), 0);
+    buffer.resize(64 * 1024);
+    if (!event || !Arm()) {
+        error = "cannot watch " + root.string();
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryWatcher::Arm()
+{
+    auto* ov = reinterpret_cast<OVERLAPPED*>(overlapped.data());
+    ZeroMemory(ov, sizeof(OVERLAPPED));
+    ov->hEvent = event;
+    return ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size()), TRUE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+        nullptr, ov, nullptr) != 0;
+}
+
+bool DirectoryWatcher::Poll(std::vector<fs::path>& changed, int timeoutMs)
+{
+    if (WaitForSingleObject(event, static_cast<DWORD>(timeoutMs)) != WAIT_OBJECT_0) return true;
+
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(directory, reinterpret_cast<OVERLAPPED*>(overlapped.data()), &bytes, FALSE)) return false;
+    ResetEvent(event);
+
+    if (bytes == 0) {
+        // The notification buffer overflowed: report the whole tree once. A folder removed
+        // mid-scan just ends it early rather than throwing out of the watch loop.
+        std::error_code ec, entryError;
+        for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+            !ec && it != end; it.increment(ec))
+            if (it->is_regular_file(entryError)) changed.push_back(it->path());
+    }
+    else {
+        const std::uint8_t* p = buffer.data();
+        for (;;) {
+            auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+            fs::path path = root / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+            changed.push_back(path);
+            // A directory moved into the tree brings its files without further events
+            if (info->Action == FILE_ACTION_RENAMED_NEW_NAME && fs::is_directory(path)) {
+                std::error_code ec, entryError;
+                for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+                    if (it->is_regular_file(entryError)) changed.push_back(it->path());
+            }
+            if (info->NextEntryOffset == 0) break;
+            p += info->NextEntryOffset;
+        }
+    }
+    return Arm();
+}
+#else
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+bool DirectoryWatcher::Start(const fs::path& watchRoot, std::string& error)
+{
+    root = watchRoot;
+    fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0) {
+        error = "inotify is not available";
+        return false;
+    }
+    AddTree(root, nullptr);
+    if (watches.empty()) {
+        error = "cannot watch " + root.string();
+        return false;
+    }
+    return true;
+}
+
+void DirectoryWatcher::AddTree(const fs::path& dir, std::vector<fs::path>* found)
+{
+    // IN_CLOSE_WRITE instead of IN_MODIFY: one event per finished write, not one per write() call
+    const std::uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+    int wd = inotify_add_watch(fd, dir.c_str(), mask);
+    if (wd < 0) return;
+    watches[wd] = dir;
+
+    // Entries removed while this runs are skipped, and a vanished folder ends the scan, without throwing
+    std::error_code ec, entryError;
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+        !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(entryError) && !it->is_symlink(entryError)) AddTree(it->path(), found);
+        // Anything that landed before the watch existed would otherwise go unnoticed
+        else if (found && it->is_regular_file(entryError)) found->push_back(it->path());
+    }
+}
+
+bool DirectoryWatcher::Poll(std::vector<fs::path>& changed, int timeoutMs)
+{
+    pollfd pfd = { fd, POLLIN, 0 };
+    int ready = ::poll(&pfd, 1, timeoutMs);
+    if (ready < 0) return errno == EINTR;
+    if (ready == 0) return true;
+
+    alignas(inotify_event) char buf[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0) return errno == EAGAIN || errno == EINTR;
+        if (n == 0) return true;
+
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Events were dropped: fall back to one full scan
+                std::error_code ec, entryError;
+                for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+                    !ec && it != end; it.increment(ec))
+                    if (it->is_regular_file(entryError)) changed.push_back(it->path());
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                watches.erase(ev->wd);
+                continue;
+            }
+            auto dir = watches.find(ev->wd);
+            if (dir == watches.end() || ev->len == 0) continue;
+
+            fs::path path = dir->second / ev->name;
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                AddTree(path, &changed);
+                continue;
+            }
+            // Plain creation is not interesting yet; the file is reported when it is closed
+            if (ev->mask & IN_CREATE) continue;
+            changed.push_back(path);
+        }
+    }
+}
+#endif
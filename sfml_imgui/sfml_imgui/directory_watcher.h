@@ -0,0 +1,42 @@
+#ifndef DIRECTORY_WATCHER_H
+#define DIRECTORY_WATCHER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Recursive change notifications for one directory tree: inotify on Linux,
+// ReadDirectoryChangesW on Windows. Reports paths only, never file contents,
+// so callers decide themselves whether a change matters.
+class DirectoryWatcher {
+public:
+    DirectoryWatcher() = default;
+    ~DirectoryWatcher();
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    bool Start(const std::filesystem::path& root, std::string& error);
+
+    // Waits up to 'timeoutMs' for events and appends every path that was created,
+    // finished writing, renamed or removed. Files inside a directory that appeared
+    // after Start are reported as well. Returns false if the watch broke down.
+    bool Poll(std::vector<std::filesystem::path>& changed, int timeoutMs);
+
+private:
+    std::filesystem::path root;
+#ifdef _WIN32
+    void* directory = nullptr;            // HANDLE
+    void* event = nullptr;                // HANDLE
+    std::vector<std::uint8_t> overlapped; // OVERLAPPED, kept opaque to stay out of Windows.h
+    std::vector<std::uint8_t> buffer;
+    bool Arm();
+#else
+    int fd = -1;
+    std::unordered_map<int, std::filesystem::path> watches;   // Watch descriptor -> directory
+    void AddTree(const std::filesystem::path& dir, std::vector<std::filesystem::path>* found);
+#endif
+};
+
+#endif //DIRECTORY_WATCHER_H
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "dither.h"
+#include "det_math.h"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    const unsigned int N = BLUE_NOISE_SIZE;
+    const unsigned int MASK = BLUE_NOISE_SIZE - 1;
+
+    // Void-and-cluster (Ulichney 1993) on a torus with a Gaussian energy filter
+    std::array<std::uint8_t, BLUE_NOISE_SIZE * BLUE_NOISE_SIZE> GenerateBlueNoise()
+    {
+        const unsigned int total = N * N;
+        const float sigma = 1.5f;
+
+        // Toroidal Gaussian, indexed by wrapped offset. DetExp keeps the map (and with it
+        // every dithered frame) identical on all machines.
+        std::vector<float> kernel(total);
+        for (unsigned int y = 0; y < N; ++y) {
+            for (unsigned int x = 0; x < N; ++x) {
+                float dx = static_cast<float>(std::min(x, N - x));
+                float dy = static_cast<float>(std::min(y, N - y));
+                kernel[y * N + x] = DetExp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+        }
+
+        std::vector<std::uint8_t> bits(total, 0);
+        std::vector<float> energy(total, 0.0f);
+        auto splat = [&](unsigned int idx, float sign) {
+            unsigned int px = idx % N, py = idx / N;
+            for (unsigned int y = 0; y < N; ++y) {
+                const float* k = &kernel[((y - py) & MASK) * N];
+                float* e = &energy[y * N];
+                for (unsigned int x = 0; x < N; ++x) e[x] += sign * k[(x - px) & MASK];
+            }
+        };
+        auto tightestCluster = [&]() {
+            unsigned int best = 0; float bestE = -1.0f;
+            for (unsigned int i = 0; i < total; ++i)
+                if (bits[i] && energy[i] > bestE) { bestE = energy[i]; best = i; }
+            return best;
+        };
+        auto largestVoid = [&]() {
+            unsigned int best = 0; float bestE = 1e30f;
+            for (unsigned int i = 0; i < total; ++i)
+                if (!bits[i] && energy[i] < bestE) { bestE = energy[i]; best = i; }
+            return best;
+        };
+
+        // Initial pattern: ~10% of the cells from a fixed LCG so the map is identical on every run
+        std::uint32_t seed = 0x2545F491u;
+        unsigned int ones = 0;
+        while (ones < total / 10) {
+            seed = seed * 1664525u + 1013904223u;
+            unsigned int idx = (seed >> 8) % total;
+            if (!bits[idx]) { bits[idx] = 1; splat(idx, 1.0f); ++ones; }
+        }
+
+        // Relax: move the tightest cluster into the largest void until they coincide
+        for (unsigned int iter = 0; iter < total; ++iter) {
+            unsigned int cluster = tightestCluster();
+            bits[cluster] = 0; splat(cluster, -1.0f);
+            unsigned int hole = largestVoid();
+            bits[hole] = 1; splat(hole, 1.0f);
+            if (hole == cluster) break;
+        }
+
+        std::vector<std::uint8_t> prototype = bits;
+        std::vector<float> prototypeEnergy = energy;
+        std::vector<unsigned int> rank(total, 0);
+
+        // Phase 1: rank the initial points by removing clusters
+        for (unsigned int r = ones; r-- > 0;) {
+            unsigned int cluster = tightestCluster();
+            bits[cluster] = 0; splat(cluster, -1.0f);
+            rank[cluster] = r;
+        }
+
+        // Phase 2/3: fill the remaining cells void by void
+        bits = prototype;
+        energy = prototypeEnergy;
+        for (unsigned int r = ones; r < total; ++r) {
+            unsigned int hole = largestVoid();
+            bits[hole] = 1; splat(hole, 1.0f);
+            rank[hole] = r;
+        }
+
+        std::array<std::uint8_t, BLUE_NOISE_SIZE * BLUE_NOISE_SIZE> tile{};
+        for (unsigned int i = 0; i < total; ++i)
+            tile[i] = static_cast<std::uint8_t>(rank[i] * 256 / total);
+        return tile;
+    }
+}
+
+const std::uint8_t* BlueNoiseTile()
+{
+    static const auto tile = GenerateBlueNoise();
+    return tile.data();
+}
+
+// Adding a threshold in [0, 256) before truncating is an unbiased rounding on average,
+// while plain truncation of the same buffer would drift dark by half a level.
+void QuantizeRowDithered(const std::uint16_t* src, std::uint8_t* dst, unsigned int pixels, unsigned int x0, unsigned int y)
+{
+    const std::uint8_t* noiseRow = BlueNoiseTile() + (y & MASK) * N;
+    for (unsigned int i = 0; i < pixels; ++i) {
+        std::uint32_t t = noiseRow[(x0 + i) & MASK];
+        for (int c = 0; c < 4; ++c) {
+            std::uint32_t v = (src[i * 4 + c] + t) >> 8;
+            dst[i * 4 + c] = static_cast<std::uint8_t>(v > 255 ? 255 : v);
+        }
+    }
+}
+
+void QuantizeRowDithered(const float* src, std::uint8_t* dst, unsigned int pixels, unsigned int x0, unsigned int y)
+{
+    const std::uint8_t* noiseRow = BlueNoiseTile() + (y & MASK) * N;
+    for (unsigned int i = 0; i < pixels; ++i) {
+        float t = noiseRow[(x0 + i) & MASK] * (1.0f / 256.0f);
+        for (int c = 0; c < 4; ++c) {
+            float v = std::clamp(src[i * 4 + c] + t, 0.0f, 255.0f);
+            dst[i * 4 + c] = static_cast<std::uint8_t>(v);
+        }
+    }
+}
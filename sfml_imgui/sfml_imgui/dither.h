@@ -0,0 +1,26 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <cstdint>
+
+// Side of the tileable blue-noise threshold map
+const unsigned int BLUE_NOISE_SIZE = 64;
+
+// 64x64 tileable blue-noise thresholds in [0, 255], generated once with void-and-cluster.
+// Unlike white noise or a Bayer matrix it has no low-frequency energy, so the dither
+// reads as fine grain instead of blotches or a cross-hatch pattern.
+const std::uint8_t* BlueNoiseTile();
+
+// Fused output quantization: converts one row of high-precision RGBA to RGBA8 with
+// blue-noise dithering. 'x0'/'y' are the frame coordinates of the first pixel and pick
+// the noise phase, so separately processed tiles line up seamlessly.
+// All four channels of a pixel share one threshold, which keeps premultiplied data
+// valid (colour never rounds above alpha).
+
+// 8.8 fixed point input (value * 256)
+void QuantizeRowDithered(const std::uint16_t* src, std::uint8_t* dst, unsigned int pixels, unsigned int x0, unsigned int y);
+
+// Float input in the 0..255 range (values outside are clamped)
+void QuantizeRowDithered(const float* src, std::uint8_t* dst, unsigned int pixels, unsigned int x0, unsigned int y);
+
+#endif //DITHER_H
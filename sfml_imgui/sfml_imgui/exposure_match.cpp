@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "exposure_match.h"
+#include "parallel.h"
+#include <mutex>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+// --- PARALLEL HISTOGRAM ---
+// Each task counts into 4 interleaved sub-histograms per channel. Consecutive pixels
+// usually share a value, and incrementing the same counter back-to-back serializes on
+// the store->load dependency; spreading them over 4 tables keeps the loop pipelined.
+// The 4 pixels of one iteration are fetched as a single 16-byte load.
+ChannelHistogram ComputeHistogramParallel(const sf::Image& img)
+{
+    ChannelHistogram result;
+    sf::Vector2u size = img.getSize();
+    const std::uint8_t* pixels = img.getPixelsPtr();
+    if (size.x == 0 || size.y == 0 || !pixels) return result;
+
+    std::mutex mergeMutex;
+
+    ParallelFor(size.y, [&](unsigned int rowBegin, unsigned int rowEnd) {
+        static constexpr int LANES = 4;
+        std::vector<std::uint32_t> local(LANES * 3 * 256, 0);
+        std::uint32_t* hR = local.data();
+        std::uint32_t* hG = hR + LANES * 256;
+        std::uint32_t* hB = hG + LANES * 256;
+
+        const std::uint8_t* p = pixels + static_cast<size_t>(rowBegin) * size.x * 4;
+        size_t count = static_cast<size_t>(rowEnd - rowBegin) * size.x;
+        size_t i = 0;
+
+        for (; i + LANES <= count; i += LANES) {
+            std::uint8_t px[16];
+            std::memcpy(px, p + i * 4, 16);
+            ++hR[0 * 256 + px[0]];  ++hG[0 * 256 + px[1]];  ++hB[0 * 256 + px[2]];
+            ++hR[1 * 256 + px[4]];  ++hG[1 * 256 + px[5]];  ++hB[1 * 256 + px[6]];
+            ++hR[2 * 256 + px[8]];  ++hG[2 * 256 + px[9]];  ++hB[2 * 256 + px[10]];
+            ++hR[3 * 256 + px[12]]; ++hG[3 * 256 + px[13]]; ++hB[3 * 256 + px[14]];
+        }
+        for (; i < count; ++i) {
+            const std::uint8_t* px = p + i * 4;
+            ++hR[px[0]]; ++hG[px[1]]; ++hB[px[2]];
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (int c = 0; c < 3; ++c) {
+            const std::uint32_t* h = local.data() + c * LANES * 256;
+            for (int v = 0; v < 256; ++v)
+                result.bins[c][v] += h[v] + h[256 + v] + h[512 + v] + h[768 + v];
+        }
+    }, 16);
+
+    result.total = static_cast<std::uint64_t>(size.x) * size.y;
+    return result;
+}
+
+// --- HISTOGRAM SPECIFICATION ---
+ChannelLut BuildMatchingLut(const ChannelHistogram& src, const ChannelHistogram& ref)
+{
+    ChannelLut lut;
+    for (int c = 0; c < 3; ++c) {
+        if (src.total == 0 || ref.total == 0) {
+            for (int v = 0; v < 256; ++v) lut.table[c][v] = static_cast<std::uint8_t>(v);
+            continue;
+        }
+
+        // Cross-multiplied comparison (cdfSrc/totalSrc <= cdfRef/totalRef) keeps everything integral
+        std::uint64_t cdfSrc = 0, cdfRef = ref.bins[c][0];
+        int j = 0;
+        for (int v = 0; v < 256; ++v) {
+            cdfSrc += src.bins[c][v];
+            while (j < 255 && cdfRef * src.total < cdfSrc * ref.total) {
+                ++j;
+                cdfRef += ref.bins[c][j];
+            }
+            lut.table[c][v] = static_cast<std::uint8_t>(j);
+        }
+    }
+    return lut;
+}
+
+ChannelLut BlendLutWithIdentity(const ChannelLut& lut, float amount)
+{
+    amount = std::max(0.0f, std::min(1.0f, amount));
+    ChannelLut out;
+    for (int c = 0; c < 3; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            float mixed = v + (lut.table[c][v] - v) * amount;
+            out.table[c][v] = static_cast<std::uint8_t>(std::lround(mixed));
+        }
+    }
+    return out;
+}
+
+void ApplyChannelLut(const sf::Image& src, PixelBuffer& dst, const ChannelLut& lut)
+{
+    sf::Vector2u size = src.getSize();
+    size_t totalPixels = static_cast<size_t>(size.x) * size.y;
+    if (dst.size() != totalPixels * 4) dst.resize(totalPixels * 4);
+    if (totalPixels == 0) return;
+
+    const std::uint8_t* pSrc = src.getPixelsPtr();
+    std::uint8_t* pDst = dst.data();
+    const std::uint8_t* lr = lut.table[0].data();
+    const std::uint8_t* lg = lut.table[1].data();
+    const std::uint8_t* lb = lut.table[2].data();
+
+    ParallelFor(size.y, [&](unsigned int rowBegin, unsigned int rowEnd) {
+        size_t begin = static_cast<size_t>(rowBegin) * size.x * 4;
+        size_t end = static_cast<size_t>(rowEnd) * size.x * 4;
+        for (size_t i = begin; i < end; i += 4) {
+            pDst[i] = lr[pSrc[i]];
+            pDst[i + 1] = lg[pSrc[i + 1]];
+            pDst[i + 2] = lb[pSrc[i + 2]];
+            pDst[i + 3] = pSrc[i + 3];
+        }
+    }, 16);
+}
@@ -0,0 +1,36 @@
+#ifndef EXPOSURE_MATCH_H
+#define EXPOSURE_MATCH_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+#include "pixel_buffer.h"
+
+// Per-channel (R, G, B) 256-bin histogram of an RGBA8 image
+struct ChannelHistogram {
+    std::array<std::array<std::uint32_t, 256>, 3> bins{};
+    std::uint64_t total = 0;
+};
+
+// Per-channel 8-bit lookup table (R, G, B). Alpha is never remapped.
+struct ChannelLut {
+    std::array<std::array<std::uint8_t, 256>, 3> table{};
+};
+
+// Builds the histogram of an image using all hardware threads.
+// Meant to be called once when an input is loaded and cached alongside it.
+ChannelHistogram ComputeHistogramParallel(const sf::Image& img);
+
+// Classic CDF histogram specification: maps the tones of 'src' so that its
+// distribution follows 'ref'. Images of different sizes are fine (CDFs are normalized).
+ChannelLut BuildMatchingLut(const ChannelHistogram& src, const ChannelHistogram& ref);
+
+// Mixes a matching LUT with the identity. amount = 0 keeps the original tones,
+// amount = 1 applies the full match. Used to grade inputs progressively over a transition.
+ChannelLut BlendLutWithIdentity(const ChannelLut& lut, float amount);
+
+// Applies the LUT to every pixel of 'src' and writes RGBA8 into 'dst' (resized as needed)
+void ApplyChannelLut(const sf::Image& src, PixelBuffer& dst, const ChannelLut& lut);
+
+#endif //EXPOSURE_MATCH_H
@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "frame_export.h"
+#include "alpha.h"
+#include "qoi.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+std::string FrameFileName(int index, FrameFormat format)
+{
+    std::stringstream ss;
+    ss << "frame_" << std::setw(3) << std::setfill('0') << index
+       << (format == FrameFormat::Qoi ? ".qoi" : ".png");
+    return ss.str();
+}
+
+std::vector<std::uint8_t> EncodeFrame(const sf::Image& frame, const ExportSettings& settings)
+{
+    sf::Vector2u size = frame.getSize();
+    const std::uint8_t* pixels = frame.getPixelsPtr();
+
+    // Opaque frames and premultiplied output can be encoded straight from the readback
+    std::vector<std::uint8_t> straight;
+    if (settings.transparent && settings.unpremultiply) {
+        straight.assign(pixels, pixels + static_cast<size_t>(size.x) * size.y * 4);
+        UnpremultiplyAlpha(straight.data(), static_cast<size_t>(size.x) * size.y);
+        pixels = straight.data();
+    }
+
+    if (settings.format == FrameFormat::Qoi)
+        return EncodeQoi(pixels, size.x, size.y);
+
+    const sf::Image* source = &frame;
+    sf::Image converted;
+    if (!straight.empty()) {
+        converted.resize(size, straight.data());
+        source = &converted;
+    }
+    return source->saveToMemory("png").value_or(std::vector<std::uint8_t>{});
+}
+
+bool WriteFrameFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& data)
+{
+    if (data.empty()) return false;
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
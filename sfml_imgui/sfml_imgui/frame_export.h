@@ -0,0 +1,27 @@
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+enum class FrameFormat { Png = 0, Qoi = 1 };
+
+struct ExportSettings {
+    FrameFormat format = FrameFormat::Png;
+    bool transparent = false;   // Frames come from the premultiplied, alpha-preserving pipeline
+    bool unpremultiply = true;  // Convert back to straight alpha before encoding (only used when transparent)
+};
+
+// "frame_007.png" / "frame_007.qoi"
+std::string FrameFileName(int index, FrameFormat format);
+
+// Encodes a rendered frame to an in-memory file according to the export settings
+std::vector<std::uint8_t> EncodeFrame(const sf::Image& frame, const ExportSettings& settings);
+
+// Writes an already encoded frame to disk. Returns false on I/O errors.
+bool WriteFrameFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& data);
+
+#endif //FRAME_EXPORT_H
@@ -0,0 +1,253 @@
+#include "pch.h"
+#include "frame_ring.h"
+#include <chrono>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const size_t RING_PAGE = 4096;
+
+    size_t RoundUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    RingSlotHeader* SlotAt(RingHeader* header, std::uint64_t index)
+    {
+        std::uint8_t* base = reinterpret_cast<std::uint8_t*>(header) + RING_PAGE;
+        return reinterpret_cast<RingSlotHeader*>(base + (index % header->slotCount) * header->slotStride);
+    }
+
+    // Spins briefly, then backs off to short sleeps. Returns false once 'timeoutMs' has passed.
+    template <typename Pred>
+    bool WaitFor(Pred ready, int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        for (int spin = 0; !ready(); ++spin) {
+            if (spin < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+    }
+}
+
+size_t RingSlotCapacityFor(unsigned int width, unsigned int height)
+{
+    return static_cast<size_t>(width) * height * 5 + 64;
+}
+
+// --- SHARED MAPPING ---
+SharedMapping::~SharedMapping()
+{
+    Close();
+}
+
+bool SharedMapping::Create(const std::string& name, size_t bytes)
+{
+    Close();
+#ifdef _WIN32
+    osName = "Local\\" + name;
+    HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<std::uint64_t>(bytes) >> 32), static_cast<DWORD>(bytes), osName.c_str());
+    if (!h) return false;
+    void* view = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!view) { CloseHandle(h); return false; }
+    handle = reinterpret_cast<std::intptr_t>(h);
+#else
+    osName = "/" + name;
+    shm_unlink(osName.c_str());   // Stale ring of a crashed producer
+    int fd = shm_open(osName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return false;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        shm_unlink(osName.c_str());
+        return false;
+    }
+    void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) { shm_unlink(osName.c_str()); return false; }
+#endif
+    data = static_cast<std::uint8_t*>(view);
+    size = bytes;
+    owner = true;
+    return true;
+}
+
+bool SharedMapping::Open(const std::string& name)
+{
+    Close();
+#ifdef _WIN32
+    osName = "Local\\" + name;
+    HANDLE h = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, osName.c_str());
+    if (!h) return false;
+    void* view = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!view) { CloseHandle(h); return false; }
+    MEMORY_BASIC_INFORMATION info = {};
+    VirtualQuery(view, &info, sizeof(info));
+    handle = reinterpret_cast<std::intptr_t>(h);
+    size = info.RegionSize;
+#else
+    osName = "/" + name;
+    int fd = shm_open(osName.c_str(), O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    size = static_cast<size_t>(st.st_size);
+#endif
+    data = static_cast<std::uint8_t*>(view);
+    owner = false;
+    return true;
+}
+
+void SharedMapping::Close()
+{
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+    handle = -1;
+#else
+    munmap(data, size);
+    // The name goes away, mappings the consumer already holds stay valid
+    if (owner) shm_unlink(osName.c_str());
+#endif
+    data = nullptr;
+    size = 0;
+    owner = false;
+}
+
+// --- PRODUCER ---
+bool FrameRingWriter::Create(const std::string& name, unsigned int slotCount, size_t slotCapacity)
+{
+    header = nullptr;
+    if (slotCount == 0) return false;
+    size_t stride = RoundUp(sizeof(RingSlotHeader) + slotCapacity, RING_PAGE);
+    if (!mapping.Create(name, RING_PAGE + stride * slotCount)) return false;
+
+    header = new (mapping.Data()) RingHeader{};
+    header->version = FRAME_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotCapacity = slotCapacity;
+    header->slotStride = stride;
+    for (unsigned int i = 0; i < slotCount; ++i)
+        new (mapping.Data() + RING_PAGE + stride * i) RingSlotHeader{};
+
+    // The magic goes in last: a consumer that sees it also sees the geometry
+    std::atomic_ref<std::uint32_t>(header->magic).store(FRAME_RING_MAGIC, std::memory_order_release);
+    return true;
+}
+
+std::uint8_t* FrameRingWriter::AcquireSlot(int timeoutMs)
+{
+    if (!header) return nullptr;
+    std::uint64_t w = header->writeIndex.load(std::memory_order_relaxed);
+    bool free = WaitFor([&] {
+        return w - header->readIndex.load(std::memory_order_acquire) < header->slotCount;
+    }, timeoutMs);
+    if (!free) return nullptr;
+    return reinterpret_cast<std::uint8_t*>(SlotAt(header, w) + 1);
+}
+
+void FrameRingWriter::CommitSlot(RingFormat format, unsigned int width, unsigned int height,
+    std::uint64_t sequence, size_t size)
+{
+    std::uint64_t w = header->writeIndex.load(std::memory_order_relaxed);
+    RingSlotHeader* slot = SlotAt(header, w);
+    slot->format = static_cast<std::uint32_t>(format);
+    slot->width = width;
+    slot->height = height;
+    slot->sequence = sequence;
+    slot->size = size;
+    slot->ready.store(1, std::memory_order_release);
+    header->writeIndex.store(w + 1, std::memory_order_release);
+}
+
+size_t FrameRingWriter::SlotCapacity() const
+{
+    return header ? static_cast<size_t>(header->slotCapacity) : 0;
+}
+
+void FrameRingWriter::Close(int drainTimeoutMs)
+{
+    if (header) {
+        header->producerClosed.store(1, std::memory_order_release);
+        // Keep the name alive until the consumer has attached and drained the ring
+        WaitFor([&] {
+            return header->readIndex.load(std::memory_order_acquire) == header->writeIndex.load(std::memory_order_relaxed);
+        }, drainTimeoutMs);
+    }
+    header = nullptr;
+    mapping.Close();
+}
+
+// --- CONSUMER ---
+bool FrameRingReader::Open(const std::string& name, int timeoutMs)
+{
+    header = nullptr;
+    bool opened = WaitFor([&] {
+        if (!mapping.Open(name)) return false;
+        auto* h = reinterpret_cast<RingHeader*>(mapping.Data());
+        // The producer may still be initializing the header
+        return mapping.Size() >= RING_PAGE && h->version == FRAME_RING_VERSION &&
+            std::atomic_ref<std::uint32_t>(h->magic).load(std::memory_order_acquire) == FRAME_RING_MAGIC;
+    }, timeoutMs);
+    if (!opened) {
+        mapping.Close();
+        return false;
+    }
+    header = reinterpret_cast<RingHeader*>(mapping.Data());
+    return true;
+}
+
+bool FrameRingReader::NextFrame(RingFrame& frame, int timeoutMs)
+{
+    if (!header) return false;
+    std::uint64_t r = header->readIndex.load(std::memory_order_relaxed);
+    bool available = WaitFor([&] {
+        return header->writeIndex.load(std::memory_order_acquire) != r ||
+            header->producerClosed.load(std::memory_order_acquire) != 0;
+    }, timeoutMs);
+    if (!available || header->writeIndex.load(std::memory_order_acquire) == r) return false;
+
+    RingSlotHeader* slot = SlotAt(header, r);
+    if (slot->ready.load(std::memory_order_acquire) == 0) return false;
+    frame.format = static_cast<RingFormat>(slot->format);
+    frame.width = slot->width;
+    frame.height = slot->height;
+    frame.sequence = slot->sequence;
+    frame.size = static_cast<size_t>(slot->size);
+    frame.data = reinterpret_cast<const std::uint8_t*>(slot + 1);
+    return true;
+}
+
+void FrameRingReader::ReleaseFrame()
+{
+    std::uint64_t r = header->readIndex.load(std::memory_order_relaxed);
+    SlotAt(header, r)->ready.store(0, std::memory_order_relaxed);
+    header->readIndex.store(r + 1, std::memory_order_release);
+}
+
+bool FrameRingReader::Finished() const
+{
+    return !header || (header->producerClosed.load(std::memory_order_acquire) != 0 &&
+        header->readIndex.load(std::memory_order_relaxed) == header->writeIndex.load(std::memory_order_acquire));
+}
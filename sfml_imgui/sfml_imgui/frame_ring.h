@@ -0,0 +1,126 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// --- SHARED-MEMORY FRAME RING ---
+// Single-producer / single-consumer ring of frame slots in named shared memory
+// (POSIX shm_open, or a named file mapping on Windows). A co-located encoder or
+// compositor maps the same region and reads finished frames in place instead of
+// through files or pipes.
+//
+// Layout, host byte order:
+//   RingHeader                    first 4 KB page
+//   slotCount x [RingSlotHeader | payload]   each slot starts on a 4 KB boundary
+//
+// The producer only advances writeIndex, the consumer only advances readIndex; both
+// grow forever and slot (index % slotCount) is used. The producer may fill a slot
+// while writeIndex - readIndex < slotCount. Each slot also carries a 'ready' flag:
+// set with release order once its header and payload are complete, cleared by the
+// consumer when it has finished reading in place.
+
+const std::uint32_t FRAME_RING_MAGIC = 0x524e5254; // "TRNR"
+const std::uint32_t FRAME_RING_VERSION = 1;
+
+enum class RingFormat : std::uint32_t { Rgba8 = 0, Png = 1, Qoi = 2 };
+
+struct RingSlotHeader {
+    std::atomic<std::uint32_t> ready;
+    std::uint32_t format;         // RingFormat
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t sequence;       // Frame index within the export
+    std::uint64_t size;           // Payload bytes that follow this header
+};
+
+struct RingHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::uint32_t reserved;
+    std::uint64_t slotCapacity;   // Payload bytes per slot
+    std::uint64_t slotStride;     // Distance between slot headers
+    alignas(64) std::atomic<std::uint64_t> writeIndex;
+    alignas(64) std::atomic<std::uint64_t> readIndex;
+    alignas(64) std::atomic<std::uint32_t> producerClosed;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "frame ring needs lock-free 64-bit atomics");
+
+// Named shared-memory region. Not copyable; unmapped on destruction and unlinked
+// again if this side created it.
+class SharedMapping {
+public:
+    SharedMapping() = default;
+    ~SharedMapping();
+    SharedMapping(const SharedMapping&) = delete;
+    SharedMapping& operator=(const SharedMapping&) = delete;
+
+    bool Create(const std::string& name, size_t size);
+    bool Open(const std::string& name);
+    void Close();
+
+    std::uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    std::intptr_t handle = -1;
+    std::uint8_t* data = nullptr;
+    size_t size = 0;
+    std::string osName;
+    bool owner = false;
+};
+
+class FrameRingWriter {
+public:
+    // Creates the ring (replacing a stale one of the same name)
+    bool Create(const std::string& name, unsigned int slotCount, size_t slotCapacity);
+
+    // Blocks until the consumer has freed a slot and returns its payload area,
+    // or nullptr after 'timeoutMs'. Fill it, then call CommitSlot.
+    std::uint8_t* AcquireSlot(int timeoutMs);
+    void CommitSlot(RingFormat format, unsigned int width, unsigned int height,
+        std::uint64_t sequence, size_t size);
+
+    size_t SlotCapacity() const;
+    // Marks the stream as finished and waits up to 'drainTimeoutMs' for the consumer
+    // to read what is left before the ring is unmapped.
+    void Close(int drainTimeoutMs = 0);
+
+private:
+    SharedMapping mapping;
+    RingHeader* header = nullptr;
+};
+
+// One published frame, valid until ReleaseFrame
+struct RingFrame {
+    RingFormat format = RingFormat::Rgba8;
+    unsigned int width = 0, height = 0;
+    std::uint64_t sequence = 0;
+    const std::uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+class FrameRingReader {
+public:
+    // Waits up to 'timeoutMs' for the producer to create the ring
+    bool Open(const std::string& name, int timeoutMs);
+
+    // Waits for the next frame. Returns false on timeout or once the producer has
+    // closed the stream and every frame was consumed (see Finished).
+    bool NextFrame(RingFrame& frame, int timeoutMs);
+    void ReleaseFrame();
+    bool Finished() const;
+
+private:
+    SharedMapping mapping;
+    RingHeader* header = nullptr;
+};
+
+// Payload capacity that fits any encoding of a width x height RGBA frame
+// (QOI worst case is 5 bytes per pixel plus header and padding)
+size_t RingSlotCapacityFor(unsigned int width, unsigned int height);
+
+#endif //FRAME_RING_H
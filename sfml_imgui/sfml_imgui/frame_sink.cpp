@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "frame_sink.h"
+#include "alpha.h"
+#include "render_graph.h"
+#include <cstring>
+
+// --- FOLDER ---
+FolderSink::FolderSink(const std::filesystem::path& folder, const ExportSettings& settings,
+    const FrameWriterSettings& writerSettings)
+    : folder(folder), settings(settings), writer(CreateFrameWriter(writerSettings))
+{
+}
+
+bool FolderSink::WriteFrame(int index, const sf::Image& frame, std::string& error)
+{
+    std::filesystem::path file = folder / FrameFileName(index, settings.format);
+    if (!writer->Write(file, EncodeFrame(frame, settings))) {
+        // A queued write failed earlier; collect its error
+        if (writer->Flush(error) || error.empty()) error = "cannot write " + file.string();
+        return false;
+    }
+    return true;
+}
+
+bool FolderSink::Finish(std::string& error)
+{
+    return writer->Flush(error);
+}
+
+int FolderSink::CompletedFrames(int accepted)
+{
+    return static_cast<int>(std::min<std::uint64_t>(writer->Completed(), static_cast<std::uint64_t>(accepted)));
+}
+
+// --- TAR ARCHIVE ---
+bool TarSink::Open(const std::filesystem::path& path, bool index, const ExportSettings& exportSettings,
+    std::string& error)
+{
+    archive = path;
+    writeIndex = index;
+    settings = exportSettings;
+    if (!tar.Open(archive)) {
+        error = "cannot create " + archive.string();
+        return false;
+    }
+    return true;
+}
+
+bool TarSink::WriteFrame(int index, const sf::Image& frame, std::string& error)
+{
+    std::vector<std::uint8_t> data = EncodeFrame(frame, settings);
+    if (data.empty() || !tar.Add(FrameFileName(index, settings.format), data.data(), data.size())) {
+        error = "cannot write frame " + std::to_string(index) + " to " + archive.string();
+        return false;
+    }
+    return true;
+}
+
+bool TarSink::Finish(std::string& error)
+{
+    if (!tar.Close()) {
+        error = "cannot finish " + archive.string();
+        return false;
+    }
+    std::filesystem::path indexPath = archive;
+    indexPath += ".idx";
+    if (writeIndex && !WriteTarIndex(indexPath, tar.Entries())) {
+        error = "cannot write " + indexPath.string();
+        return false;
+    }
+    return true;
+}
+
+// --- SHARED-MEMORY RING ---
+bool RingSink::Open(const std::string& name, unsigned int slots, bool encodeFrames, const ExportSettings& exportSettings,
+    sf::Vector2u frameSize, std::string& error)
+{
+    settings = exportSettings;
+    encoded = encodeFrames;
+    if (!ring.Create(name, slots, RingSlotCapacityFor(frameSize.x, frameSize.y))) {
+        error = "cannot create shared-memory ring '" + name + "'";
+        return false;
+    }
+    return true;
+}
+
+bool RingSink::WriteFrame(int index, const sf::Image& frame, std::string& error)
+{
+    std::uint8_t* slot = ring.AcquireSlot(CONSUMER_TIMEOUT_MS);
+    if (!slot) {
+        error = "ring consumer is not reading";
+        return false;
+    }
+
+    sf::Vector2u size = frame.getSize();
+    if (!encoded) {
+        size_t totalPixels = static_cast<size_t>(size.x) * size.y;
+        std::memcpy(slot, frame.getPixelsPtr(), totalPixels * 4);
+        if (settings.transparent && settings.unpremultiply) UnpremultiplyAlpha(slot, totalPixels);
+        ring.CommitSlot(RingFormat::Rgba8, size.x, size.y, static_cast<std::uint64_t>(index), totalPixels * 4);
+        return true;
+    }
+
+    std::vector<std::uint8_t> data = EncodeFrame(frame, settings);
+    if (data.empty() || data.size() > ring.SlotCapacity()) {
+        error = "cannot encode frame " + std::to_string(index);
+        return false;
+    }
+    std::memcpy(slot, data.data(), data.size());
+    ring.CommitSlot(settings.format == FrameFormat::Qoi ? RingFormat::Qoi : RingFormat::Png,
+        size.x, size.y, static_cast<std::uint64_t>(index), data.size());
+    return true;
+}
+
+bool RingSink::Finish(std::string& /*error*/)
+{
+    ring.Close(CONSUMER_TIMEOUT_MS);
+    return true;
+}
+
+// --- MEZZANINE ---
+bool MezzanineSink::Open(const std::filesystem::path& file, unsigned int keyInterval, const ExportSettings& exportSettings,
+    sf::Vector2u frameSize, std::string& error)
+{
+    path = file;
+    settings = exportSettings;
+    bool premultiplied = settings.transparent && !settings.unpremultiply;
+    if (!writer.Open(path, frameSize, premultiplied, keyInterval)) {
+        error = "cannot create " + path.string();
+        return false;
+    }
+    return true;
+}
+
+bool MezzanineSink::WriteFrame(int index, const sf::Image& frame, std::string& error)
+{
+    const std::uint8_t* pixels = frame.getPixelsPtr();
+    if (settings.transparent && settings.unpremultiply) {
+        sf::Vector2u size = frame.getSize();
+        straight.assign(pixels, pixels + static_cast<size_t>(size.x) * size.y * 4);
+        UnpremultiplyAlpha(straight.data(), static_cast<size_t>(size.x) * size.y);
+        pixels = straight.data();
+    }
+    if (!writer.AddFrame(index, pixels)) {
+        error = "cannot write frame " + std::to_string(index) + " to " + path.string();
+        return false;
+    }
+    return true;
+}
+
+bool MezzanineSink::Finish(std::string& error)
+{
+    if (!writer.Close()) {
+        error = "cannot finish " + path.string();
+        return false;
+    }
+    return true;
+}
+
+// --- HASH ---
+bool HashSink::WriteFrame(int index, const sf::Image& frame, std::string& /*error*/)
+{
+    onHash(index, HashImage(frame));
+    return true;
+}
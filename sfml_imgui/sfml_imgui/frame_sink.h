@@ -0,0 +1,111 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <SFML/Graphics/Image.hpp>
+#include "frame_export.h"
+#include "frame_ring.h"
+#include "frame_writer.h"
+#include "mezzanine.h"
+#include "tar_archive.h"
+
+// Destination of rendered frames. ExportSequence renders, the sink decides how
+// the pixels leave the process.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    // Takes one rendered frame (premultiplied when the export is transparent)
+    virtual bool WriteFrame(int index, const sf::Image& frame, std::string& error) = 0;
+    // Called once after the last frame
+    virtual bool Finish(std::string& /*error*/) { return true; }
+    // How many of the 'accepted' frames, in WriteFrame order, are completely written.
+    // Synchronous sinks are done with a frame when WriteFrame returns.
+    virtual int CompletedFrames(int accepted) { return accepted; }
+};
+
+// One encoded file per frame in a folder ("frame_007.png"). Encoding stays on the
+// render thread; the file writes are queued on an asynchronous FrameWriter.
+class FolderSink : public FrameSink {
+public:
+    FolderSink(const std::filesystem::path& folder, const ExportSettings& settings,
+        const FrameWriterSettings& writerSettings);
+    bool WriteFrame(int index, const sf::Image& frame, std::string& error) override;
+    bool Finish(std::string& error) override;
+    int CompletedFrames(int accepted) override;
+
+private:
+    std::filesystem::path folder;
+    ExportSettings settings;
+    std::unique_ptr<FrameWriter> writer;
+};
+
+// Streams encoded frames into one tar archive ("frame_007.png" entries) instead of one
+// file each, plus an optional "<archive>.idx" sidecar written at the end. Frames arrive
+// in order from ExportSequence, so the archive is written front to back.
+class TarSink : public FrameSink {
+public:
+    bool Open(const std::filesystem::path& archive, bool writeIndex, const ExportSettings& settings,
+        std::string& error);
+    bool WriteFrame(int index, const sf::Image& frame, std::string& error) override;
+    bool Finish(std::string& error) override;
+
+private:
+    TarWriter tar;
+    std::filesystem::path archive;
+    ExportSettings settings;
+    bool writeIndex = true;
+};
+
+// Publishes frames into a shared-memory FrameRing for a co-located consumer.
+// Raw RGBA8 goes straight from the readback into the slot; encoded frames are
+// copied in after encoding.
+class RingSink : public FrameSink {
+public:
+    // How long a full ring may block the renderer before the export fails
+    static constexpr int CONSUMER_TIMEOUT_MS = 30000;
+
+    bool Open(const std::string& name, unsigned int slots, bool encoded, const ExportSettings& settings,
+        sf::Vector2u frameSize, std::string& error);
+    bool WriteFrame(int index, const sf::Image& frame, std::string& error) override;
+    bool Finish(std::string& error) override;
+
+private:
+    FrameRingWriter ring;
+    ExportSettings settings;
+    bool encoded = false;
+};
+
+// Writes raw frames into a .tmz mezzanine container (delta + LZ4) for later finishing
+// steps. Pixels are stored the way the folder export would encode them: straight alpha
+// unless the export keeps premultiplied output.
+class MezzanineSink : public FrameSink {
+public:
+    bool Open(const std::filesystem::path& path, unsigned int keyInterval, const ExportSettings& settings,
+        sf::Vector2u frameSize, std::string& error);
+    bool WriteFrame(int index, const sf::Image& frame, std::string& error) override;
+    bool Finish(std::string& error) override;
+
+private:
+    MezzanineWriter writer;
+    std::filesystem::path path;
+    ExportSettings settings;
+    std::vector<std::uint8_t> straight;
+};
+
+// Writes nothing: reports a content hash of every frame (the raw rendered pixels, before
+// any unpremultiply or encoding) to a callback. Two renders of a job are bit-identical
+// when their hash lists match.
+class HashSink : public FrameSink {
+public:
+    explicit HashSink(std::function<void(int, std::uint64_t)> onHash) : onHash(std::move(onHash)) {}
+    bool WriteFrame(int index, const sf::Image& frame, std::string& error) override;
+
+private:
+    std::function<void(int, std::uint64_t)> onHash;
+};
+
+#endif //FRAME_SINK_H
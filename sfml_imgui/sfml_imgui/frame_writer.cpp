@@ -0,0 +1,434 @@
+#include "pch.h"
+#include "frame_writer.h"
+#include "frame_export.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Writes finish out of order; counts how many of them, from the first, are all done
+    class CompletedPrefix {
+    public:
+        void Add(std::uint64_t sequence)
+        {
+            done.insert(sequence);
+            while (!done.empty() && *done.begin() == count) {
+                done.erase(done.begin());
+                count++;
+            }
+        }
+
+        std::uint64_t Count() const { return count; }
+
+    private:
+        std::set<std::uint64_t> done;
+        std::uint64_t count = 0;
+    };
+
+    // --- THREAD POOL BACKEND ---
+    class ThreadPoolFrameWriter : public FrameWriter {
+    public:
+        explicit ThreadPoolFrameWriter(unsigned int queueDepth)
+            : depth(std::max(1u, queueDepth))
+        {
+            unsigned int count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+            for (unsigned int i = 0; i < count; ++i) workers.emplace_back([this] { WorkerLoop(); });
+        }
+
+        ~ThreadPoolFrameWriter() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            queueChanged.notify_all();
+            for (std::thread& t : workers) t.join();
+        }
+
+        bool Write(const fs::path& path, std::vector<std::uint8_t> data) override
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!firstError.empty()) return false;
+            queueChanged.wait(lock, [&] { return queue.size() + active < depth; });
+            queue.push_back({ path, std::move(data), queued++ });
+            queueChanged.notify_all();
+            return true;
+        }
+
+        bool Flush(std::string& error) override
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [&] { return queue.empty() && active == 0; });
+            if (firstError.empty()) return true;
+            error = firstError;
+            firstError.clear();
+            return false;
+        }
+
+        std::uint64_t Completed() override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return completed.Count();
+        }
+
+        const char* BackendName() const override { return "threads"; }
+
+    private:
+        struct Job {
+            fs::path path;
+            std::vector<std::uint8_t> data;
+            std::uint64_t sequence = 0;
+        };
+
+        void WorkerLoop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                queueChanged.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                Job job = std::move(queue.front());
+                queue.pop_front();
+                active++;
+                lock.unlock();
+
+                bool ok = WriteFrameFile(job.path, job.data);
+
+                lock.lock();
+                active--;
+                if (ok) completed.Add(job.sequence);
+                else if (firstError.empty()) firstError = "cannot write " + job.path.string();
+                queueChanged.notify_all();
+            }
+        }
+
+        unsigned int depth;
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable queueChanged;
+        std::deque<Job> queue;
+        unsigned int active = 0;
+        bool stopping = false;
+        std::uint64_t queued = 0;
+        CompletedPrefix completed;
+        std::string firstError;
+    };
+
+#ifdef HAVE_IO_URING
+    // --- IO_URING BACKEND ---
+    // Talks to the kernel through the raw syscalls so there is no liburing dependency.
+    // Only the thread that calls Write/Flush touches the rings; completions are reaped
+    // opportunistically on every call, so no extra thread is needed.
+    const size_t DIRECT_ALIGN = 4096;
+    // Submissions are handed to the kernel in batches of this many writes
+    const unsigned int SUBMIT_BATCH = 4;
+
+    class UringFrameWriter : public FrameWriter {
+    public:
+        ~UringFrameWriter() override
+        {
+            std::string ignored;
+            if (ringFd >= 0) {
+                Flush(ignored);
+                ::close(ringFd);
+            }
+            if (sqRing) munmap(sqRing, sqRingSize);
+            if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+            if (sqes) munmap(sqes, sqesSize);
+            for (Slot& slot : slots) std::free(slot.buffer);
+        }
+
+        bool Init(const FrameWriterSettings& settings)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            unsigned int depth = std::max(1u, settings.queueDepth);
+            ringFd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+            if (ringFd < 0) return false;
+
+            // io_uring itself dates from 5.1, but plain IORING_OP_WRITE only from 5.6
+            std::vector<std::uint8_t> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+            auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+            if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+                probe->last_op < IORING_OP_WRITE || !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+                return false;
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED) { sqRing = nullptr; return false; }
+            cqRing = single ? sqRing
+                : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) { cqRing = nullptr; return false; }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+            if (sqeMap == MAP_FAILED) return false;
+            sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+            auto* sq = static_cast<std::uint8_t*>(sqRing);
+            auto* cq = static_cast<std::uint8_t*>(cqRing);
+            sqTail = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.array);
+            cqHead = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<std::uint32_t*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            slots.resize(std::min(depth, params.sq_entries));
+            directIo = settings.directIo;
+            directIoMinBytes = settings.directIoMinBytes;
+
+            // Registered buffers spare the kernel from pinning pages on every write. They
+            // count against RLIMIT_MEMLOCK, so running without them is a normal outcome.
+            if (settings.bufferBytes > 0) {
+                bufferBytes = (settings.bufferBytes + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+                std::vector<iovec> iov(slots.size());
+                bool allocated = true;
+                for (size_t i = 0; i < slots.size(); ++i) {
+                    slots[i].buffer = static_cast<std::uint8_t*>(std::aligned_alloc(DIRECT_ALIGN, bufferBytes));
+                    if (!slots[i].buffer) { allocated = false; break; }
+                    iov[i] = { slots[i].buffer, bufferBytes };
+                }
+                if (allocated) registered = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS,
+                    iov.data(), static_cast<unsigned int>(iov.size())) == 0;
+                if (!registered) {
+                    for (Slot& slot : slots) { std::free(slot.buffer); slot.buffer = nullptr; }
+                    bufferBytes = 0;
+                }
+            }
+            return true;
+        }
+
+        bool Write(const fs::path& path, std::vector<std::uint8_t> data) override
+        {
+            if (!firstError.empty()) return false;
+            if (data.empty()) {
+                firstError = "cannot encode " + path.string();
+                return false;
+            }
+
+            Reap();
+            Slot* slot = nullptr;
+            while (!(slot = FreeSlot())) {
+                if (!Enter(1)) return false;
+                Reap();
+            }
+
+            size_t size = data.size();
+            bool useBuffer = registered && size <= bufferBytes;
+            // O_DIRECT needs an aligned buffer and an aligned length: write whole blocks
+            // from the registered buffer and cut the padding off afterwards
+            bool direct = directIo && useBuffer && size >= directIoMinBytes &&
+                (size + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN <= bufferBytes;
+
+            int fd = -1;
+            if (direct) {
+                fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+                if (fd < 0) direct = false;   // tmpfs and some network file systems refuse O_DIRECT
+            }
+            if (fd < 0) fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                firstError = "cannot write " + path.string();
+                return false;
+            }
+
+            slot->busy = true;
+            slot->fd = fd;
+            slot->path = path;
+            slot->size = size;
+            slot->written = 0;
+            slot->direct = direct;
+            slot->fixed = useBuffer;
+            slot->sequence = queued++;
+            if (useBuffer) {
+                std::memcpy(slot->buffer, data.data(), size);
+                if (direct) {
+                    size_t padded = (size + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+                    std::memset(slot->buffer + size, 0, padded - size);
+                }
+            }
+            else {
+                slot->data = std::move(data);
+            }
+            Queue(*slot);
+            if (pending >= SUBMIT_BATCH) Enter(0);
+            return true;
+        }
+
+        bool Flush(std::string& error) override
+        {
+            while (InFlight() > 0) {
+                if (!Enter(1)) break;
+                Reap();
+            }
+            if (firstError.empty()) return true;
+            error = firstError;
+            firstError.clear();
+            return false;
+        }
+
+        std::uint64_t Completed() override
+        {
+            Reap();
+            return completed.Count();
+        }
+
+        const char* BackendName() const override { return registered ? "io_uring (registered buffers)" : "io_uring"; }
+
+    private:
+        struct Slot {
+            bool busy = false;
+            int fd = -1;
+            fs::path path;
+            std::uint8_t* buffer = nullptr;   // Registered, DIRECT_ALIGN aligned
+            std::vector<std::uint8_t> data;   // Used when the frame does not fit the buffer
+            size_t size = 0;
+            size_t written = 0;
+            bool direct = false;
+            bool fixed = false;
+            std::uint64_t sequence = 0;
+        };
+
+        Slot* FreeSlot()
+        {
+            for (Slot& slot : slots) if (!slot.busy) return &slot;
+            return nullptr;
+        }
+
+        size_t InFlight() const
+        {
+            return static_cast<size_t>(std::count_if(slots.begin(), slots.end(), [](const Slot& s) { return s.busy; }));
+        }
+
+        void Queue(Slot& slot)
+        {
+            std::uint32_t tail = *sqTail;
+            std::uint32_t index = tail & sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            size_t length = slot.size - slot.written;
+            const std::uint8_t* source = (slot.fixed ? slot.buffer : slot.data.data()) + slot.written;
+            if (slot.direct) length = (length + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+
+            sqe.opcode = slot.fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe.fd = slot.fd;
+            sqe.off = slot.written;
+            sqe.addr = reinterpret_cast<std::uint64_t>(source);
+            sqe.len = static_cast<std::uint32_t>(length);
+            if (slot.fixed) sqe.buf_index = static_cast<std::uint16_t>(&slot - slots.data());
+            sqe.user_data = static_cast<std::uint64_t>(&slot - slots.data());
+
+            sqArray[index] = index;
+            std::atomic_ref<std::uint32_t>(*sqTail).store(tail + 1, std::memory_order_release);
+            pending++;
+        }
+
+        // Submits what is queued and optionally waits for 'minComplete' completions
+        bool Enter(unsigned int minComplete)
+        {
+            unsigned int flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+            for (;;) {
+                long r = syscall(__NR_io_uring_enter, ringFd, pending, minComplete, flags, nullptr, 0);
+                if (r >= 0) {
+                    pending -= std::min(pending, static_cast<unsigned int>(r));
+                    return true;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    if (firstError.empty()) firstError = "io_uring_enter failed";
+                    return false;
+                }
+            }
+        }
+
+        void Reap()
+        {
+            std::uint32_t head = *cqHead;
+            std::uint32_t tail = std::atomic_ref<std::uint32_t>(*cqTail).load(std::memory_order_acquire);
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                Complete(slots[static_cast<size_t>(cqe.user_data)], cqe.res);
+                head++;
+            }
+            std::atomic_ref<std::uint32_t>(*cqHead).store(head, std::memory_order_release);
+        }
+
+        void Complete(Slot& slot, int result)
+        {
+            if (result > 0) {
+                slot.written += static_cast<size_t>(result);
+                if (slot.written < slot.size) {
+                    // Short write: queue the rest (an O_DIRECT remainder stays block aligned)
+                    Queue(slot);
+                    return;
+                }
+            }
+            bool ok = result > 0;
+            if (ok && slot.direct) ok = ::ftruncate(slot.fd, static_cast<off_t>(slot.size)) == 0;
+            ::close(slot.fd);
+            if (ok) completed.Add(slot.sequence);
+            else if (firstError.empty()) firstError = "cannot write " + slot.path.string();
+            slot.fd = -1;
+            slot.busy = false;
+            slot.data.clear();
+        }
+
+        int ringFd = -1;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+        io_uring_sqe* sqes = nullptr;
+        std::uint32_t* sqTail = nullptr;
+        std::uint32_t* sqArray = nullptr;
+        std::uint32_t sqMask = 0;
+        std::uint32_t* cqHead = nullptr;
+        std::uint32_t* cqTail = nullptr;
+        std::uint32_t cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+
+        std::vector<Slot> slots;
+        unsigned int pending = 0;       // Queued but not yet submitted
+        bool registered = false;
+        size_t bufferBytes = 0;
+        bool directIo = false;
+        size_t directIoMinBytes = 0;
+        std::uint64_t queued = 0;
+        CompletedPrefix completed;
+        std::string firstError;
+    };
+#endif
+}
+
+std::unique_ptr<FrameWriter> CreateFrameWriter(const FrameWriterSettings& settings)
+{
+#ifdef HAVE_IO_URING
+    if (settings.allowUring) {
+        auto uring = std::make_unique<UringFrameWriter>();
+        // Old kernels, seccomp filters and kernel.io_uring_disabled all end up here
+        if (uring->Init(settings)) return uring;
+    }
+#endif
+    return std::make_unique<ThreadPoolFrameWriter>(settings.queueDepth);
+}
@@ -0,0 +1,41 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --- ASYNCHRONOUS FRAME WRITER ---
+// Takes encoded frames off the render thread. On Linux the writes go through io_uring
+// (batched submissions, pre-registered buffers, optional O_DIRECT); elsewhere, or when
+// the kernel refuses io_uring, a small pool of writer threads does blocking writes.
+// Either way the caller only blocks once 'queueDepth' writes are in flight.
+
+struct FrameWriterSettings {
+    unsigned int queueDepth = 8;         // Writes in flight before Write blocks
+    size_t bufferBytes = 0;              // Registered buffer size (0: no registered buffers)
+    bool directIo = false;               // Bypass the page cache for large frames (io_uring only)
+    size_t directIoMinBytes = 1 << 20;   // Smaller frames always use buffered writes
+    bool allowUring = true;              // false forces the thread-pool backend
+};
+
+class FrameWriter {
+public:
+    virtual ~FrameWriter() = default;
+    // Queues 'data' for writing to 'path' (created or truncated). Returns false once a
+    // previous write has failed; the error is reported by Flush.
+    virtual bool Write(const std::filesystem::path& path, std::vector<std::uint8_t> data) = 0;
+    // Waits until every queued write has completed. Returns false if any failed.
+    virtual bool Flush(std::string& error) = 0;
+    // Number of writes, counted in Write order from the first, that have completed
+    // successfully together with every write before them. Never waits.
+    virtual std::uint64_t Completed() = 0;
+    virtual const char* BackendName() const = 0;
+};
+
+// io_uring when available and allowed, thread pool otherwise
+std::unique_ptr<FrameWriter> CreateFrameWriter(const FrameWriterSettings& settings);
+
+#endif //FRAME_WRITER_H
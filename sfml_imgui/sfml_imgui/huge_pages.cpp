@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "huge_pages.h"
+#include "numa.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace {
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<void*, std::size_t> mappings;   // Start -> mapped length
+        HugePageStats stats;
+    };
+
+    Registry& Mappings()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    std::size_t RoundUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    HugePageMode InitialMode()
+    {
+#ifdef _WIN32
+        HugePageMode mode = HugePageMode::Off;
+#else
+        HugePageMode mode = HugePageMode::Transparent;
+#endif
+        const char* value = std::getenv(HUGE_PAGES_ENV_VAR);
+        if (!value || !*value) return mode;
+        std::string name = value;
+        if (name == "off") return HugePageMode::Off;
+        if (name == "transparent") return HugePageMode::Transparent;
+        if (name == "explicit") return HugePageMode::Explicit;
+        std::cerr << "Ignoring " << HUGE_PAGES_ENV_VAR << "=" << value << ": expected off, transparent or explicit"
+            << std::endl;
+        return mode;
+    }
+
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege enabled in the token; tried once
+    std::size_t LargePageSize()
+    {
+        static const std::size_t size = []() -> std::size_t {
+            HANDLE token = nullptr;
+            if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return 0;
+            TOKEN_PRIVILEGES privileges = {};
+            privileges.PrivilegeCount = 1;
+            privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+            bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+                AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+                GetLastError() == ERROR_SUCCESS;
+            CloseHandle(token);
+            return enabled ? GetLargePageMinimum() : 0;
+        }();
+        return size;
+    }
+
+    // Large pages are committed, and so placed, when mapped rather than on first touch. With
+    // one node (or a shard worker bound to one) they go straight to that node; with several,
+    // the ParallelFor workers of every node fill a buffer, so it stays on normal pages
+    void* MapHuge(std::size_t bytes, std::size_t& mapped)
+    {
+        if (CurrentHugePageMode() != HugePageMode::Explicit) return nullptr;
+        const std::vector<NumaNode>& nodes = NumaTopology();
+        if (nodes.size() != 1) return nullptr;
+        std::size_t page = LargePageSize();
+        if (page == 0) return nullptr;
+        mapped = RoundUp(bytes, page);
+        return VirtualAllocExNuma(GetCurrentProcess(), nullptr, mapped, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+            PAGE_READWRITE, nodes.front().id);
+    }
+
+    void Unmap(void* memory, std::size_t)
+    {
+        VirtualFree(memory, 0, MEM_RELEASE);
+    }
+
+    std::uint64_t BackedBytes(const HugePageStats& stats)
+    {
+        // Large pages are committed and locked when mapped
+        return stats.mappedBytes;
+    }
+#else
+    // "always [madvise] never": with [never] the hint does nothing, so it is not counted as huge
+    bool TransparentHugePagesUsable()
+    {
+        static const bool usable = [] {
+            std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+            std::string line;
+            return std::getline(file, line) && line.find("[never]") == std::string::npos;
+        }();
+        return usable;
+    }
+
+    // Over-maps by one huge page and trims both ends so the start is 2 MiB aligned;
+    // an unaligned mapping could only use huge pages in its aligned middle
+    void* MapTransparent(std::size_t bytes, std::size_t& mapped)
+    {
+        if (!TransparentHugePagesUsable()) return nullptr;
+        mapped = RoundUp(bytes, HUGE_PAGE_SIZE);
+        std::size_t reserve = mapped + HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+        std::uintptr_t aligned = RoundUp(start, HUGE_PAGE_SIZE);
+        if (aligned > start) munmap(raw, aligned - start);
+        std::size_t tail = reserve - (aligned - start) - mapped;
+        if (tail > 0) munmap(reinterpret_cast<void*>(aligned + mapped), tail);
+
+        void* memory = reinterpret_cast<void*>(aligned);
+        if (madvise(memory, mapped, MADV_HUGEPAGE) != 0) {
+            munmap(memory, mapped);
+            return nullptr;
+        }
+        return memory;
+    }
+
+    void* MapHuge(std::size_t bytes, std::size_t& mapped)
+    {
+        HugePageMode mode = CurrentHugePageMode();
+        if (mode == HugePageMode::Explicit) {
+            // Pages are reserved here but placed on first touch, like normal ones
+            mapped = RoundUp(bytes, HUGE_PAGE_SIZE);
+            void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED) return memory;
+        }
+        if (mode != HugePageMode::Off) return MapTransparent(bytes, mapped);
+        return nullptr;
+    }
+
+    void Unmap(void* memory, std::size_t mapped)
+    {
+        munmap(memory, mapped);
+    }
+
+    std::uint64_t BackedBytes(const HugePageStats&)
+    {
+        std::ifstream file("/proc/self/smaps_rollup");
+        std::uint64_t total = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.rfind("AnonHugePages:", 0) == 0 || line.rfind("Private_Hugetlb:", 0) == 0 ||
+                line.rfind("Shared_Hugetlb:", 0) == 0) {
+                std::istringstream fields(line.substr(line.find(':') + 1));
+                std::uint64_t kb = 0;
+                fields >> kb;
+                total += kb * 1024;
+            }
+        }
+        return total;
+    }
+#endif
+}
+
+HugePageMode CurrentHugePageMode()
+{
+    static const HugePageMode mode = InitialMode();
+    return mode;
+}
+
+const char* HugePageModeName(HugePageMode mode)
+{
+    switch (mode) {
+    case HugePageMode::Transparent: return "transparent";
+    case HugePageMode::Explicit: return "explicit";
+    default: return "off";
+    }
+}
+
+void* AllocatePixelMemory(std::size_t bytes)
+{
+    if (bytes < HUGE_PAGE_THRESHOLD) return ::operator new(bytes);
+
+    std::size_t mapped = 0;
+    void* memory = MapHuge(bytes, mapped);
+
+    Registry& registry = Mappings();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.stats.largeAllocations++;
+        if (memory) {
+            registry.mappings[memory] = mapped;
+            registry.stats.hugeAllocations++;
+            registry.stats.mappedBytes += mapped;
+            registry.stats.peakMappedBytes = std::max(registry.stats.peakMappedBytes, registry.stats.mappedBytes);
+        }
+        else {
+            registry.stats.fallbackAllocations++;
+        }
+    }
+    return memory ? memory : ::operator new(bytes);
+}
+
+void FreePixelMemory(void* memory, std::size_t bytes)
+{
+    if (!memory) return;
+    if (bytes >= HUGE_PAGE_THRESHOLD) {
+        Registry& registry = Mappings();
+        std::size_t mapped = 0;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto it = registry.mappings.find(memory);
+            if (it != registry.mappings.end()) {
+                mapped = it->second;
+                registry.mappings.erase(it);
+                registry.stats.mappedBytes -= mapped;
+            }
+        }
+        if (mapped > 0) {
+            Unmap(memory, mapped);
+            return;
+        }
+    }
+    ::operator delete(memory);
+}
+
+HugePageStats GetHugePageStats()
+{
+    Registry& registry = Mappings();
+    HugePageStats stats;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        stats = registry.stats;
+    }
+    stats.backedBytes = BackedBytes(stats);
+    return stats;
+}
@@ -0,0 +1,53 @@
+#ifndef HUGE_PAGES_H
+#define HUGE_PAGES_H
+
+#include <cstddef>
+#include <cstdint>
+
+// --- HUGE PAGES ---
+// A 4K/8K RGBA frame spans thousands of 4 KiB pages, and rotated or perspective sampling
+// walks it in an order the TLB cannot cover. Pixel buffers (PixelBuffer, see
+// pixel_buffer.h) of at least HUGE_PAGE_THRESHOLD bytes are therefore mapped on 2 MiB pages
+// where the OS allows it:
+//   transparent  Linux: a 2 MiB aligned anonymous mapping with madvise(MADV_HUGEPAGE);
+//                the kernel backs it with huge pages on first touch when it has them
+//                (Windows has no equivalent and uses the heap)
+//   explicit     Linux: hugetlbfs pages (MAP_HUGETLB, needs vm.nr_hugepages), falling
+//                back to transparent; Windows: large pages (needs the "Lock pages in
+//                memory" privilege), only when the process runs on a single NUMA node
+//   off          the C++ heap
+// Anything that fails falls back to the next option and finally to the heap, so buffers
+// are always allocated. Smaller buffers always come from the heap.
+// The default is transparent on Linux and off on Windows; the environment variable
+// overrides it (e.g. TRANSITIONS_HUGE_PAGES=explicit).
+
+const std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+const std::size_t HUGE_PAGE_THRESHOLD = std::size_t(2) << 20;
+const char* const HUGE_PAGES_ENV_VAR = "TRANSITIONS_HUGE_PAGES";
+
+enum class HugePageMode { Off = 0, Transparent = 1, Explicit = 2 };
+
+// Mode in effect, read from the environment on first use
+HugePageMode CurrentHugePageMode();
+const char* HugePageModeName(HugePageMode mode);
+
+// Backing store of PixelBuffer. Memory is not initialized. Heap and Linux mappings are
+// untouched until first written, so NUMA first-touch placement still applies; Windows
+// large pages are committed on their node when allocated, hence the single-node rule.
+void* AllocatePixelMemory(std::size_t bytes);
+void FreePixelMemory(void* memory, std::size_t bytes);
+
+struct HugePageStats {
+    std::uint64_t largeAllocations = 0;     // Buffers at or above the threshold
+    std::uint64_t hugeAllocations = 0;      // ... mapped for huge pages
+    std::uint64_t fallbackAllocations = 0;  // ... that had to take normal pages
+    std::uint64_t mappedBytes = 0;          // Huge-page mappings currently live
+    std::uint64_t peakMappedBytes = 0;
+    // Process memory the OS actually backs with huge pages (Linux: AnonHugePages plus
+    // hugetlb from /proc/self/smaps_rollup; Windows: the large-page mappings)
+    std::uint64_t backedBytes = 0;
+};
+
+HugePageStats GetHugePageStats();
+
+#endif //HUGE_PAGES_H
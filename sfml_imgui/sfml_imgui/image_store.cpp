@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "image_store.h"
+#include "parallel.h"
+#include "qoi.h"
+#include "large_image.h"
+#include <algorithm>
+#include <atomic>
+
+int ImageStore::AddFile(const std::filesystem::path& path, std::string* error)
+{
+    sf::Image loaded;
+    if (!LoadInputImage(path, loaded, error)) return -1;
+    return Add(loaded.getPixelsPtr(), loaded.getSize());
+}
+
+int ImageStore::Add(const std::uint8_t* rgba, sf::Vector2u size)
+{
+    unsigned int stripes = (size.y + STRIPE_ROWS - 1) / STRIPE_ROWS;
+    std::vector<std::vector<std::uint8_t>> encoded(stripes);
+    size_t rowBytes = static_cast<size_t>(size.x) * 4;
+
+    ParallelFor(stripes, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            unsigned int y0 = k * STRIPE_ROWS;
+            unsigned int rows = std::min(STRIPE_ROWS, size.y - y0);
+            encoded[k] = EncodeQoi(rgba + y0 * rowBytes, size.x, rows);
+        }
+    }, 1);
+
+    Compressed c;
+    c.size = size;
+    size_t total = 0;
+    for (const auto& e : encoded) total += e.size();
+    c.data.reserve(total);
+    for (const auto& e : encoded) {
+        c.data.insert(c.data.end(), e.begin(), e.end());
+        c.stripeEnds.push_back(c.data.size());
+    }
+
+    stats.rawBytes += rowBytes * size.y;
+    stats.compressedBytes += c.data.size();
+    images.push_back(std::move(c));
+    return static_cast<int>(images.size()) - 1;
+}
+
+std::shared_ptr<const DecodedImage> ImageStore::Get(int id)
+{
+    if (id < 0 || id >= static_cast<int>(images.size())) return nullptr;
+
+    auto found = index.find(id);
+    if (found != index.end()) {
+        stats.hits++;
+        lru.splice(lru.begin(), lru, found->second);
+        return found->second->image;
+    }
+
+    stats.misses++;
+    const Compressed& c = images[id];
+    auto image = std::make_shared<DecodedImage>();
+    image->size = c.size;
+    size_t bytes = static_cast<size_t>(c.size.x) * c.size.y * 4;
+    // Prefer a pooled buffer that already has the capacity; resize never shrinks it
+    auto fit = std::find_if(pool.begin(), pool.end(), [&](const auto& b) { return b.capacity() >= bytes; });
+    if (fit == pool.end() && !pool.empty()) fit = pool.begin();
+    if (fit != pool.end()) {
+        image->pixels = std::move(*fit);
+        pool.erase(fit);
+    }
+    image->pixels.resize(bytes);
+
+    unsigned int stripes = static_cast<unsigned int>(c.stripeEnds.size());
+    size_t rowBytes = static_cast<size_t>(c.size.x) * 4;
+    std::atomic<bool> ok = true;
+    ParallelFor(stripes, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            size_t from = k == 0 ? 0 : c.stripeEnds[k - 1];
+            unsigned int y0 = k * STRIPE_ROWS;
+            unsigned int rows = std::min(STRIPE_ROWS, c.size.y - y0);
+            if (!DecodeQoiInto(c.data.data() + from, c.stripeEnds[k] - from, image->pixels.data() + y0 * rowBytes,
+                c.size.x, rows)) ok = false;
+        }
+    }, 1);
+    if (!ok) return nullptr;
+
+    lru.push_front(Entry{ id, image });
+    index[id] = lru.begin();
+    stats.decodedBytes += bytes;
+    Evict();
+    return image;
+}
+
+void ImageStore::Evict()
+{
+    // The most recent image always stays, even when it alone exceeds the budget
+    while (stats.decodedBytes > decodedBudget && lru.size() > 1) {
+        Entry& victim = lru.back();
+        stats.decodedBytes -= victim.image->pixels.size();
+        // Buffers still held by a caller are left to them
+        if (victim.image.use_count() == 1 && pool.size() < MAX_POOLED_BUFFERS)
+            pool.push_back(std::move(victim.image->pixels));
+        index.erase(victim.id);
+        lru.pop_back();
+    }
+}
+
+ImageStore::Stats ImageStore::GetStats() const
+{
+    Stats s = stats;
+    s.images = images.size();
+    return s;
+}
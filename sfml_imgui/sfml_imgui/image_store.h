@@ -0,0 +1,78 @@
+#ifndef IMAGE_STORE_H
+#define IMAGE_STORE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+// Tightly packed RGBA8 pixels handed out by the ImageStore
+struct DecodedImage {
+    sf::Vector2u size;
+    std::vector<std::uint8_t> pixels;
+};
+
+// Keeps a large set of images (slideshows) losslessly compressed in memory and
+// decompresses them on demand. Each image is split into bands of STRIPE_ROWS rows that
+// are QOI-coded independently, so compression and decompression run on all cores.
+// An LRU of decompressed images, bounded in bytes, sits in front of the compressed
+// store; evicted pixel buffers go to a small pool and are reused by the next miss.
+// Not thread safe.
+class ImageStore {
+public:
+    static constexpr unsigned int STRIPE_ROWS = 128;
+    static constexpr size_t DEFAULT_DECODED_BUDGET = size_t(512) << 20;
+    static constexpr size_t MAX_POOLED_BUFFERS = 4;
+
+    struct Stats {
+        size_t images = 0;
+        size_t rawBytes = 0;           // Everything decompressed
+        size_t compressedBytes = 0;
+        size_t decodedBytes = 0;       // Currently held by the LRU
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    explicit ImageStore(size_t decodedBudget = DEFAULT_DECODED_BUDGET) : decodedBudget(decodedBudget) {}
+
+    // Decodes an image file and stores it compressed. Returns its id, or -1 (and fills 'error').
+    int AddFile(const std::filesystem::path& path, std::string* error = nullptr);
+    // Stores straight-alpha pixels compressed and returns the id
+    int Add(const std::uint8_t* rgba, sf::Vector2u size);
+
+    size_t Count() const { return images.size(); }
+    sf::Vector2u Size(int id) const { return images[id].size; }
+
+    // Decompressed pixels of image 'id'. The returned image stays valid while held,
+    // even after the LRU drops it. Returns nullptr for corrupt data or a bad id.
+    std::shared_ptr<const DecodedImage> Get(int id);
+
+    Stats GetStats() const;
+
+private:
+    struct Compressed {
+        sf::Vector2u size;
+        std::vector<size_t> stripeEnds;   // End offset of every stripe in 'data'
+        std::vector<std::uint8_t> data;
+    };
+
+    struct Entry {
+        int id;
+        std::shared_ptr<DecodedImage> image;
+    };
+
+    void Evict();
+
+    size_t decodedBudget;
+    std::vector<Compressed> images;
+    std::list<Entry> lru;   // Most recently used first
+    std::unordered_map<int, std::list<Entry>::iterator> index;
+    std::vector<std::vector<std::uint8_t>> pool;
+    Stats stats;
+};
+
+#endif //IMAGE_STORE_H
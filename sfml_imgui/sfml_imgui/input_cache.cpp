@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "input_cache.h"
+#include "transitions.h"
+#include <algorithm>
+#include <atomic>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::atomic<GraphKey> nextSalt{ 1 };
+}
+
+InputCache::InputCache(GraphMemo& memo)
+    : memo(memo), salt(HashString("input-cache", nextSalt++))
+{
+}
+
+InputCache::~InputCache()
+{
+    Clear();
+}
+
+std::shared_ptr<PreparedInput> InputCache::Acquire(const fs::path& path, std::string* error)
+{
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    if (ec) canonical = path;
+    if (!fs::is_regular_file(canonical, ec)) {
+        if (error) *error = "cannot read " + canonical.string();
+        return nullptr;
+    }
+
+    bool premultiply = premultipliedPipeline;
+    GraphKey key = HashCombine(HashCombine(salt, InputSourceKey(canonical)), premultiply);
+    if (auto found = memo.Find(key)) {
+        stats.hits++;
+        // Only this cache stores under its salt, and it stores mutable inputs
+        return std::const_pointer_cast<PreparedInput>(std::static_pointer_cast<const PreparedInput>(found));
+    }
+
+    stats.misses++;
+    std::uint64_t sourceKey = 0;
+    bool decoded = false;
+    std::shared_ptr<const sf::Image> source = DecodeInputSource(canonical, sourceKey, &decoded);
+    if (!source) {
+        if (error) *error = "cannot decode " + canonical.string();
+        return nullptr;
+    }
+    if (!decoded) stats.reprepared++;
+
+    auto input = std::make_shared<PreparedInput>();
+    input->source = std::move(source);
+    input->sourceKey = sourceKey;
+    PrepareInput(*input);
+    if (!input->IsLoaded()) {
+        if (error) *error = "cannot prepare " + canonical.string();
+        return nullptr;
+    }
+    memo.Store(key, input, PreparedInputBytes(*input));
+
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [&](GraphKey k) { return !memo.Contains(k); }), keys.end());
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+    return input;
+}
+
+void InputCache::Clear()
+{
+    for (GraphKey key : keys) memo.Erase(key);
+    keys.clear();
+}
+
+InputCache::Stats InputCache::GetStats() const
+{
+    Stats s = stats;
+    s.entries = static_cast<size_t>(std::count_if(keys.begin(), keys.end(), [&](GraphKey k) { return memo.Contains(k); }));
+    return s;
+}
@@ -0,0 +1,47 @@
+#ifndef INPUT_CACHE_H
+#define INPUT_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "prepared_input.h"
+#include "render_graph.h"
+
+// Keeps recently used inputs prepared across jobs. The entries live in the render graph
+// memo, next to the decode results they share their pixels with, so one byte budget and
+// one LRU decide what stays. Entries are keyed by the decode node's key (path, size and
+// modification time) and the alpha mode: a changed file is a new key, and a change of
+// alpha mode only re-runs preparation on the memoized decode.
+// Prepared inputs hold GPU textures and are handed out mutable, so every cache keys its
+// entries apart from other caches; a thread uses its own cache.
+class InputCache {
+public:
+    struct Stats {
+        size_t entries = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t reprepared = 0;   // Misses whose decode came from the memo
+    };
+
+    explicit InputCache(GraphMemo& memo = SharedGraphMemo());
+    ~InputCache();
+    InputCache(const InputCache&) = delete;
+    InputCache& operator=(const InputCache&) = delete;
+
+    // Returns nullptr (and fills 'error') when the file cannot be decoded
+    std::shared_ptr<PreparedInput> Acquire(const std::filesystem::path& path, std::string* error = nullptr);
+
+    // Drops this cache's entries from the memo
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    GraphMemo& memo;
+    GraphKey salt;
+    std::vector<GraphKey> keys;   // Entries stored by this cache, possibly evicted since
+    Stats stats;
+};
+
+#endif //INPUT_CACHE_H
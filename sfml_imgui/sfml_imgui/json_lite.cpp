@@ -0,0 +1,231 @@
+#include "pch.h"
+#include "json_lite.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+    void SkipSpace(const std::string& s, size_t& i)
+    {
+        while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
+    }
+
+    // Four hex digits of a \u escape; strtoul alone would also take signs, spaces and short input
+    bool ParseHex4(const std::string& s, size_t& i, unsigned long& code)
+    {
+        if (i + 4 > s.size()) return false;
+        for (size_t k = i; k < i + 4; ++k)
+            if (!std::isxdigit(static_cast<unsigned char>(s[k]))) return false;
+        code = std::strtoul(s.substr(i, 4).c_str(), nullptr, 16);
+        i += 4;
+        return true;
+    }
+
+    bool ParseString(const std::string& s, size_t& i, std::string& out)
+    {
+        if (i >= s.size() || s[i] != '"') return false;
+        ++i;
+        out.clear();
+        while (i < s.size()) {
+            char c = s[i++];
+            if (c == '"') return true;
+            if (c != '\\') { out += c; continue; }
+            if (i >= s.size()) return false;
+            char e = s[i++];
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned long code = 0;
+                if (!ParseHex4(s, i, code)) return false;
+                // Characters outside the BMP come as a surrogate pair and make one code point
+                if (code >= 0xDC00 && code <= 0xDFFF) return false;
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    unsigned long low = 0;
+                    if (i + 2 > s.size() || s[i] != '\\' || s[i + 1] != 'u') return false;
+                    i += 2;
+                    if (!ParseHex4(s, i, low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                // Encode the code point as UTF-8 (paths are the only realistic user)
+                if (code < 0x80) out += static_cast<char>(code);
+                else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else if (code < 0x10000) {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else {
+                    out += static_cast<char>(0xF0 | (code >> 18));
+                    out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+}
+
+bool ParseFlatJson(const std::string& text, JsonObject& out)
+{
+    out.clear();
+    size_t i = 0;
+    SkipSpace(text, i);
+    if (i >= text.size() || text[i] != '{') return false;
+    ++i;
+    SkipSpace(text, i);
+    if (i < text.size() && text[i] == '}') return true;
+
+    while (i < text.size()) {
+        std::string key, value;
+        SkipSpace(text, i);
+        if (!ParseString(text, i, key)) return false;
+        SkipSpace(text, i);
+        if (i >= text.size() || text[i] != ':') return false;
+        ++i;
+        SkipSpace(text, i);
+        if (i >= text.size()) return false;
+
+        bool quoted = text[i] == '"';
+        if (quoted) {
+            if (!ParseString(text, i, value)) return false;
+        }
+        else if (text[i] == '{' || text[i] == '[') {
+            return false;
+        }
+        else {
+            size_t start = i;
+            while (i < text.size() && text[i] != ',' && text[i] != '}' && !std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+            value = text.substr(start, i - start);
+            if (value.empty()) return false;
+        }
+        // null means "not given", so every getter falls back instead of reading the token as
+        // text (an "output": null job would otherwise write into a folder named null)
+        if (quoted || value != "null") out[key] = value;
+        else out.erase(key);
+
+        SkipSpace(text, i);
+        if (i >= text.size()) return false;
+        if (text[i] == '}') return true;
+        if (text[i] != ',') return false;
+        ++i;
+    }
+    return false;
+}
+
+std::string JsonGetString(const JsonObject& obj, const std::string& key, const std::string& fallback)
+{
+    auto it = obj.find(key);
+    return it == obj.end() ? fallback : it->second;
+}
+
+long long JsonGetInt(const JsonObject& obj, const std::string& key, long long fallback)
+{
+    auto it = obj.find(key);
+    if (it == obj.end()) return fallback;
+    char* end = nullptr;
+    long long v = std::strtoll(it->second.c_str(), &end, 10);
+    return (end == it->second.c_str()) ? fallback : v;
+}
+
+double JsonGetDouble(const JsonObject& obj, const std::string& key, double fallback)
+{
+    auto it = obj.find(key);
+    if (it == obj.end()) return fallback;
+    char* end = nullptr;
+    double v = std::strtod(it->second.c_str(), &end);
+    return (end == it->second.c_str()) ? fallback : v;
+}
+
+bool JsonGetBool(const JsonObject& obj, const std::string& key, bool fallback)
+{
+    auto it = obj.find(key);
+    if (it == obj.end()) return fallback;
+    if (it->second == "true" || it->second == "1") return true;
+    if (it->second == "false" || it->second == "0") return false;
+    return fallback;
+}
+
+std::string JsonEscape(const std::string& text)
+{
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+void JsonWriter::Key(const std::string& key)
+{
+    if (!body.empty()) body += ',';
+    body += '"' + JsonEscape(key) + "\":";
+}
+
+JsonWriter& JsonWriter::Add(const std::string& key, const std::string& value)
+{
+    Key(key);
+    body += '"' + JsonEscape(value) + '"';
+    return *this;
+}
+
+JsonWriter& JsonWriter::Add(const std::string& key, const char* value)
+{
+    return Add(key, std::string(value));
+}
+
+JsonWriter& JsonWriter::Add(const std::string& key, long long value)
+{
+    Key(key);
+    body += std::to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Add(const std::string& key, double value)
+{
+    Key(key);
+    // JSON has no NaN or infinity; a 0/0 rate or a failed measurement reads as null
+    if (!std::isfinite(value)) {
+        body += "null";
+        return *this;
+    }
+    std::ostringstream ss;
+    ss << value;
+    body += ss.str();
+    return *this;
+}
+
+JsonWriter& JsonWriter::Add(const std::string& key, bool value)
+{
+    Key(key);
+    body += value ? "true" : "false";
+    return *this;
+}
@@ -0,0 +1,39 @@
+#ifndef JSON_LITE_H
+#define JSON_LITE_H
+
+#include <map>
+#include <string>
+
+// Just enough JSON for the line-based job protocols: one flat object per line,
+// values are strings, numbers, true/false or null. Nested objects and arrays are rejected.
+// Values are stored as text (strings already unescaped); null values are left out, so the
+// getters return their fallback for them.
+using JsonObject = std::map<std::string, std::string>;
+
+bool ParseFlatJson(const std::string& text, JsonObject& out);
+
+std::string JsonGetString(const JsonObject& obj, const std::string& key, const std::string& fallback = "");
+long long JsonGetInt(const JsonObject& obj, const std::string& key, long long fallback = 0);
+double JsonGetDouble(const JsonObject& obj, const std::string& key, double fallback = 0.0);
+bool JsonGetBool(const JsonObject& obj, const std::string& key, bool fallback = false);
+
+// Builds a single-line flat JSON object
+class JsonWriter {
+public:
+    JsonWriter& Add(const std::string& key, const std::string& value);
+    JsonWriter& Add(const std::string& key, const char* value);
+    JsonWriter& Add(const std::string& key, long long value);
+    JsonWriter& Add(const std::string& key, int value) { return Add(key, static_cast<long long>(value)); }
+    JsonWriter& Add(const std::string& key, unsigned int value) { return Add(key, static_cast<long long>(value)); }
+    JsonWriter& Add(const std::string& key, double value);
+    JsonWriter& Add(const std::string& key, bool value);
+    std::string str() const { return "{" + body + "}"; }
+
+private:
+    void Key(const std::string& key);
+    std::string body;
+};
+
+std::string JsonEscape(const std::string& text);
+
+#endif //JSON_LITE_H
@@ -0,0 +1,425 @@
+#include "pch.h"
+#include "kernel_bench.h"
+#include "alpha.h"
+#include "clip_source.h"
+#include "cpu_kernels.h"
+#include "dither.h"
+#include "frame_export.h"
+#include "json_lite.h"
+#include "parallel.h"
+#include "perf_counters.h"
+#include "pixel_buffer.h"
+#include "qoi.h"
+#include "supersample.h"
+#include "transitions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fstream>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The DRAM working set is four times the last-level cache, within these bounds
+    const std::size_t MIN_DRAM_BYTES = std::size_t(64) << 20;
+    const std::size_t MAX_DRAM_BYTES = std::size_t(512) << 20;
+    // The encoders take seconds per DRAM-sized image; they stop at an 8K frame
+    const std::uint64_t MAX_ENCODER_PIXELS = 7680ull * 4320;
+    const double BATCH_SECONDS = 0.005;   // Calls per timed batch are chosen to take about this long
+    const int TIMED_BATCHES = 5;
+
+    struct CacheSizes {
+        std::size_t l1 = std::size_t(32) << 10;
+        std::size_t l2 = std::size_t(1) << 20;
+        std::size_t l3 = 0;              // 0: no third level
+        bool detected = false;
+    };
+
+    // Data and unified caches of the first CPU; defaults when the OS does not say
+    CacheSizes DetectCacheSizes()
+    {
+        CacheSizes caches;
+        auto set = [&](int level, std::size_t bytes) {
+            if (bytes == 0) return;
+            if (level == 1) caches.l1 = bytes;
+            else if (level == 2) caches.l2 = bytes;
+            else if (level == 3) caches.l3 = bytes;
+            caches.detected = true;
+        };
+#ifdef _WIN32
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+            for (const auto& entry : info) {
+                if (entry.Relationship != RelationCache || entry.Cache.Type == CacheInstruction) continue;
+                set(entry.Cache.Level, entry.Cache.Size);
+            }
+        }
+#else
+        for (int index = 0; index < 16; ++index) {
+            std::string base = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+            std::ifstream levelFile(base + "level"), typeFile(base + "type"), sizeFile(base + "size");
+            int level = 0;
+            std::string type, size;
+            if (!(levelFile >> level) || !(typeFile >> type) || !(sizeFile >> size)) break;
+            if (type == "Instruction") continue;
+            char* suffix = nullptr;
+            std::size_t bytes = std::strtoull(size.c_str(), &suffix, 10);
+            if (*suffix == 'K') bytes <<= 10;
+            else if (*suffix == 'M') bytes <<= 20;
+            else if (*suffix == 'G') bytes <<= 30;
+            set(level, bytes);
+        }
+#endif
+        return caches;
+    }
+
+    const char* LevelName(std::size_t bytes, const CacheSizes& caches)
+    {
+        if (bytes <= caches.l1) return "L1";
+        if (bytes <= caches.l2) return "L2";
+        if (caches.l3 != 0 && bytes <= caches.l3) return "L3";
+        return "DRAM";
+    }
+
+    // Smooth gradients with a little noise and varying alpha: compresses like a photo,
+    // unlike random bytes, and takes every path of the alpha kernels
+    PixelBuffer TestPattern(unsigned int w, unsigned int h, std::uint32_t seed)
+    {
+        PixelBuffer rgba;
+        rgba.resize(static_cast<size_t>(w) * h * 4);
+        std::uint32_t state = seed;
+        for (unsigned int y = 0; y < h; ++y) {
+            for (unsigned int x = 0; x < w; ++x) {
+                state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+                int noise = static_cast<int>(state & 15) - 8;
+                std::uint8_t* p = &rgba[(static_cast<size_t>(y) * w + x) * 4];
+                p[0] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(x * 255 / std::max(1u, w - 1)) + noise, 0, 255));
+                p[1] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(y * 255 / std::max(1u, h - 1)) + noise, 0, 255));
+                p[2] = static_cast<std::uint8_t>(((x + y) >> 2) + noise);
+                p[3] = static_cast<std::uint8_t>((x / 64 + y / 64) % 4 == 0 ? 255 : 96 + ((x ^ y) & 127));
+            }
+        }
+        return rgba;
+    }
+
+    struct BenchBuffers {
+        PixelBuffer a, b, mask, out;
+        std::vector<std::uint16_t> wide;
+        sf::Image image;
+    };
+
+    struct BenchCase {
+        const char* kernel;
+        double bytesPerPixel;      // Compulsory traffic per output pixel, read + written
+        bool parallel;             // Runs on ParallelFor
+        std::uint64_t maxPixels;   // 0: any size
+        // Allocates and fills the buffers for a w x h output; the returned call runs the kernel once
+        std::function<std::function<void()>(unsigned int w, unsigned int h)> prepare;
+    };
+
+    std::vector<BenchCase> BenchCases()
+    {
+        const int rgba = static_cast<int>(PixelLayout::Rgba8);
+        std::vector<BenchCase> cases;
+
+        cases.push_back({ "luma", 5.0, false, 0, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            size_t n = static_cast<size_t>(w) * h;
+            buffers->a = TestPattern(w, h, 1);
+            buffers->out.resize(n);
+            return std::function<void()>([buffers, n] { CpuKernels().luma(buffers->a.data(), buffers->out.data(), n); });
+        } });
+
+        cases.push_back({ "luma-select", 13.0, false, 0, [rgba](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            size_t n = static_cast<size_t>(w) * h;
+            buffers->a = TestPattern(w, h, 1);
+            buffers->b = TestPattern(w, h, 2);
+            buffers->mask.resize(n);
+            CpuKernels().luma(buffers->b.data(), buffers->mask.data(), n);
+            buffers->out.resize(n * 4);
+            int threshold = LumaWipeThreshold(0.5f);
+            return std::function<void()>([buffers, n, threshold, rgba] {
+                CpuKernels().select[rgba](buffers->a.data(), buffers->b.data(), buffers->mask.data(),
+                    buffers->out.data(), n, threshold);
+            });
+        } });
+
+        // Radius 2, the middle of the specialized instances the blur transition uses
+        cases.push_back({ "blur-rows", 8.0, false, 0, [rgba](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            buffers->a = TestPattern(w, h, 1);
+            buffers->out.resize(buffers->a.size());
+            return std::function<void()>([buffers, w, h, rgba] {
+                CpuKernels().blurRows[rgba][BlurRadiusSlot(2)](buffers->a.data(), buffers->out.data(),
+                    static_cast<int>(w), static_cast<int>(h), 2);
+            });
+        } });
+
+        cases.push_back({ "blur-columns", 8.0, false, 0, [rgba](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            buffers->a = TestPattern(w, h, 1);
+            buffers->out.resize(buffers->a.size());
+            buffers->wide.resize(static_cast<size_t>(w) * 4);
+            return std::function<void()>([buffers, w, h, rgba] {
+                const int wide = static_cast<int>(BlurOutput::Wide);
+                CpuKernels().blurColumns[rgba][wide][BlurRadiusSlot(2)](buffers->a.data(), buffers->out.data(),
+                    buffers->wide.data(), static_cast<int>(w), static_cast<int>(h), 2,
+                    [](const std::uint16_t* row, std::uint8_t* dst, int pixels, int y) {
+                        QuantizeRowDithered(row, dst, static_cast<unsigned int>(pixels), 0, static_cast<unsigned int>(y));
+                    });
+            });
+        } });
+
+        // 2x supersampled source: 16 bytes read per output pixel
+        for (DownsampleFilter filter : { DownsampleFilter::Box, DownsampleFilter::Lanczos3 }) {
+            const char* name = filter == DownsampleFilter::Box ? "downsample-box" : "downsample-lanczos";
+            cases.push_back({ name, 20.0, true, 0, [filter](unsigned int w, unsigned int h) {
+                auto buffers = std::make_shared<BenchBuffers>();
+                buffers->a = TestPattern(w * 2, h * 2, 1);
+                buffers->out.resize(static_cast<size_t>(w) * h * 4);
+                return std::function<void()>([buffers, w, h, filter] {
+                    DownsampleTile(buffers->a.data(), static_cast<size_t>(w) * 8, w * 2, h * 2, { 0, 0 }, 2, filter, true,
+                        buffers->out.data(), static_cast<size_t>(w) * 4, { 0, 0 }, { w, h });
+                });
+            } });
+        }
+
+        // Halving: every other source row is read in full, 8 bytes per output pixel
+        cases.push_back({ "resize", 12.0, false, 0, [rgba](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            buffers->a = TestPattern(w * 2, h * 2, 1);
+            buffers->out.resize(static_cast<size_t>(w) * h * 4);
+            return std::function<void()>([buffers, w, h, rgba] {
+                CpuKernels().resize[rgba](buffers->a.data(), w * 2, h * 2, buffers->out.data(), w, h);
+            });
+        } });
+
+        // Includes copying the result into the returned image, as every caller gets it
+        cases.push_back({ "premultiply", 16.0, true, 0, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            PixelBuffer pattern = TestPattern(w, h, 1);
+            buffers->image = sf::Image({ w, h }, pattern.data());
+            return std::function<void()>([buffers] { PremultiplyAlpha(buffers->image); });
+        } });
+
+        // In place; alpha stays the same from call to call, so every call takes the same paths
+        cases.push_back({ "unpremultiply", 8.0, false, 0, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            buffers->out = TestPattern(w, h, 1);
+            size_t n = static_cast<size_t>(w) * h;
+            return std::function<void()>([buffers, n] { UnpremultiplyAlpha(buffers->out.data(), n); });
+        } });
+
+        // 4:2:0, the usual Y4M layout: 1.5 bytes in, 4 out
+        cases.push_back({ "yuv420-to-rgba", 5.5, false, 0, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            int chromaW = static_cast<int>((w + 1) / 2), chromaH = static_cast<int>((h + 1) / 2);
+            PixelBuffer pattern = TestPattern(w, h, 1);
+            buffers->a.resize(static_cast<size_t>(w) * h + 2 * static_cast<size_t>(chromaW) * chromaH);
+            for (size_t i = 0; i < buffers->a.size(); ++i) buffers->a[i] = pattern[i % pattern.size()];
+            buffers->out.resize(static_cast<size_t>(w) * h * 4);
+            return std::function<void()>([buffers, w, h, chromaW, chromaH] {
+                const std::uint8_t* y = buffers->a.data();
+                const std::uint8_t* u = y + static_cast<size_t>(w) * h;
+                const std::uint8_t* v = u + static_cast<size_t>(chromaW) * chromaH;
+                ConvertYuvToRgba(y, u, v, nullptr, static_cast<int>(w), static_cast<int>(h), chromaW, 1, 1,
+                    buffers->out.data());
+            });
+        } });
+
+        // Whole encoders: the PNG one is SFML's (filtering and deflate in one call)
+        cases.push_back({ "png-encode", 4.0, false, MAX_ENCODER_PIXELS, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            PixelBuffer pattern = TestPattern(w, h, 1);
+            buffers->image = sf::Image({ w, h }, pattern.data());
+            return std::function<void()>([buffers] { EncodeFrame(buffers->image, ExportSettings()); });
+        } });
+
+        cases.push_back({ "qoi-encode", 4.0, false, MAX_ENCODER_PIXELS, [](unsigned int w, unsigned int h) {
+            auto buffers = std::make_shared<BenchBuffers>();
+            buffers->a = TestPattern(w, h, 1);
+            return std::function<void()>([buffers, w, h] { EncodeQoi(buffers->a.data(), w, h); });
+        } });
+        return cases;
+    }
+
+    double SecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Fastest time of one call over a few batches, after a warm-up call that also sizes
+    // the batches
+    double TimeCall(const std::function<void()>& call, int& iterations)
+    {
+        auto start = Clock::now();
+        call();
+        double first = SecondsSince(start);
+        iterations = std::max(1, static_cast<int>(BATCH_SECONDS / std::max(first, 1e-9)));
+        int batches = first > 0.2 ? 2 : TIMED_BATCHES;
+
+        double best = first;
+        for (int b = 0; b < batches; ++b) {
+            start = Clock::now();
+            for (int i = 0; i < iterations; ++i) call();
+            best = std::min(best, SecondsSince(start) / iterations);
+        }
+        return best;
+    }
+
+    // Cycles and instructions per call over every thread that ran it (one extra batch,
+    // counted separately so reading the counters does not slow the timed batches)
+    bool CountCall(const std::function<void()>& call, int iterations, bool parallel, std::uint64_t pixels,
+        double& cycles, double& instructions)
+    {
+        std::string status;
+        if (!EnableKernelCounters(status)) {
+            DisableKernelCounters();
+            return false;
+        }
+        {
+            // ParallelFor kernels have scopes of their own on every worker
+            std::optional<KernelCounterScope> scope;
+            if (!parallel) scope.emplace("bench", pixels * iterations);
+            for (int i = 0; i < iterations; ++i) call();
+        }
+        DisableKernelCounters();
+
+        const int cycleEvent = static_cast<int>(CounterEvent::Cycles);
+        const int instructionEvent = static_cast<int>(CounterEvent::Instructions);
+        std::uint64_t cycleSum = 0, instructionSum = 0;
+        bool counted = false;
+        for (const KernelCounterTotals& totals : TakeKernelCounterTotals()) {
+            if (!totals.counted[cycleEvent]) continue;
+            counted = true;
+            cycleSum += totals.values[cycleEvent];
+            instructionSum += totals.values[instructionEvent];
+        }
+        cycles = static_cast<double>(cycleSum) / iterations;
+        instructions = static_cast<double>(instructionSum) / iterations;
+        return counted && cycleSum > 0;
+    }
+
+    // memcpy between two buffers of 'bytes' each, in 1 MiB blocks over ParallelFor when
+    // 'parallel'. GB/s of bytes read plus bytes written.
+    double MeasureCopyBandwidth(std::size_t bytes, bool parallel)
+    {
+        const std::size_t BLOCK = std::size_t(1) << 20;
+        PixelBuffer src, dst;
+        src.resize(bytes);
+        dst.resize(bytes);
+        std::memset(src.data(), 1, bytes);
+        std::memset(dst.data(), 0, bytes);
+        unsigned int blocks = static_cast<unsigned int>((bytes + BLOCK - 1) / BLOCK);
+
+        auto copy = [&] {
+            if (!parallel) {
+                std::memcpy(dst.data(), src.data(), bytes);
+                return;
+            }
+            ParallelFor(blocks, [&](unsigned int begin, unsigned int end) {
+                std::size_t first = begin * BLOCK, last = std::min(bytes, end * BLOCK);
+                std::memcpy(dst.data() + first, src.data() + first, last - first);
+            }, 1);
+        };
+        int iterations = 0;
+        return 2.0 * bytes / TimeCall(copy, iterations) / 1e9;
+    }
+}
+
+int RunKernelBench(const std::string& filter)
+{
+    std::vector<BenchCase> cases;
+    for (BenchCase& c : BenchCases())
+        if (filter.empty() || std::string(c.kernel).find(filter) != std::string::npos) cases.push_back(std::move(c));
+    if (cases.empty()) {
+        std::cerr << "No kernel matches '" << filter << "'" << std::endl;
+        return 1;
+    }
+
+    CacheSizes caches = DetectCacheSizes();
+    std::size_t lastLevel = caches.l3 != 0 ? caches.l3 : caches.l2;
+    std::size_t dramBytes = std::clamp(4 * lastLevel, MIN_DRAM_BYTES, MAX_DRAM_BYTES);
+    std::vector<std::size_t> workingSets = { caches.l1 / 2, caches.l2 / 2 };
+    if (caches.l3 != 0) workingSets.push_back(caches.l3 / 2);
+    workingSets.push_back(dramBytes);
+
+    std::string status;
+    bool counters = EnableKernelCounters(status);
+    DisableKernelCounters();
+    std::cout << JsonWriter().Add("event", "machine").Add("cachesDetected", caches.detected)
+        .Add("l1Bytes", static_cast<long long>(caches.l1)).Add("l2Bytes", static_cast<long long>(caches.l2))
+        .Add("l3Bytes", static_cast<long long>(caches.l3)).Add("threads", ParallelThreadLimit())
+        .Add("counters", counters).Add("message", status).str() << std::endl;
+
+    // The roof: what plain copies reach on DRAM-sized buffers
+    double bandwidth[2] = {};
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        if (parallel && ParallelThreadLimit() == 1) {
+            bandwidth[1] = bandwidth[0];
+            break;
+        }
+        bandwidth[parallel] = MeasureCopyBandwidth(dramBytes / 2, parallel != 0);
+        std::cout << JsonWriter().Add("event", "bandwidth").Add("threads", parallel ? ParallelThreadLimit() : 1u)
+            .Add("bytes", static_cast<long long>(dramBytes)).Add("gbps", bandwidth[parallel]).str() << std::endl;
+    }
+
+    int runs = 0;
+    for (const BenchCase& c : cases) {
+        unsigned int lastW = 0, lastH = 0;
+        for (std::size_t workingSet : workingSets) {
+            std::uint64_t pixels = static_cast<std::uint64_t>(workingSet / c.bytesPerPixel);
+            if (c.maxPixels != 0) pixels = std::min(pixels, c.maxPixels);
+            // About twice as wide as high, whole vectors per row
+            unsigned int w = std::max(8u, static_cast<unsigned int>(std::sqrt(2.0 * pixels)) / 8 * 8);
+            unsigned int h = std::max(1u, static_cast<unsigned int>(pixels / w));
+            if (w == lastW && h == lastH) continue;
+            lastW = w;
+            lastH = h;
+            pixels = static_cast<std::uint64_t>(w) * h;
+
+            std::function<void()> call = c.prepare(w, h);
+            int iterations = 0;
+            double seconds = TimeCall(call, iterations);
+            double bytes = c.bytesPerPixel * pixels;
+            double gbps = bytes / seconds / 1e9;
+            unsigned int threads = c.parallel ? ParallelThreadLimit() : 1;
+
+            JsonWriter event;
+            event.Add("event", "kernel").Add("kernel", c.kernel)
+                .Add("level", LevelName(static_cast<std::size_t>(bytes), caches))
+                .Add("width", w).Add("height", h).Add("workingSetBytes", static_cast<long long>(bytes))
+                .Add("threads", threads).Add("nsPerPixel", seconds * 1e9 / pixels).Add("gbps", gbps)
+                .Add("bandwidthShare", gbps / bandwidth[c.parallel ? 1 : 0]);
+            double cycles = 0.0, instructions = 0.0;
+            if (counters && CountCall(call, iterations, c.parallel, pixels, cycles, instructions)) {
+                event.Add("pixelsPerCycle", pixels / cycles);
+                if (instructions > 0.0) event.Add("ipc", instructions / cycles);
+            }
+            std::cout << event.str() << std::endl;
+            runs++;
+        }
+    }
+
+    std::cout << JsonWriter().Add("event", "done").Add("kernels", static_cast<int>(cases.size()))
+        .Add("runs", runs).str() << std::endl;
+    return 0;
+}
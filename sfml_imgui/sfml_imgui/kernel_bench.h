@@ -0,0 +1,25 @@
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+#include <string>
+
+// --- KERNEL BENCHMARK ---
+// Microbenchmark of the pixel primitives one at a time (--kernel-bench): luma, the Luma
+// Wipe select, both blur passes, the supersample downsample filters, resize, alpha
+// (un)premultiply, YUV to RGBA and the PNG / QOI encoders. Each runs on working sets
+// sized to sit in L1, L2 and the last-level cache and to spill to DRAM, using the cache
+// sizes of this machine.
+// Throughput is reported as GB/s of compulsory traffic (bytes each output pixel has to read
+// and write at least) and set against the copy bandwidth measured on the same machine with
+// the same number of threads: a DRAM-sized kernel near that bandwidth is memory-bound, one
+// well below it still has headroom. With hardware counters (perf_counters.h) pixels per
+// cycle and IPC are added.
+// Kernels from ParallelFor (downsample, premultiply) use the thread limit, the others one
+// thread; --threads 1 compares everything single-threaded.
+
+// Prints a "machine" event (cache sizes, counters), one "bandwidth" event per thread count,
+// one "kernel" event per kernel and size and a final "done". 'filter', when not empty,
+// selects the kernels whose name contains it. Returns the process exit code.
+int RunKernelBench(const std::string& filter);
+
+#endif //KERNEL_BENCH_H
@@ -0,0 +1,348 @@
+#include "pch.h"
+#include "kernel_fuzz.h"
+#include "cpu_kernels.h"
+#include "transitions.h"
+#include "json_lite.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    const size_t GUARD_BYTES = 64;
+    // Inputs and outputs get different guards: any average or copy of input guard bytes
+    // (luma of a 0xa5 pixel is 0xa5) must not look like an untouched output guard
+    const std::uint8_t INPUT_GUARD = 0x5a;
+    const std::uint8_t OUTPUT_GUARD = 0xa5;
+    const int MAX_REPORTED_MISMATCHES = 20;
+
+    enum FuzzKernel { FUZZ_SELECT, FUZZ_LUMA, FUZZ_BLUR_ROWS, FUZZ_BLUR_COLUMNS, FUZZ_BLUR_COLUMNS_WIDE, FUZZ_RESIZE, FUZZ_KERNEL_COUNT };
+    const char* const FUZZ_KERNEL_NAMES[FUZZ_KERNEL_COUNT] = {
+        "select", "luma", "blur-rows", "blur-columns", "blur-columns-wide", "resize"
+    };
+
+    // Self-test name (KernelCandidate::kernel) of the hand-written versions a fuzz kernel covers
+    const char* CandidateKernel(FuzzKernel kernel)
+    {
+        switch (kernel) {
+        case FUZZ_SELECT: return "select";
+        case FUZZ_LUMA: return "luma";
+        case FUZZ_RESIZE: return "";
+        default: return "blur";
+        }
+    }
+
+    // xorshift32, seeded through a mixing step so neighbouring cases are unrelated
+    struct FuzzRandom {
+        std::uint32_t state;
+
+        FuzzRandom(std::uint32_t seed, std::uint32_t index)
+        {
+            std::uint32_t h = seed * 0x9e3779b9u + index * 0x85ebca6bu;
+            h ^= h >> 16; h *= 0x7feb352du; h ^= h >> 15; h *= 0x846ca68bu; h ^= h >> 16;
+            state = h != 0 ? h : 1;
+        }
+
+        std::uint32_t Next()
+        {
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            return state;
+        }
+
+        int Range(int lo, int hi) { return lo + static_cast<int>(Next() % static_cast<std::uint32_t>(hi - lo + 1)); }
+    };
+
+    // Half uniform, half a few elements around a multiple of a vector width
+    int FuzzLength(FuzzRandom& rng, int maxLength)
+    {
+        if (rng.Next() % 2) return rng.Range(1, maxLength);
+        const int units[] = { 8, 16, 32, 64 };
+        int unit = units[rng.Next() % 4];
+        int n = unit * rng.Range(1, std::max(1, maxLength / unit)) + rng.Range(-2, 2);
+        return std::clamp(n, 1, maxLength);
+    }
+
+    struct FuzzCase {
+        FuzzKernel kernel = FUZZ_SELECT;
+        PixelLayout layout = PixelLayout::Rgba8;
+        int width = 1, height = 1;        // Pixels (select, luma), image (blur) or target (resize) size
+        int srcWidth = 0, srcHeight = 0;  // Resize source
+        int radius = 0;
+        float progress = 0.0f;
+        int threshold = 0;
+        int offsets[3] = {};              // Start of input, mask and output past a 64-byte boundary
+    };
+
+    FuzzCase DrawCase(std::uint32_t seed, int index)
+    {
+        FuzzRandom rng(seed, static_cast<std::uint32_t>(index));
+        FuzzCase c;
+        c.kernel = static_cast<FuzzKernel>(rng.Next() % FUZZ_KERNEL_COUNT);
+        c.layout = rng.Next() % 2 ? PixelLayout::Rgba8 : PixelLayout::Luma8;
+        switch (c.kernel) {
+        case FUZZ_SELECT:
+        case FUZZ_LUMA:
+            c.width = FuzzLength(rng, 4096);
+            break;
+        case FUZZ_RESIZE:
+            c.srcWidth = FuzzLength(rng, 500);
+            c.srcHeight = rng.Range(1, 40);
+            c.width = FuzzLength(rng, 500);
+            c.height = rng.Range(1, 40);
+            break;
+        default:
+            // Beyond the specialized radii the generic instance is compared with itself, so
+            // only a few cases go there
+            c.width = FuzzLength(rng, 700);
+            c.height = rng.Range(1, 24);
+            c.radius = rng.Range(1, MAX_SPECIALIZED_RADIUS + 2);
+            break;
+        }
+        // The wipe's own thresholds, with the ends of the range drawn more often, plus some
+        // raw values far outside 0..255
+        switch (rng.Next() % 8) {
+        case 0: c.progress = 0.0f; break;
+        case 1: c.progress = 1.0f; break;
+        default: c.progress = static_cast<float>(rng.Next() >> 8) / 16777216.0f; break;
+        }
+        c.threshold = rng.Next() % 4 ? LumaWipeThreshold(c.progress) : rng.Range(-300, 300);
+        for (int& offset : c.offsets) offset = rng.Range(0, 63);
+        return c;
+    }
+
+    int Channels(PixelLayout layout) { return layout == PixelLayout::Rgba8 ? 4 : 1; }
+
+    // 'count' elements starting 'offset' elements past a 64-byte boundary, surrounded by guards
+    template <typename T>
+    class GuardedBuffer {
+    public:
+        GuardedBuffer(size_t count, int offset, std::uint8_t guardByte) : count(count)
+        {
+            std::memset(&pattern, guardByte, sizeof(T));
+            size_t guard = GUARD_BYTES / sizeof(T);
+            storage.assign(guard + 64 / sizeof(T) + offset + count + guard, pattern);
+            T* start = storage.data() + guard;
+            size_t misalignment = reinterpret_cast<std::uintptr_t>(start) % 64;
+            first = guard + (misalignment ? (64 - misalignment) / sizeof(T) : 0) + offset;
+        }
+
+        T* Data() { return storage.data() + first; }
+        size_t Count() const { return count; }
+
+        bool GuardsIntact() const
+        {
+            for (size_t i = 0; i < first; ++i) if (storage[i] != pattern) return false;
+            for (size_t i = first + count; i < storage.size(); ++i) if (storage[i] != pattern) return false;
+            return true;
+        }
+
+        void AppendBytes(std::vector<std::uint8_t>& out) const
+        {
+            const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(storage.data() + first);
+            out.insert(out.end(), bytes, bytes + count * sizeof(T));
+        }
+
+    private:
+        std::vector<T> storage;
+        T pattern{};
+        size_t first = 0;
+        size_t count = 0;
+    };
+
+    void FillNoise(std::uint8_t* bytes, size_t count, std::uint32_t seed)
+    {
+        std::uint32_t state = seed | 1u;
+        for (size_t i = 0; i < count; ++i) {
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            bytes[i] = static_cast<std::uint8_t>(state >> 24);
+        }
+    }
+
+    // The wide rows reach the caller through emitRow; the fuzzer collects them here
+    thread_local std::vector<std::uint8_t>* collectedRows = nullptr;
+    thread_local int collectedChannels = 0;
+
+    void CollectWideRow(const std::uint16_t* wide, std::uint8_t*, int w, int)
+    {
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(wide);
+        collectedRows->insert(collectedRows->end(), bytes, bytes + static_cast<size_t>(w) * collectedChannels * 2);
+    }
+
+    // Per-pixel nearest-neighbour resize, the way ResizeImageCPU sampled before the kernel table
+    void ResizeReference(const std::uint8_t* src, unsigned int srcW, unsigned int srcH,
+        std::uint8_t* dst, unsigned int dstW, unsigned int dstH, int channels)
+    {
+        float scaleX = static_cast<float>(srcW) / dstW;
+        float scaleY = static_cast<float>(srcH) / dstH;
+        for (unsigned int y = 0; y < dstH; ++y) {
+            for (unsigned int x = 0; x < dstW; ++x) {
+                unsigned int origX = std::min(srcW - 1, static_cast<unsigned int>(x * scaleX));
+                unsigned int origY = std::min(srcH - 1, static_cast<unsigned int>(y * scaleY));
+                std::memcpy(dst + (static_cast<size_t>(y) * dstW + x) * channels,
+                    src + (static_cast<size_t>(origY) * srcW + origX) * channels, channels);
+            }
+        }
+    }
+
+    // Table entry a case exercises; the reference is the generic (slot 0) blur instance
+    // and, for resize, ResizeReference (no entry)
+    std::uintptr_t CaseEntry(const FuzzCase& c, const CpuKernelTable& t, bool reference)
+    {
+        int l = static_cast<int>(c.layout);
+        int slot = reference ? 0 : BlurRadiusSlot(c.radius);
+        switch (c.kernel) {
+        case FUZZ_SELECT: return reinterpret_cast<std::uintptr_t>(t.select[l]);
+        case FUZZ_LUMA: return reinterpret_cast<std::uintptr_t>(t.luma);
+        case FUZZ_BLUR_ROWS: return reinterpret_cast<std::uintptr_t>(t.blurRows[l][slot]);
+        case FUZZ_BLUR_COLUMNS:
+            return reinterpret_cast<std::uintptr_t>(t.blurColumns[l][static_cast<int>(BlurOutput::Truncate)][slot]);
+        case FUZZ_BLUR_COLUMNS_WIDE:
+            return reinterpret_cast<std::uintptr_t>(t.blurColumns[l][static_cast<int>(BlurOutput::Wide)][slot]);
+        default: return reference ? 0 : reinterpret_cast<std::uintptr_t>(t.resize[l]);
+        }
+    }
+
+    // Runs one version of the case's kernel on freshly generated inputs. 'out' receives the
+    // output bytes (and the collected wide rows); returns false when a guard was overwritten.
+    bool RunCase(const FuzzCase& c, std::uint32_t inputSeed, const CpuKernelTable& t, bool reference,
+        std::vector<std::uint8_t>& out)
+    {
+        const int channels = Channels(c.layout);
+        const int l = static_cast<int>(c.layout);
+        const int slot = reference ? 0 : BlurRadiusSlot(c.radius);
+        const size_t pixels = static_cast<size_t>(c.width) * c.height;
+        out.clear();
+
+        switch (c.kernel) {
+        case FUZZ_SELECT: {
+            GuardedBuffer<std::uint8_t> a(pixels * channels, c.offsets[0], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> b(pixels * channels, c.offsets[1], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> mask(pixels, c.offsets[1], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> dst(pixels * channels, c.offsets[2], OUTPUT_GUARD);
+            FillNoise(a.Data(), a.Count(), inputSeed);
+            FillNoise(b.Data(), b.Count(), inputSeed + 1);
+            FillNoise(mask.Data(), mask.Count(), inputSeed + 2);
+            t.select[l](a.Data(), b.Data(), mask.Data(), dst.Data(), pixels, c.threshold);
+            dst.AppendBytes(out);
+            return dst.GuardsIntact();
+        }
+        case FUZZ_LUMA: {
+            GuardedBuffer<std::uint8_t> rgba(pixels * 4, c.offsets[0], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> luma(pixels, c.offsets[2], OUTPUT_GUARD);
+            FillNoise(rgba.Data(), rgba.Count(), inputSeed);
+            t.luma(rgba.Data(), luma.Data(), pixels);
+            luma.AppendBytes(out);
+            return luma.GuardsIntact();
+        }
+        case FUZZ_RESIZE: {
+            size_t srcPixels = static_cast<size_t>(c.srcWidth) * c.srcHeight;
+            GuardedBuffer<std::uint8_t> src(srcPixels * channels, c.offsets[0], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> dst(pixels * channels, c.offsets[2], OUTPUT_GUARD);
+            FillNoise(src.Data(), src.Count(), inputSeed);
+            if (reference)
+                ResizeReference(src.Data(), c.srcWidth, c.srcHeight, dst.Data(), c.width, c.height, channels);
+            else
+                t.resize[l](src.Data(), c.srcWidth, c.srcHeight, dst.Data(), c.width, c.height);
+            dst.AppendBytes(out);
+            return dst.GuardsIntact();
+        }
+        default: {
+            GuardedBuffer<std::uint8_t> src(pixels * channels, c.offsets[0], INPUT_GUARD);
+            GuardedBuffer<std::uint8_t> dst(pixels * channels, c.offsets[2], OUTPUT_GUARD);
+            FillNoise(src.Data(), src.Count(), inputSeed);
+            if (c.kernel == FUZZ_BLUR_ROWS) {
+                t.blurRows[l][slot](src.Data(), dst.Data(), c.width, c.height, c.radius);
+            }
+            else if (c.kernel == FUZZ_BLUR_COLUMNS) {
+                t.blurColumns[l][static_cast<int>(BlurOutput::Truncate)][slot](src.Data(), dst.Data(), nullptr,
+                    c.width, c.height, c.radius, nullptr);
+            }
+            else {
+                // Even offset keeps the 16-bit row aligned to its element size
+                GuardedBuffer<std::uint16_t> wide(static_cast<size_t>(c.width) * channels, c.offsets[1] / 2, OUTPUT_GUARD);
+                std::vector<std::uint8_t> rows;
+                collectedRows = &rows;
+                collectedChannels = channels;
+                t.blurColumns[l][static_cast<int>(BlurOutput::Wide)][slot](src.Data(), dst.Data(), wide.Data(),
+                    c.width, c.height, c.radius, &CollectWideRow);
+                collectedRows = nullptr;
+                out = std::move(rows);
+                // The rows are the output; 'dst' only has to stay within bounds
+                return wide.GuardsIntact() && dst.GuardsIntact();
+            }
+            dst.AppendBytes(out);
+            return dst.GuardsIntact();
+        }
+        }
+    }
+
+    struct VersionStats {
+        int cases = 0;
+        int mismatches = 0;
+    };
+}
+
+int RunKernelFuzz(int cases, std::uint32_t seed)
+{
+    // The portable table is both the source of the reference entries and a version of its
+    // own (the specialized instances); the hand-written ones follow
+    const CpuKernelTable& portable = PortableCpuKernels();
+    std::vector<KernelCandidate> versions;
+    versions.push_back({ "", CpuIsa::Scalar, portable });
+    for (KernelCandidate& candidate : CpuKernelCandidates()) versions.push_back(candidate);
+
+    std::map<std::pair<int, int>, VersionStats> stats;
+    int mismatches = 0;
+    int progressStep = std::max(1, cases / 10);
+    std::vector<std::uint8_t> expected, actual;
+
+    for (int i = 0; i < cases; ++i) {
+        FuzzCase c = DrawCase(seed, i);
+        std::uint32_t inputSeed = seed * 0x01000193u ^ static_cast<std::uint32_t>(i) * 0x9e3779b9u;
+        std::uintptr_t referenceEntry = CaseEntry(c, portable, true);
+        RunCase(c, inputSeed, portable, true, expected);
+
+        std::vector<std::uintptr_t> tested = { referenceEntry };
+        for (const KernelCandidate& version : versions) {
+            if (!version.kernel.empty() && version.kernel != CandidateKernel(c.kernel)) continue;
+            std::uintptr_t entry = CaseEntry(c, version.table, false);
+            // Entries the version did not replace were already tested under another name
+            if (std::find(tested.begin(), tested.end(), entry) != tested.end()) continue;
+            tested.push_back(entry);
+
+            bool guardsIntact = RunCase(c, inputSeed, version.table, false, actual);
+            VersionStats& entryStats = stats[{ static_cast<int>(c.kernel), static_cast<int>(version.isa) }];
+            entryStats.cases++;
+            if (guardsIntact && actual == expected) continue;
+
+            entryStats.mismatches++;
+            if (mismatches++ >= MAX_REPORTED_MISMATCHES) continue;
+            auto diff = std::mismatch(actual.begin(), actual.end(), expected.begin(), expected.end());
+            long long firstDiff = diff.first == actual.end() && diff.second == expected.end() ? -1
+                : static_cast<long long>(diff.first - actual.begin());
+            JsonWriter event;
+            event.Add("event", "mismatch").Add("kernel", FUZZ_KERNEL_NAMES[c.kernel]).Add("isa", CpuIsaName(version.isa))
+                .Add("seed", static_cast<long long>(seed)).Add("case", i)
+                .Add("layout", c.layout == PixelLayout::Rgba8 ? "rgba8" : "luma8").Add("width", c.width).Add("height", c.height);
+            if (c.kernel == FUZZ_SELECT) event.Add("progress", static_cast<double>(c.progress)).Add("threshold", c.threshold);
+            else if (c.kernel == FUZZ_RESIZE) event.Add("srcWidth", c.srcWidth).Add("srcHeight", c.srcHeight);
+            else if (c.kernel != FUZZ_LUMA) event.Add("radius", c.radius);
+            std::cout << event.Add("firstDiff", firstDiff).Add("guardsIntact", guardsIntact).str() << std::endl;
+        }
+
+        if ((i + 1) % progressStep == 0 || i + 1 == cases)
+            std::cout << JsonWriter().Add("event", "progress").Add("case", i + 1).Add("total", cases).str() << std::endl;
+    }
+
+    for (const auto& [key, entry] : stats) {
+        std::cout << JsonWriter().Add("event", "kernel").Add("kernel", FUZZ_KERNEL_NAMES[key.first])
+            .Add("isa", CpuIsaName(static_cast<CpuIsa>(key.second)))
+            .Add("cases", entry.cases).Add("mismatches", entry.mismatches).str() << std::endl;
+    }
+    std::cout << JsonWriter().Add("event", "done").Add("seed", static_cast<long long>(seed)).Add("cases", cases)
+        .Add("mismatches", mismatches).Add("passed", mismatches == 0).str() << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#ifndef KERNEL_FUZZ_H
+#define KERNEL_FUZZ_H
+
+#include <cstdint>
+
+// --- KERNEL FUZZING ---
+// Differential fuzzing of the CPU kernels (--kernel-fuzz). Each case draws a kernel, pixel
+// layout, size, blur radius and wipe progress at random, runs the reference on the
+// input and then every other version of that kernel: the specialized portable instances
+// and each hand-written version within the ISA limit. Outputs have to match byte for byte.
+// Sizes cluster around multiples of the vector widths, where tail loops go wrong, and
+// every buffer starts at a random offset from a 64-byte boundary with guard bytes on
+// both sides, so a write past either end counts as a mismatch too.
+// Case N of a seed is always the same input, so a reported mismatch reproduces with the
+// same seed and at least N + 1 cases.
+
+// Runs 'cases' random cases and prints JSON lines: one per mismatch (the first few in
+// detail), one summary per kernel version and a final "done". Returns 1 on any mismatch.
+int RunKernelFuzz(int cases, std::uint32_t seed);
+
+#endif //KERNEL_FUZZ_H
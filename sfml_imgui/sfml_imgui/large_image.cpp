@@ -0,0 +1,277 @@
+#include "pch.h"
+#include "large_image.h"
+#include "parallel.h"
+#include "png_rows.h"
+#include "transitions.h"
+#include <SFML/Graphics/Texture.hpp>
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const unsigned int MAX_REDUCTION = 1u << 12;
+
+    // One output row from 'rows' rows of 'band' (RGBA8, 'width' pixels each). Colours are
+    // weighted by alpha so transparent pixels do not bleed into their neighbours.
+    void ReduceBand(const std::uint8_t* band, unsigned int width, unsigned int rows, unsigned int factor,
+        std::uint8_t* out)
+    {
+        unsigned int outW = (width + factor - 1) / factor;
+        size_t stride = static_cast<size_t>(width) * 4;
+        ParallelFor(outW, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int ox = begin; ox < end; ++ox) {
+                unsigned int x0 = ox * factor;
+                unsigned int x1 = std::min(width, x0 + factor);
+                std::uint64_t r = 0, g = 0, b = 0, a = 0;
+                for (unsigned int y = 0; y < rows; ++y) {
+                    const std::uint8_t* p = band + y * stride + static_cast<size_t>(x0) * 4;
+                    for (unsigned int x = x0; x < x1; ++x, p += 4) {
+                        r += p[0] * p[3]; g += p[1] * p[3]; b += p[2] * p[3]; a += p[3];
+                    }
+                }
+                std::uint64_t n = static_cast<std::uint64_t>(x1 - x0) * rows;
+                std::uint8_t* o = out + static_cast<size_t>(ox) * 4;
+                if (a == 0) {
+                    o[0] = o[1] = o[2] = o[3] = 0;
+                    continue;
+                }
+                o[0] = static_cast<std::uint8_t>((r + a / 2) / a);
+                o[1] = static_cast<std::uint8_t>((g + a / 2) / a);
+                o[2] = static_cast<std::uint8_t>((b + a / 2) / a);
+                o[3] = static_cast<std::uint8_t>((a + n / 2) / n);
+            }
+        }, 16);
+    }
+
+    // Next header token, skipping whitespace and '#' comments
+    std::string ReadToken(std::istream& in)
+    {
+        std::string token;
+        int c;
+        while ((c = in.get()) != EOF) {
+            if (c == '#') {
+                while ((c = in.get()) != EOF && c != '\n') {}
+                continue;
+            }
+            if (std::isspace(c)) {
+                if (!token.empty()) break;
+                continue;
+            }
+            token.push_back(static_cast<char>(c));
+        }
+        return token;
+    }
+
+    bool ReadNetpbmHeader(std::istream& in, unsigned int& width, unsigned int& height, unsigned int& depth)
+    {
+        std::string magic = ReadToken(in);
+        unsigned int maxval = 0;
+        if (magic == "P6") {
+            // A single whitespace byte after maxval ends the header (ReadToken consumed it)
+            width = static_cast<unsigned int>(std::atoi(ReadToken(in).c_str()));
+            height = static_cast<unsigned int>(std::atoi(ReadToken(in).c_str()));
+            maxval = static_cast<unsigned int>(std::atoi(ReadToken(in).c_str()));
+            depth = 3;
+        }
+        else if (magic == "P7") {
+            depth = 0;
+            for (std::string key = ReadToken(in); !key.empty() && key != "ENDHDR"; key = ReadToken(in)) {
+                std::string value = ReadToken(in);
+                if (key == "WIDTH") width = static_cast<unsigned int>(std::atoi(value.c_str()));
+                else if (key == "HEIGHT") height = static_cast<unsigned int>(std::atoi(value.c_str()));
+                else if (key == "DEPTH") depth = static_cast<unsigned int>(std::atoi(value.c_str()));
+                else if (key == "MAXVAL") maxval = static_cast<unsigned int>(std::atoi(value.c_str()));
+            }
+        }
+        else {
+            return false;
+        }
+        return width > 0 && height > 0 && maxval == 255 && (depth == 3 || depth == 4);
+    }
+
+    bool LoadNetpbmReduced(const std::filesystem::path& path, sf::Image& out, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary);
+        unsigned int width = 0, height = 0, depth = 0;
+        if (!file || !ReadNetpbmHeader(file, width, height, depth)) {
+            error = "unsupported PPM/PAM file " + path.string() + " (8-bit P6 or P7 RGB/RGB_ALPHA only)";
+            return false;
+        }
+
+        unsigned int factor = InputReductionFactor({ width, height }, sf::Texture::getMaximumSize());
+        unsigned int outW = (width + factor - 1) / factor;
+        unsigned int outH = (height + factor - 1) / factor;
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(outW) * outH * 4);
+        std::vector<std::uint8_t> band(static_cast<size_t>(width) * factor * 4);
+        std::vector<std::uint8_t> raw(static_cast<size_t>(width) * depth);
+
+        for (unsigned int oy = 0; oy < outH; ++oy) {
+            unsigned int rows = std::min(factor, height - oy * factor);
+            for (unsigned int y = 0; y < rows; ++y) {
+                if (!file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(raw.size()))) {
+                    error = "truncated image data in " + path.string();
+                    return false;
+                }
+                std::uint8_t* dst = &band[static_cast<size_t>(y) * width * 4];
+                for (unsigned int x = 0; x < width; ++x) {
+                    const std::uint8_t* s = &raw[static_cast<size_t>(x) * depth];
+                    dst[x * 4] = s[0]; dst[x * 4 + 1] = s[1]; dst[x * 4 + 2] = s[2];
+                    dst[x * 4 + 3] = depth == 4 ? s[3] : 255;
+                }
+            }
+            ReduceBand(band.data(), width, rows, factor, &pixels[static_cast<size_t>(oy) * outW * 4]);
+        }
+        out.resize({ outW, outH }, pixels.data());
+        return true;
+    }
+
+    // Rows arrive one at a time from the decoder and are reduced a band at a time
+    bool LoadPngReduced(std::istream& file, const PngHeader& header, const std::filesystem::path& path,
+        sf::Image& out, std::string& error)
+    {
+        unsigned int width = header.width, height = header.height;
+        unsigned int factor = InputReductionFactor({ width, height }, sf::Texture::getMaximumSize());
+        unsigned int outW = (width + factor - 1) / factor;
+        unsigned int outH = (height + factor - 1) / factor;
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(outW) * outH * 4);
+        std::vector<std::uint8_t> band(static_cast<size_t>(width) * factor * 4);
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+
+        bool decoded = DecodePngRows(file, header, [&](unsigned int y, const std::uint8_t* rgba) {
+            unsigned int row = y % factor;
+            std::memcpy(&band[row * rowBytes], rgba, rowBytes);
+            if (row == factor - 1 || y == height - 1)
+                ReduceBand(band.data(), width, row + 1, factor, &pixels[static_cast<size_t>(y / factor) * outW * 4]);
+        }, error);
+        if (!decoded) {
+            error = "cannot decode " + path.string() + ": " + error;
+            return false;
+        }
+        out.resize({ outW, outH }, pixels.data());
+        return true;
+    }
+
+    // Size from the file header, without decoding the pixels
+    bool ProbeImageSize(const std::filesystem::path& path, sf::Vector2u& size)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        stbi_io_callbacks callbacks;
+        callbacks.read = [](void* user, char* data, int n) {
+            auto& in = *static_cast<std::ifstream*>(user);
+            in.read(data, n);
+            return static_cast<int>(in.gcount());
+        };
+        callbacks.skip = [](void* user, int n) {
+            auto& in = *static_cast<std::ifstream*>(user);
+            in.clear();
+            in.seekg(n, std::ios::cur);
+        };
+        callbacks.eof = [](void* user) {
+            return static_cast<std::ifstream*>(user)->eof() ? 1 : 0;
+        };
+        int width = 0, height = 0, channels = 0;
+        if (!stbi_info_from_callbacks(&callbacks, &file, &width, &height, &channels)) return false;
+        size = { static_cast<unsigned int>(width), static_cast<unsigned int>(height) };
+        return true;
+    }
+}
+
+std::uint64_t DecodeLimitBytes()
+{
+    static const std::uint64_t limit = [] {
+        std::uint64_t mb = DEFAULT_DECODE_LIMIT_MB;
+        const char* value = std::getenv(DECODE_LIMIT_ENV_VAR);
+        if (value && *value) {
+            char* end = nullptr;
+            unsigned long long parsed = std::strtoull(value, &end, 10);
+            if (*end == '\0' && parsed > 0) mb = parsed;
+            else std::cerr << "Ignoring " << DECODE_LIMIT_ENV_VAR << "=" << value << ": expected a size in MB" << std::endl;
+        }
+        return mb << 20;
+    }();
+    return limit;
+}
+
+unsigned int InputReductionFactor(sf::Vector2u size, unsigned int maxTextureSize)
+{
+    auto reduced = [&](unsigned int f) {
+        return sf::Vector2u((size.x + f - 1) / f, (size.y + f - 1) / f);
+    };
+    unsigned int factor = 1;
+    while (factor < MAX_REDUCTION) {
+        sf::Vector2u current = reduced(factor);
+        sf::Vector2u next = reduced(factor * 2);
+        bool tooLarge = current.x > maxTextureSize || current.y > maxTextureSize;
+        bool nextCovers = next.x >= CANVAS_WIDTH * INPUT_DETAIL_FACTOR && next.y >= CANVAS_HEIGHT * INPUT_DETAIL_FACTOR;
+        if (!tooLarge && !nextCovers) break;
+        factor *= 2;
+    }
+    return factor;
+}
+
+void ReduceImage(const sf::Image& src, unsigned int factor, sf::Image& out)
+{
+    sf::Vector2u size = src.getSize();
+    unsigned int outW = (size.x + factor - 1) / factor;
+    unsigned int outH = (size.y + factor - 1) / factor;
+    std::vector<std::uint8_t> pixels(static_cast<size_t>(outW) * outH * 4);
+    const std::uint8_t* base = src.getPixelsPtr();
+    for (unsigned int oy = 0; oy < outH; ++oy) {
+        unsigned int rows = std::min(factor, size.y - oy * factor);
+        ReduceBand(base + static_cast<size_t>(oy) * factor * size.x * 4, size.x, rows, factor,
+            &pixels[static_cast<size_t>(oy) * outW * 4]);
+    }
+    out.resize({ outW, outH }, pixels.data());
+}
+
+bool LoadInputImage(const std::filesystem::path& path, sf::Image& out, std::string* error)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    std::string message;
+    if (ext == ".ppm" || ext == ".pam" || ext == ".pnm") {
+        if (LoadNetpbmReduced(path, out, message)) return true;
+        if (error) *error = message;
+        return false;
+    }
+    if (ext == ".png") {
+        std::ifstream file(path, std::ios::binary);
+        PngHeader header;
+        if (file && ReadPngHeader(file, header) && !header.interlaced) {
+            if (LoadPngReduced(file, header, path, out, message)) return true;
+            if (error) *error = message;
+            return false;
+        }
+    }
+
+    // Everything else is decoded whole: check the size before committing the memory
+    sf::Vector2u size;
+    if (!ProbeImageSize(path, size)) {
+        if (error) *error = "cannot decode " + path.string();
+        return false;
+    }
+    std::uint64_t bytes = static_cast<std::uint64_t>(size.x) * size.y * 4;
+    if (bytes > DecodeLimitBytes()) {
+        if (error) *error = path.string() + " is " + std::to_string(size.x) + "x" + std::to_string(size.y) +
+            " and needs " + std::to_string(bytes >> 20) + " MB decoded, over the " +
+            std::to_string(DecodeLimitBytes() >> 20) + " MB limit (" + DECODE_LIMIT_ENV_VAR +
+            "); convert it to non-interlaced PNG or PPM to stream it";
+        return false;
+    }
+
+    sf::Image loaded;
+    if (!loaded.loadFromFile(path)) {
+        if (error) *error = "cannot decode " + path.string();
+        return false;
+    }
+    unsigned int factor = InputReductionFactor(loaded.getSize(), sf::Texture::getMaximumSize());
+    if (factor > 1) ReduceImage(loaded, factor, out);
+    else out = std::move(loaded);
+    return true;
+}
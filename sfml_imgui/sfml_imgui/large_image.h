@@ -0,0 +1,37 @@
+#ifndef LARGE_IMAGE_H
+#define LARGE_IMAGE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <SFML/Graphics/Image.hpp>
+
+// Inputs are always drawn fitted to the canvas, so no frame ever shows more detail than
+// the canvas at the highest supersampling factor. Anything beyond that (or beyond the GL
+// texture limit) is reduced at load time to the power-of-two mip level that still covers it.
+const unsigned int INPUT_DETAIL_FACTOR = 4;   // Highest SupersampleSettings::factor
+
+// Power-of-two factor an image of 'size' is reduced by: the smallest that fits
+// 'maxTextureSize' while the next one would still cover canvas x INPUT_DETAIL_FACTOR
+unsigned int InputReductionFactor(sf::Vector2u size, unsigned int maxTextureSize);
+
+// Averages factor x factor blocks (alpha weighted, partial blocks at the edges) in bands
+// of 'factor' rows; columns of each band are reduced on all hardware threads
+void ReduceImage(const sf::Image& src, unsigned int factor, sf::Image& out);
+
+// Formats that have to be decoded whole are refused when their RGBA8 pixels would take
+// more than this; TRANSITIONS_DECODE_LIMIT_MB overrides it
+const unsigned int DEFAULT_DECODE_LIMIT_MB = 2048;
+const char* const DECODE_LIMIT_ENV_VAR = "TRANSITIONS_DECODE_LIMIT_MB";
+
+// Decode limit in bytes, read once from DECODE_LIMIT_ENV_VAR
+std::uint64_t DecodeLimitBytes();
+
+// Loads an input at the mip level it is needed at. Non-interlaced PNG files and binary
+// PPM/PAM files (P6, P7 RGB or RGB_ALPHA, 8 bit) are streamed in bands of rows, so
+// gigapixel panoramas load with memory proportional to their width. Other formats (JPEG,
+// interlaced PNG, BMP, TGA, ...) are decoded whole and then reduced; their size is read
+// from the header first and files beyond DecodeLimitBytes are refused.
+bool LoadInputImage(const std::filesystem::path& path, sf::Image& out, std::string* error = nullptr);
+
+#endif //LARGE_IMAGE_H
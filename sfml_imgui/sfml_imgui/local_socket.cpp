@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "local_socket.h"
+#include <cstring>
+#include <filesystem>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET NativeSocket;
+static void CloseNative(NativeSocket s) { closesocket(s); }
+static bool EnsureSocketsStarted()
+{
+    static bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return started;
+}
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+typedef int NativeSocket;
+static void CloseNative(NativeSocket s) { ::close(s); }
+static bool EnsureSocketsStarted() { return true; }
+#endif
+
+namespace {
+    bool MakeAddress(const std::string& path, sockaddr_un& addr)
+    {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    NativeSocket ToNative(std::intptr_t h) { return static_cast<NativeSocket>(h); }
+}
+
+LocalSocket::~LocalSocket()
+{
+    Close();
+}
+
+LocalSocket::LocalSocket(LocalSocket&& other) noexcept
+    : handle(other.handle), readBuffer(std::move(other.readBuffer)), boundPath(std::move(other.boundPath))
+{
+    other.handle = INVALID;
+    other.boundPath.clear();
+}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        handle = other.handle;
+        readBuffer = std::move(other.readBuffer);
+        boundPath = std::move(other.boundPath);
+        other.handle = INVALID;
+        other.boundPath.clear();
+    }
+    return *this;
+}
+
+void LocalSocket::Close()
+{
+    if (handle != INVALID) {
+        CloseNative(ToNative(handle));
+        handle = INVALID;
+    }
+    if (!boundPath.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(boundPath, ec);
+        boundPath.clear();
+    }
+    readBuffer.clear();
+}
+
+bool LocalSocket::Listen(const std::string& path)
+{
+    Close();
+    sockaddr_un addr;
+    if (!EnsureSocketsStarted() || !MakeAddress(path, addr)) return false;
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    NativeSocket s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == static_cast<NativeSocket>(INVALID)) return false;
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 8) != 0) {
+        CloseNative(s);
+        return false;
+    }
+    handle = static_cast<std::intptr_t>(s);
+    boundPath = path;
+    return true;
+}
+
+LocalSocket LocalSocket::Accept()
+{
+    if (handle == INVALID) return LocalSocket();
+    NativeSocket c = ::accept(ToNative(handle), nullptr, nullptr);
+    if (c == static_cast<NativeSocket>(INVALID)) return LocalSocket();
+    return LocalSocket(static_cast<std::intptr_t>(c));
+}
+
+bool LocalSocket::Connect(const std::string& path)
+{
+    Close();
+    sockaddr_un addr;
+    if (!EnsureSocketsStarted() || !MakeAddress(path, addr)) return false;
+
+    NativeSocket s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == static_cast<NativeSocket>(INVALID)) return false;
+    if (::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        CloseNative(s);
+        return false;
+    }
+    handle = static_cast<std::intptr_t>(s);
+    return true;
+}
+
+bool LocalSocket::SendAll(const void* data, size_t size)
+{
+    if (handle == INVALID) return false;
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+#ifdef _WIN32
+        int n = ::send(ToNative(handle), p, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0);
+#else
+        // MSG_NOSIGNAL: a client that went away must not kill the service with SIGPIPE
+        ssize_t n = ::send(ToNative(handle), p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool LocalSocket::SendLine(const std::string& line)
+{
+    std::string framed = line;
+    framed += '\n';
+    return SendAll(framed.data(), framed.size());
+}
+
+bool LocalSocket::ReadLine(std::string& line)
+{
+    if (handle == INVALID) return false;
+    for (;;) {
+        size_t nl = readBuffer.find('\n');
+        if (nl != std::string::npos) {
+            line = readBuffer.substr(0, nl);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            readBuffer.erase(0, nl + 1);
+            return true;
+        }
+        char chunk[4096];
+#ifdef _WIN32
+        int n = ::recv(ToNative(handle), chunk, sizeof(chunk), 0);
+#else
+        ssize_t n = ::recv(ToNative(handle), chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) return false;
+        readBuffer.append(chunk, static_cast<size_t>(n));
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef LOCAL_SOCKET_H
+#define LOCAL_SOCKET_H
+
+#include <cstdint>
+#include <string>
+
+// Stream socket on a Unix domain (AF_UNIX) address. Works on Linux/macOS and on
+// Windows 10 1803+, which ships AF_UNIX in Winsock. Only for local IPC - there is
+// deliberately no TCP support. Move-only; the descriptor is closed on destruction.
+class LocalSocket {
+public:
+    LocalSocket() = default;
+    ~LocalSocket();
+    LocalSocket(LocalSocket&& other) noexcept;
+    LocalSocket& operator=(LocalSocket&& other) noexcept;
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    // Binds and listens on 'path'. A stale socket file left by a crashed service is removed first.
+    bool Listen(const std::string& path);
+    // Blocks until a client connects; returns an invalid socket on failure
+    LocalSocket Accept();
+    bool Connect(const std::string& path);
+
+    bool SendAll(const void* data, size_t size);
+    bool SendLine(const std::string& line);   // Appends '\n'
+    // Reads up to the next '\n' (not included). Returns false on EOF or error.
+    bool ReadLine(std::string& line);
+
+    bool IsValid() const { return handle != INVALID; }
+    void Close();
+
+private:
+    static constexpr std::intptr_t INVALID = -1;
+    explicit LocalSocket(std::intptr_t h) : handle(h) {}
+
+    std::intptr_t handle = INVALID;
+    std::string readBuffer;
+    std::string boundPath;   // Unlinked again when a listening socket closes
+};
+
+#endif //LOCAL_SOCKET_H
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "lz4_block.h"
+#include <cstring>
+
+namespace {
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5;   // The format requires the block to end in literals
+    const size_t MF_LIMIT = 12;       // No match may start this close to the end
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_LOG = 16;
+
+    inline std::uint32_t Read32(const std::uint8_t* p)
+    {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    inline std::uint32_t Hash(std::uint32_t v)
+    {
+        return (v * 2654435761u) >> (32 - HASH_LOG);
+    }
+
+    void PutLength(std::vector<std::uint8_t>& dst, size_t length)
+    {
+        while (length >= 255) {
+            dst.push_back(255);
+            length -= 255;
+        }
+        dst.push_back(static_cast<std::uint8_t>(length));
+    }
+
+    void EmitSequence(std::vector<std::uint8_t>& dst, const std::uint8_t* literals, size_t literalLength,
+        size_t offset, size_t matchLength)
+    {
+        size_t token = dst.size();
+        dst.push_back(0);
+        std::uint8_t t = 0;
+        if (literalLength >= 15) { t = 0xF0; PutLength(dst, literalLength - 15); }
+        else t = static_cast<std::uint8_t>(literalLength << 4);
+        dst.insert(dst.end(), literals, literals + literalLength);
+
+        if (matchLength > 0) {
+            dst.push_back(static_cast<std::uint8_t>(offset));
+            dst.push_back(static_cast<std::uint8_t>(offset >> 8));
+            size_t m = matchLength - MIN_MATCH;
+            if (m >= 15) { t |= 0x0F; PutLength(dst, m - 15); }
+            else t |= static_cast<std::uint8_t>(m);
+        }
+        dst[token] = t;
+    }
+}
+
+void Lz4Compress(const std::uint8_t* src, size_t size, std::vector<std::uint8_t>& dst)
+{
+    size_t anchor = 0;
+    if (size > MF_LIMIT) {
+        std::vector<std::uint32_t> table(size_t(1) << HASH_LOG, 0);
+        size_t ip = 1;
+        size_t limit = size - MF_LIMIT;
+        while (ip < limit) {
+            std::uint32_t seq = Read32(src + ip);
+            std::uint32_t h = Hash(seq);
+            size_t candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(ip);
+
+            if (ip - candidate > MAX_OFFSET || Read32(src + candidate) != seq) {
+                // Skip faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            size_t matchLength = MIN_MATCH;
+            size_t matchLimit = size - LAST_LITERALS;
+            while (ip + matchLength < matchLimit && src[candidate + matchLength] == src[ip + matchLength]) matchLength++;
+
+            EmitSequence(dst, src + anchor, ip - anchor, ip - candidate, matchLength);
+            ip += matchLength;
+            anchor = ip;
+            if (ip < limit) table[Hash(Read32(src + ip - 2))] = static_cast<std::uint32_t>(ip - 2);
+        }
+    }
+    EmitSequence(dst, src + anchor, size - anchor, 0, 0);
+}
+
+bool Lz4Decompress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t dstSize)
+{
+    const std::uint8_t* ip = src;
+    const std::uint8_t* iend = src + srcSize;
+    size_t op = 0;
+
+    auto readLength = [&](size_t& length) {
+        std::uint8_t b;
+        do {
+            if (ip >= iend) return false;
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        std::uint8_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) return false;
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > dstSize - op) return false;
+        std::memcpy(dst + op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == iend) break;   // Last sequence has no match
+
+        if (iend - ip < 2) return false;
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > op || matchLength > dstSize - op) return false;
+
+        std::uint8_t* out = dst + op;
+        const std::uint8_t* match = out - offset;
+        if (offset >= matchLength) {
+            std::memcpy(out, match, matchLength);
+        }
+        else {
+            // Overlapping copy repeats the last 'offset' bytes (runs, patterns)
+            for (size_t i = 0; i < matchLength; ++i) out[i] = match[i];
+        }
+        op += matchLength;
+    }
+    return op == dstSize;
+}
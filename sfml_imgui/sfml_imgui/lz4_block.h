@@ -0,0 +1,17 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cstdint>
+#include <vector>
+
+// Compressor and decompressor for the LZ4 *block* format (no frame header, no checksums).
+// Single-pass greedy matcher with a 64K-entry hash table: a few hundred MB/s per core,
+// which is the point - it is used where PNG's deflate is far too slow.
+
+// Appends the compressed form of 'src' to 'dst'
+void Lz4Compress(const std::uint8_t* src, size_t size, std::vector<std::uint8_t>& dst);
+
+// Decompresses exactly 'dstSize' bytes. Returns false on malformed or truncated input.
+bool Lz4Decompress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t dstSize);
+
+#endif //LZ4_BLOCK_H
@@ -0,0 +1,291 @@
+#include "pch.h"
+#include "mezzanine.h"
+#include "lz4_block.h"
+#include "parallel.h"
+#include "frame_export.h"
+#include "json_lite.h"
+#include "qoi.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const size_t HEADER_SIZE = 32;
+    const size_t INDEX_ENTRY_SIZE = 20;
+    const std::uint32_t MAX_STRIPES = 256;
+    // Same bound as the QOI decoder: 400 megapixels, 1.6 GB per decoded frame
+    const std::uint64_t MAX_FRAME_PIXELS = 400000000;
+
+    void PutU32(std::uint8_t* p, std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+    }
+
+    void PutU64(std::uint8_t* p, std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+    }
+
+    std::uint32_t GetU32(const std::uint8_t* p)
+    {
+        return std::uint32_t(p[0]) | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 24);
+    }
+
+    std::uint64_t GetU64(const std::uint8_t* p)
+    {
+        return GetU32(p) | (static_cast<std::uint64_t>(GetU32(p + 4)) << 32);
+    }
+
+    // Stripe k covers bytes [begin, end) of the frame; stripes need not be row aligned
+    size_t StripeBegin(size_t frameBytes, unsigned int stripes, unsigned int k)
+    {
+        return frameBytes * k / stripes;
+    }
+
+    // dst = a ^ b, word at a time (the compiler vectorizes this)
+    void XorBytes(std::uint8_t* dst, const std::uint8_t* a, const std::uint8_t* b, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t x, y;
+            std::memcpy(&x, a + i, 8);
+            std::memcpy(&y, b + i, 8);
+            x ^= y;
+            std::memcpy(dst + i, &x, 8);
+        }
+        for (; i < size; ++i) dst[i] = a[i] ^ b[i];
+    }
+}
+
+// --- WRITER ---
+bool MezzanineWriter::Open(const std::filesystem::path& path, sf::Vector2u frameSize, bool premultiplied,
+    unsigned int interval)
+{
+    size = frameSize;
+    keyInterval = std::max(1u, interval);
+    index.clear();
+    size_t frameBytes = static_cast<size_t>(size.x) * size.y * 4;
+    previous.assign(frameBytes, 0);
+    delta.resize(frameBytes);
+    stripes.assign(STRIPES, {});
+
+    streamBuffer.resize(1 << 20);
+    file.rdbuf()->pubsetbuf(streamBuffer.data(), static_cast<std::streamsize>(streamBuffer.size()));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    // Index offset stays 0 until Close; readers reject such files
+    std::uint8_t header[HEADER_SIZE] = { 'T', 'M', 'Z', '1' };
+    PutU32(header + 4, size.x);
+    PutU32(header + 8, size.y);
+    PutU32(header + 12, premultiplied ? MEZZ_FLAG_PREMULTIPLIED : 0);
+    PutU32(header + 16, keyInterval);
+    PutU32(header + 20, STRIPES);
+    file.write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+    position = HEADER_SIZE;
+    return static_cast<bool>(file);
+}
+
+bool MezzanineWriter::AddFrame(int sequence, const std::uint8_t* rgba)
+{
+    if (!file) return false;
+    bool key = index.size() % keyInterval == 0;
+    size_t frameBytes = previous.size();
+
+    ParallelFor(STRIPES, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            size_t b = StripeBegin(frameBytes, STRIPES, k);
+            size_t e = StripeBegin(frameBytes, STRIPES, k + 1);
+            const std::uint8_t* src = rgba + b;
+            if (!key) {
+                XorBytes(delta.data() + b, rgba + b, previous.data() + b, e - b);
+                src = delta.data() + b;
+            }
+            stripes[k].clear();
+            Lz4Compress(src, e - b, stripes[k]);
+            std::memcpy(previous.data() + b, rgba + b, e - b);
+        }
+    }, 1);
+
+    std::uint8_t sizes[STRIPES * 4];
+    std::uint64_t recordSize = sizeof(sizes);
+    for (unsigned int k = 0; k < STRIPES; ++k) {
+        PutU32(sizes + k * 4, static_cast<std::uint32_t>(stripes[k].size()));
+        recordSize += stripes[k].size();
+    }
+    file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    for (const auto& stripe : stripes)
+        file.write(reinterpret_cast<const char*>(stripe.data()), static_cast<std::streamsize>(stripe.size()));
+
+    index.push_back({ position, static_cast<std::uint32_t>(recordSize), sequence, key ? MEZZ_FLAG_KEY : 0 });
+    position += recordSize;
+    return static_cast<bool>(file);
+}
+
+bool MezzanineWriter::Close()
+{
+    if (!file.is_open()) return false;
+
+    std::vector<std::uint8_t> table(8 + index.size() * INDEX_ENTRY_SIZE);
+    std::memcpy(table.data(), "TMZI", 4);
+    PutU32(table.data() + 4, static_cast<std::uint32_t>(index.size()));
+    for (size_t i = 0; i < index.size(); ++i) {
+        std::uint8_t* p = table.data() + 8 + i * INDEX_ENTRY_SIZE;
+        PutU64(p, index[i].offset);
+        PutU32(p + 8, index[i].size);
+        PutU32(p + 12, static_cast<std::uint32_t>(index[i].sequence));
+        PutU32(p + 16, index[i].flags);
+    }
+    std::uint64_t indexOffset = position;
+    file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size()));
+    position += table.size();
+
+    std::uint8_t offset[8];
+    PutU64(offset, indexOffset);
+    file.seekp(24);
+    file.write(reinterpret_cast<const char*>(offset), sizeof(offset));
+    file.close();
+    return !file.fail();
+}
+
+// --- READER ---
+bool MezzanineReader::Open(const std::filesystem::path& path)
+{
+    index.clear();
+    currentPosition = -1;
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    std::uint8_t header[HEADER_SIZE];
+    if (!file.read(reinterpret_cast<char*>(header), HEADER_SIZE) || std::memcmp(header, "TMZ1", 4) != 0) return false;
+    size = { GetU32(header + 4), GetU32(header + 8) };
+    flags = GetU32(header + 12);
+    stripeCount = GetU32(header + 20);
+    std::uint64_t indexOffset = GetU64(header + 24);
+    if (size.x == 0 || size.y == 0 || stripeCount == 0 || stripeCount > MAX_STRIPES || indexOffset < HEADER_SIZE) return false;
+    // Sizes come from the file, so they are checked before anything is allocated from them
+    if (std::uint64_t(size.x) * size.y > MAX_FRAME_PIXELS) return false;
+
+    file.seekg(0, std::ios::end);
+    std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+    if (indexOffset > fileSize || fileSize - indexOffset < 8) return false;
+
+    std::uint8_t head[8];
+    file.seekg(static_cast<std::streamoff>(indexOffset));
+    if (!file.read(reinterpret_cast<char*>(head), 8) || std::memcmp(head, "TMZI", 4) != 0) return false;
+    std::uint64_t tableBytes = std::uint64_t(GetU32(head + 4)) * INDEX_ENTRY_SIZE;
+    if (tableBytes > fileSize - indexOffset - 8) return false;
+    std::vector<std::uint8_t> table(static_cast<size_t>(tableBytes));
+    if (!file.read(reinterpret_cast<char*>(table.data()), static_cast<std::streamsize>(table.size()))) return false;
+
+    index.resize(table.size() / INDEX_ENTRY_SIZE);
+    for (size_t i = 0; i < index.size(); ++i) {
+        const std::uint8_t* p = table.data() + i * INDEX_ENTRY_SIZE;
+        index[i] = { GetU64(p), GetU32(p + 8), static_cast<std::int32_t>(GetU32(p + 12)), GetU32(p + 16) };
+        if (index[i].size < stripeCount * 4 || index[i].offset > indexOffset || index[i].size > indexOffset - index[i].offset)
+            return false;
+    }
+    if (!index.empty() && !(index[0].flags & MEZZ_FLAG_KEY)) return false;
+
+    current.assign(static_cast<size_t>(size.x) * size.y * 4, 0);
+    return true;
+}
+
+bool MezzanineReader::DecodeNext(unsigned int position)
+{
+    const MezzanineEntry& entry = index[position];
+    record.resize(entry.size);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!file.read(reinterpret_cast<char*>(record.data()), entry.size)) return false;
+
+    std::vector<size_t> starts(stripeCount + 1, stripeCount * 4);
+    for (unsigned int k = 0; k < stripeCount; ++k) starts[k + 1] = starts[k] + GetU32(record.data() + k * 4);
+    if (starts[stripeCount] != entry.size) return false;
+
+    bool key = (entry.flags & MEZZ_FLAG_KEY) != 0;
+    size_t frameBytes = current.size();
+    std::atomic<bool> ok = true;
+    ParallelFor(stripeCount, [&](unsigned int begin, unsigned int end) {
+        std::vector<std::uint8_t> delta;
+        for (unsigned int k = begin; k < end; ++k) {
+            size_t b = StripeBegin(frameBytes, stripeCount, k);
+            size_t e = StripeBegin(frameBytes, stripeCount, k + 1);
+            const std::uint8_t* src = record.data() + starts[k];
+            size_t srcSize = starts[k + 1] - starts[k];
+            if (key) {
+                if (!Lz4Decompress(src, srcSize, current.data() + b, e - b)) ok = false;
+            }
+            else {
+                delta.resize(e - b);
+                if (!Lz4Decompress(src, srcSize, delta.data(), delta.size())) ok = false;
+                else XorBytes(current.data() + b, current.data() + b, delta.data(), delta.size());
+            }
+        }
+    }, 1);
+    currentPosition = ok ? position : -1;
+    return ok.load();
+}
+
+bool MezzanineReader::ReadFrame(unsigned int position, std::vector<std::uint8_t>& rgba)
+{
+    if (position >= index.size()) return false;
+
+    if (currentPosition != position) {
+        unsigned int key = position;
+        while (!(index[key].flags & MEZZ_FLAG_KEY)) --key;
+        // Continue from the decoded frame when it lies between the keyframe and the target
+        unsigned int from = (currentPosition >= key && currentPosition < position)
+            ? static_cast<unsigned int>(currentPosition) + 1 : key;
+        for (unsigned int i = from; i <= position; ++i) {
+            if (!DecodeNext(i)) return false;
+        }
+    }
+    rgba = current;
+    return true;
+}
+
+// --- CLI ---
+int RunMezzanineExtract(const std::string& path, const std::string& folder)
+{
+    MezzanineReader reader;
+    if (!reader.Open(path)) {
+        std::cerr << "Cannot read mezzanine file " << path << std::endl;
+        return 1;
+    }
+    if (!folder.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+    }
+
+    sf::Vector2u size = reader.Size();
+    std::vector<std::uint8_t> rgba;
+    double decodeMs = 0;
+    for (unsigned int i = 0; i < reader.FrameCount(); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.ReadFrame(i, rgba)) {
+            std::cerr << "Corrupt frame " << i << " in " << path << std::endl;
+            return 1;
+        }
+        decodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (!folder.empty()) {
+            std::filesystem::path file = std::filesystem::path(folder) / FrameFileName(reader.Sequence(i), FrameFormat::Qoi);
+            if (!WriteFrameFile(file, EncodeQoi(rgba.data(), size.x, size.y))) {
+                std::cerr << "Cannot write " << file.string() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    std::error_code ec;
+    long long fileBytes = static_cast<long long>(std::filesystem::file_size(path, ec));
+    long long rawBytes = static_cast<long long>(size.x) * size.y * 4 * reader.FrameCount();
+    std::cout << JsonWriter().Add("event", "done").Add("frames", static_cast<int>(reader.FrameCount()))
+        .Add("width", size.x).Add("height", size.y)
+        .Add("bytes", fileBytes).Add("ratio", fileBytes > 0 ? static_cast<double>(rawBytes) / fileBytes : 0.0)
+        .Add("decodeMs", decodeMs).Add("GBps", decodeMs > 0 ? rawBytes / (decodeMs * 1e6) : 0.0).str() << std::endl;
+    return 0;
+}
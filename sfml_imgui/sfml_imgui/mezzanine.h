@@ -0,0 +1,90 @@
+#ifndef MEZZANINE_H
+#define MEZZANINE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <SFML/System/Vector2.hpp>
+
+// Intermediate frame container (.tmz) for handing sequences to finishing steps.
+// Every frame is stored as the XOR against the previous frame (keyframes: against
+// zero), LZ4-compressed in independent horizontal stripes so both directions run on
+// all cores. Adjacent transition frames share most of their pixels, which leaves long
+// zero runs for the compressor. An index at the end of the file gives the offset of
+// every frame; a reader decodes from the nearest keyframe, so random access costs at
+// most 'keyInterval' frame decodes and sequential reads one.
+//
+// Layout (little-endian):
+//   header   "TMZ1" u32 width, u32 height, u32 flags, u32 keyInterval, u32 stripes, u64 indexOffset
+//   frame    u32 compressed size of each stripe, then the stripes
+//   index    "TMZI" u32 count, then per frame: u64 offset, u32 size, i32 sequence, u32 flags
+
+const std::uint32_t MEZZ_FLAG_PREMULTIPLIED = 1;   // Header: pixels carry premultiplied alpha
+const std::uint32_t MEZZ_FLAG_KEY = 1;             // Index: frame does not depend on its predecessor
+
+struct MezzanineEntry {
+    std::uint64_t offset = 0;     // File offset of the frame record
+    std::uint32_t size = 0;       // Record size in bytes
+    std::int32_t sequence = 0;
+    std::uint32_t flags = 0;
+};
+
+class MezzanineWriter {
+public:
+    static constexpr unsigned int DEFAULT_KEY_INTERVAL = 30;
+    static constexpr unsigned int STRIPES = 16;
+
+    bool Open(const std::filesystem::path& path, sf::Vector2u size, bool premultiplied,
+        unsigned int keyInterval = DEFAULT_KEY_INTERVAL);
+    // Appends one tightly packed RGBA8 frame of the size given to Open
+    bool AddFrame(int sequence, const std::uint8_t* rgba);
+    // Writes the index and patches the header; the file is unreadable before this
+    bool Close();
+
+    std::uint64_t BytesWritten() const { return position; }
+
+private:
+    std::ofstream file;
+    std::vector<char> streamBuffer;
+    sf::Vector2u size;
+    unsigned int keyInterval = DEFAULT_KEY_INTERVAL;
+    std::uint64_t position = 0;
+    std::vector<std::uint8_t> previous, delta;
+    std::vector<std::vector<std::uint8_t>> stripes;
+    std::vector<MezzanineEntry> index;
+};
+
+class MezzanineReader {
+public:
+    bool Open(const std::filesystem::path& path);
+
+    unsigned int FrameCount() const { return static_cast<unsigned int>(index.size()); }
+    sf::Vector2u Size() const { return size; }
+    bool Premultiplied() const { return (flags & MEZZ_FLAG_PREMULTIPLIED) != 0; }
+    // Frame number the writer was given for the frame at 'position'
+    int Sequence(unsigned int position) const { return index[position].sequence; }
+
+    // Decodes the frame at 'position' (0..FrameCount()-1) into tightly packed RGBA8.
+    // Reading forward continues from the last decoded frame; any other jump restarts at
+    // the keyframe before 'position'.
+    bool ReadFrame(unsigned int position, std::vector<std::uint8_t>& rgba);
+
+private:
+    bool DecodeNext(unsigned int position);
+
+    std::ifstream file;
+    sf::Vector2u size;
+    std::uint32_t flags = 0;
+    unsigned int stripeCount = 0;
+    std::vector<MezzanineEntry> index;
+    std::vector<std::uint8_t> record, current;
+    long long currentPosition = -1;
+};
+
+// --mezz-extract: decodes every frame of 'path' and prints the decode throughput.
+// With a 'folder' the frames are also written there as QOI files. Returns the exit code.
+int RunMezzanineExtract(const std::string& path, const std::string& folder);
+
+#endif //MEZZANINE_H
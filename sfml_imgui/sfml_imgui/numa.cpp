@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "numa.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#endif
+
+namespace {
+#ifdef _WIN32
+    // CPUs are numbered group * 64 + bit
+    std::vector<NumaNode> DetectNodes()
+    {
+        std::vector<NumaNode> nodes;
+        ULONG highest = 0;
+        if (!GetNumaHighestNodeNumber(&highest)) return nodes;
+
+        // The process mask describes group 0; CPUs of other groups are taken as available
+        DWORD_PTR processMask = 0, systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+
+        for (USHORT id = 0; id <= highest; ++id) {
+            GROUP_AFFINITY affinity = {};
+            if (!GetNumaNodeProcessorMaskEx(id, &affinity) || affinity.Mask == 0) continue;
+            KAFFINITY mask = affinity.Mask;
+            if (affinity.Group == 0 && processMask != 0) mask &= processMask;
+            NumaNode node;
+            node.id = id;
+            for (unsigned int bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit) {
+                if (mask & (KAFFINITY(1) << bit)) node.cpus.push_back(affinity.Group * 64u + bit);
+            }
+            if (!node.cpus.empty()) nodes.push_back(std::move(node));
+        }
+        return nodes;
+    }
+
+    bool BindThread(const NumaNode& node)
+    {
+        GROUP_AFFINITY affinity = {};
+        affinity.Group = static_cast<WORD>(node.cpus.front() / 64);
+        for (unsigned int cpu : node.cpus) {
+            if (cpu / 64 == affinity.Group) affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+        }
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+    }
+
+    bool BindProcess(const NumaNode& node)
+    {
+        // Threads start with the process mask, so that is what later threads inherit.
+        // A process mask cannot span groups; a node outside group 0 only binds this thread.
+        if (node.cpus.front() / 64 != 0) return BindThread(node);
+        DWORD_PTR mask = 0;
+        for (unsigned int cpu : node.cpus) {
+            if (cpu < 64) mask |= DWORD_PTR(1) << cpu;
+        }
+        return SetProcessAffinityMask(GetCurrentProcess(), mask) != 0 && BindThread(node);
+    }
+#elif defined(__linux__)
+    // Parses a sysfs CPU list such as "0-15,32-47"
+    std::vector<unsigned int> ParseCpuList(const std::string& text)
+    {
+        std::vector<unsigned int> cpus;
+        const char* p = text.c_str();
+        while (*p) {
+            char* end = nullptr;
+            unsigned long first = std::strtoul(p, &end, 10);
+            if (end == p) break;
+            unsigned long last = first;
+            p = end;
+            if (*p == '-') {
+                last = std::strtoul(p + 1, &end, 10);
+                p = end;
+            }
+            for (unsigned long cpu = first; cpu <= last; ++cpu) cpus.push_back(static_cast<unsigned int>(cpu));
+            if (*p != ',') break;
+            ++p;
+        }
+        return cpus;
+    }
+
+    std::vector<NumaNode> DetectNodes()
+    {
+        std::vector<NumaNode> nodes;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return nodes;
+
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) continue;
+            std::ifstream file(entry.path() / "cpulist");
+            std::string list;
+            std::getline(file, list);
+            NumaNode node;
+            node.id = static_cast<unsigned int>(std::strtoul(name.c_str() + 4, nullptr, 10));
+            for (unsigned int cpu : ParseCpuList(list)) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+            }
+            if (!node.cpus.empty()) nodes.push_back(std::move(node));
+        }
+        std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+        return nodes;
+    }
+
+    bool BindThread(const NumaNode& node)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned int cpu : node.cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        // pid 0 is the calling thread; threads it creates later inherit the mask
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    bool BindProcess(const NumaNode& node) { return BindThread(node); }
+#else
+    std::vector<NumaNode> DetectNodes() { return {}; }
+    bool BindThread(const NumaNode&) { return false; }
+    bool BindProcess(const NumaNode&) { return false; }
+#endif
+}
+
+const std::vector<NumaNode>& NumaTopology()
+{
+    static const std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> detected = DetectNodes();
+        if (detected.empty()) {
+            // Unknown topology: one node holding every hardware thread
+            NumaNode all;
+            unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned int cpu = 0; cpu < threads; ++cpu) all.cpus.push_back(cpu);
+            detected.push_back(std::move(all));
+        }
+        return detected;
+    }();
+    return nodes;
+}
+
+bool BindThreadToNode(unsigned int index)
+{
+    const std::vector<NumaNode>& nodes = NumaTopology();
+    return index < nodes.size() && nodes.size() > 1 && BindThread(nodes[index]);
+}
+
+bool BindProcessToNode(unsigned int id)
+{
+    // Detected independently of NumaTopology(), which must not be cached before binding
+    for (const NumaNode& node : DetectNodes()) {
+        if (node.id == id) return BindProcess(node);
+    }
+    return false;
+}
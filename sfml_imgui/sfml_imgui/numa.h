@@ -0,0 +1,30 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+
+// --- NUMA TOPOLOGY ---
+// Memory is placed on the node of the thread that first touches it, so on multi-socket
+// machines work is kept next to its data by pinning threads to nodes: the ParallelFor
+// workers are spread over the nodes in blocks, and shard workers bind to one node each.
+// On single-node machines (or when the topology is unknown) nothing is pinned.
+
+struct NumaNode {
+    unsigned int id = 0;              // OS node number
+    std::vector<unsigned int> cpus;   // Logical CPUs of the node this process may run on
+};
+
+// Nodes with at least one CPU available to this process, in id order; never empty.
+// Detected once, on first use, so a process that binds itself first sees only its node.
+const std::vector<NumaNode>& NumaTopology();
+
+inline unsigned int NumaNodeCount() { return static_cast<unsigned int>(NumaTopology().size()); }
+
+// Restricts the calling thread to the CPUs of NumaTopology()[index]
+bool BindThreadToNode(unsigned int index);
+
+// Restricts the whole process to the CPUs of node 'id' (OS node number). Call it at start-up,
+// before any other thread exists, so every thread started later inherits the binding.
+bool BindProcessToNode(unsigned int id);
+
+#endif //NUMA_H
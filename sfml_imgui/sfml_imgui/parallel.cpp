@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "parallel.h"
+#include "worker_pool.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+    const unsigned int MAX_THREAD_LIMIT = 4096;
+
+    bool ParseThreadCount(const std::string& value, unsigned int& threads)
+    {
+        char* end = nullptr;
+        unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed < 1 || parsed > MAX_THREAD_LIMIT) return false;
+        threads = static_cast<unsigned int>(parsed);
+        return true;
+    }
+
+    unsigned int InitialThreadLimit()
+    {
+        unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+        const char* value = std::getenv(THREADS_ENV_VAR);
+        if (!value || !*value) return hardware;
+
+        unsigned int threads = 0;
+        if (!ParseThreadCount(value, threads)) {
+            std::cerr << "Ignoring " << THREADS_ENV_VAR << "=" << value << ": not a thread count" << std::endl;
+            return hardware;
+        }
+        return threads;
+    }
+
+    unsigned int& ThreadLimitStorage()
+    {
+        static unsigned int limit = InitialThreadLimit();
+        return limit;
+    }
+
+    // Spread over the NUMA nodes; the caller takes the first chunk itself, so one worker
+    // fewer than the thread limit
+    WorkerPool& ParallelWorkers()
+    {
+        static WorkerPool pool(std::max(2u, ParallelThreadLimit()) - 1, true);
+        return pool;
+    }
+}
+
+unsigned int ParallelThreadLimit()
+{
+    return ThreadLimitStorage();
+}
+
+bool SetParallelThreadLimit(const std::string& value, std::string& error)
+{
+    unsigned int threads = 0;
+    if (!ParseThreadCount(value, threads)) {
+        error = "thread count must be 1.." + std::to_string(MAX_THREAD_LIMIT) + ", got '" + value + "'";
+        return false;
+    }
+    ThreadLimitStorage() = threads;
+#ifdef _WIN32
+    _putenv_s(THREADS_ENV_VAR, value.c_str());
+#else
+    setenv(THREADS_ENV_VAR, value.c_str(), 1);
+#endif
+    return true;
+}
+
+unsigned int ParallelTaskCount(unsigned int count, unsigned int minPerTask)
+{
+    unsigned int threads = ParallelThreadLimit();
+    unsigned int byWork = std::max(1u, count / std::max(1u, minPerTask));
+    return std::min(threads, byWork);
+}
+
+void ParallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& body,
+    unsigned int minPerTask)
+{
+    if (count == 0) return;
+
+    unsigned int tasks = ParallelTaskCount(count, minPerTask);
+    // A nested loop inside a chunk runs inline: the other workers may all be busy with the outer one
+    if (tasks == 1 || ParallelWorkers().IsWorkerThread()) {
+        body(0, count);
+        return;
+    }
+
+    unsigned int chunk = (count + tasks - 1) / tasks;
+    std::mutex mutex;
+    std::condition_variable finished;
+    unsigned int remaining = 0;
+
+    // Chunk t always goes to worker t - 1. Loops over the same buffer with the same count
+    // therefore touch each band from the same NUMA node every time, and a buffer whose
+    // pages were first written by such a loop (see pixel_buffer.h) stays local to it.
+    for (unsigned int t = 1; t < tasks; ++t) {
+        unsigned int begin = t * chunk;
+        unsigned int end = std::min(count, begin + chunk);
+        if (begin >= end) break;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining++;
+        }
+        ParallelWorkers().PostTo(t - 1, [&, begin, end] {
+            body(begin, end);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) finished.notify_one();
+        });
+    }
+    body(0, std::min(count, chunk));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return remaining == 0; });
+}
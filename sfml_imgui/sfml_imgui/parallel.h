@@ -0,0 +1,30 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+#include <string>
+
+// Environment variable that caps the threads ParallelFor uses, e.g. TRANSITIONS_THREADS=1
+const char* const THREADS_ENV_VAR = "TRANSITIONS_THREADS";
+
+// Splits [0, count) into contiguous chunks and runs them on all hardware threads.
+// The callback receives a half-open range [begin, end) and is called once per chunk.
+// Small workloads (below minPerTask items) run inline on the calling thread.
+// Chunks run on a persistent worker pool spread over the NUMA nodes, and a given chunk
+// of a given count always lands on the same worker.
+void ParallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& body,
+    unsigned int minPerTask = 64);
+
+// Number of chunks ParallelFor will use for a given workload
+unsigned int ParallelTaskCount(unsigned int count, unsigned int minPerTask = 64);
+
+// Threads ParallelFor spreads over: all hardware threads unless capped by the environment
+// variable or SetParallelThreadLimit
+unsigned int ParallelThreadLimit();
+
+// Caps the threads, e.g. for --threads on the command line. Has to run before the first
+// ParallelFor. Like the ISA limit, the cap is also put into the environment for worker
+// processes started later. Fails for anything but a positive number.
+bool SetParallelThreadLimit(const std::string& value, std::string& error);
+
+#endif //PARALLEL_H
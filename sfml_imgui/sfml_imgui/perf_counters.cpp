@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "perf_counters.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char* const EVENT_NAMES[COUNTER_EVENT_COUNT] = { "cycles", "instructions", "llcMisses", "branchMisses" };
+
+    std::atomic<bool> countersEnabled{ false };
+    std::atomic<int> countedTransition{ -1 };
+
+    struct TotalsRegistry {
+        std::mutex mutex;
+        std::map<std::pair<int, std::string>, size_t> index;
+        std::vector<KernelCounterTotals> totals;
+    };
+
+    TotalsRegistry& Totals()
+    {
+        static TotalsRegistry registry;
+        return registry;
+    }
+
+#ifdef __linux__
+    const std::uint64_t EVENT_CONFIGS[COUNTER_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+    // One group per thread, led by the cycle counter so all four are scheduled together.
+    // Closed when the thread exits.
+    struct ThreadCounters {
+        int fds[COUNTER_EVENT_COUNT] = { -1, -1, -1, -1 };
+        int openError = 0;        // errno of the cycle counter, 0 when it opened
+        bool opened = false;
+
+        void Open()
+        {
+            opened = true;
+            int leader = -1;
+            for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = EVENT_CONFIGS[e];
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                attr.exclude_kernel = 1;  // Allowed up to perf_event_paranoid 2
+                attr.exclude_hv = 1;
+                long fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+                if (fd < 0) {
+                    if (e == 0) {
+                        openError = errno;
+                        return;
+                    }
+                    continue;
+                }
+                fds[e] = static_cast<int>(fd);
+                if (e == 0) leader = fds[e];
+            }
+        }
+
+        ~ThreadCounters()
+        {
+            for (int fd : fds)
+                if (fd >= 0) close(fd);
+        }
+    };
+
+    ThreadCounters& CurrentThreadCounters()
+    {
+        thread_local ThreadCounters counters;
+        if (!counters.opened) counters.Open();
+        return counters;
+    }
+
+    std::string OpenErrorText(int error)
+    {
+        std::string text = std::string("perf_event_open: ") + std::strerror(error);
+        if (error == EACCES || error == EPERM) {
+            std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+            int paranoid = 0;
+            if (file >> paranoid) text += " (kernel.perf_event_paranoid is " + std::to_string(paranoid) + ", needs 2 or less)";
+        }
+        else if (error == ENOENT || error == EOPNOTSUPP) {
+            text += " (no hardware counters, e.g. a virtual machine without a virtual PMU)";
+        }
+        return text;
+    }
+#endif
+
+    void AddTotals(const char* kernel, std::uint64_t pixels, double ms,
+        const std::uint64_t values[COUNTER_EVENT_COUNT], const bool counted[COUNTER_EVENT_COUNT])
+    {
+        TotalsRegistry& registry = Totals();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::pair<int, std::string> key(countedTransition.load(std::memory_order_relaxed), kernel);
+        auto it = registry.index.find(key);
+        if (it == registry.index.end()) {
+            it = registry.index.emplace(key, registry.totals.size()).first;
+            registry.totals.emplace_back();
+            registry.totals.back().transition = key.first;
+            registry.totals.back().kernel = key.second;
+        }
+        KernelCounterTotals& totals = registry.totals[it->second];
+        totals.calls++;
+        totals.pixels += pixels;
+        totals.ms += ms;
+        for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+            if (!counted[e]) continue;
+            totals.values[e] += values[e];
+            totals.countedPixels[e] += pixels;
+            totals.counted[e] = true;
+        }
+    }
+}
+
+const char* CounterEventName(CounterEvent event)
+{
+    return EVENT_NAMES[static_cast<int>(event)];
+}
+
+bool ReadThreadCounters(CounterReading& reading)
+{
+    reading = CounterReading();
+#ifdef __linux__
+    ThreadCounters& counters = CurrentThreadCounters();
+    bool any = false;
+    for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+        if (counters.fds[e] < 0) continue;
+        std::uint64_t data[3];
+        if (read(counters.fds[e], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+        reading.values[e] = data[0];
+        reading.enabled[e] = data[1];
+        reading.running[e] = data[2];
+        reading.open[e] = true;
+        any = true;
+    }
+    return any;
+#else
+    return false;
+#endif
+}
+
+void CounterDelta(const CounterReading& begin, const CounterReading& end,
+    std::uint64_t values[COUNTER_EVENT_COUNT], bool counted[COUNTER_EVENT_COUNT])
+{
+    for (int e = 0; e < COUNTER_EVENT_COUNT; ++e) {
+        values[e] = 0;
+        counted[e] = false;
+        if (!begin.open[e] || !end.open[e]) continue;
+        std::uint64_t running = end.running[e] - begin.running[e];
+        if (running == 0) continue;
+        std::uint64_t enabled = end.enabled[e] - begin.enabled[e];
+        double value = static_cast<double>(end.values[e] - begin.values[e]);
+        if (enabled > running) value *= static_cast<double>(enabled) / running;
+        values[e] = static_cast<std::uint64_t>(value + 0.5);
+        counted[e] = true;
+    }
+}
+
+bool EnableKernelCounters(std::string& status)
+{
+    TakeKernelCounterTotals();
+    countersEnabled = true;
+#ifdef __linux__
+    ThreadCounters& counters = CurrentThreadCounters();
+    if (counters.fds[0] < 0) {
+        status = OpenErrorText(counters.openError);
+        return false;
+    }
+    int open = 0;
+    for (int fd : counters.fds) open += fd >= 0 ? 1 : 0;
+    status = open == COUNTER_EVENT_COUNT ? "all counters open" : "some counters are not supported by this CPU";
+    return true;
+#else
+    status = "hardware counters are only read on Linux";
+    return false;
+#endif
+}
+
+void DisableKernelCounters()
+{
+    countersEnabled = false;
+}
+
+void SetCounterTransition(int transition)
+{
+    countedTransition = transition;
+}
+
+std::vector<KernelCounterTotals> TakeKernelCounterTotals()
+{
+    TotalsRegistry& registry = Totals();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<KernelCounterTotals> totals = std::move(registry.totals);
+    registry.totals.clear();
+    registry.index.clear();
+    return totals;
+}
+
+KernelCounterScope::KernelCounterScope(const char* kernel, std::uint64_t pixels)
+    : kernel(kernel), pixels(pixels)
+{
+    if (!countersEnabled.load(std::memory_order_relaxed)) return;
+    active = true;
+    ReadThreadCounters(start);
+    startTime = std::chrono::steady_clock::now();
+}
+
+KernelCounterScope::~KernelCounterScope()
+{
+    if (!active) return;
+    auto endTime = std::chrono::steady_clock::now();
+    CounterReading end;
+    ReadThreadCounters(end);
+    std::uint64_t values[COUNTER_EVENT_COUNT];
+    bool counted[COUNTER_EVENT_COUNT];
+    CounterDelta(start, end, values, counted);
+    AddTotals(kernel, pixels, std::chrono::duration<double, std::milli>(endTime - startTime).count(), values, counted);
+}
@@ -0,0 +1,83 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --- HARDWARE COUNTERS ---
+// Optional instrumentation of the CPU kernels. While enabled, every KernelCounterScope
+// reads cycles, retired instructions, last-level cache misses and branch misses of its
+// own thread (perf_event_open on Linux, user space only) and adds them to the totals of
+// its kernel and the current transition. Each thread, including the ParallelFor workers,
+// opens its counters on first use.
+// Counters can be missing: other platforms, kernel.perf_event_paranoid above 2, virtual
+// machines without a PMU, or single events the CPU lacks. The scopes then still count
+// calls, pixels and time, and the report leaves out what was not measured.
+
+enum class CounterEvent { Cycles = 0, Instructions = 1, LlcMisses = 2, BranchMisses = 3 };
+const int COUNTER_EVENT_COUNT = 4;
+
+// "cycles", "instructions", "llcMisses", "branchMisses"
+const char* CounterEventName(CounterEvent event);
+
+// Starts collecting and clears the totals. Returns true when the calling thread could open
+// at least the cycle counter; otherwise 'status' says why and only times are collected.
+bool EnableKernelCounters(std::string& status);
+void DisableKernelCounters();
+
+// Transition the counts of all threads are booked to (-1: none). Process-wide, since the
+// kernels of one frame run on several threads; set it between frames.
+void SetCounterTransition(int transition);
+
+// Raw counts of the calling thread since its counters were opened
+struct CounterReading {
+    std::uint64_t values[COUNTER_EVENT_COUNT] = {};
+    std::uint64_t enabled[COUNTER_EVENT_COUNT] = {};   // Time the event was enabled / running,
+    std::uint64_t running[COUNTER_EVENT_COUNT] = {};   // for scaling when events are multiplexed
+    bool open[COUNTER_EVENT_COUNT] = {};
+};
+
+// Opens the calling thread's counters on first use (enabled or not). Returns false when
+// none could be opened.
+bool ReadThreadCounters(CounterReading& reading);
+
+// Counts between two readings, scaled up when an event only ran part of the time.
+// 'counted' is false for events that were not open or never ran in between.
+void CounterDelta(const CounterReading& begin, const CounterReading& end,
+    std::uint64_t values[COUNTER_EVENT_COUNT], bool counted[COUNTER_EVENT_COUNT]);
+
+struct KernelCounterTotals {
+    int transition = -1;
+    std::string kernel;
+    std::uint64_t calls = 0;
+    std::uint64_t pixels = 0;
+    double ms = 0.0;              // Summed over threads, like the counters
+    // Per event: sum over the calls where the event was counted, and their pixels
+    std::uint64_t values[COUNTER_EVENT_COUNT] = {};
+    std::uint64_t countedPixels[COUNTER_EVENT_COUNT] = {};
+    bool counted[COUNTER_EVENT_COUNT] = {};
+};
+
+// Totals per (transition, kernel) in first-use order, and clears them
+std::vector<KernelCounterTotals> TakeKernelCounterTotals();
+
+// Wraps one kernel invocation; 'kernel' must be a string literal. Costs one relaxed atomic
+// load while counters are disabled.
+class KernelCounterScope {
+public:
+    KernelCounterScope(const char* kernel, std::uint64_t pixels);
+    ~KernelCounterScope();
+    KernelCounterScope(const KernelCounterScope&) = delete;
+    KernelCounterScope& operator=(const KernelCounterScope&) = delete;
+
+private:
+    const char* kernel = nullptr;
+    std::uint64_t pixels = 0;
+    bool active = false;
+    CounterReading start;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+#endif //PERF_COUNTERS_H
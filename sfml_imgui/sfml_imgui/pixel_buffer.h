@@ -0,0 +1,37 @@
+#ifndef PIXEL_BUFFER_H
+#define PIXEL_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "huge_pages.h"
+
+// Allocator whose value-initialization is a no-op, so resize() leaves new elements
+// unwritten. Each page is then first touched, and on NUMA machines placed, by whichever
+// ParallelFor worker writes it first instead of by the thread that resized the buffer.
+// Large buffers are mapped on huge pages where available (huge_pages.h).
+// Only for buffers that are completely overwritten before they are read.
+template <typename T>
+struct FirstTouchAllocator : std::allocator<T> {
+    template <typename U> struct rebind { using other = FirstTouchAllocator<U>; };
+
+    FirstTouchAllocator() = default;
+    template <typename U> FirstTouchAllocator(const FirstTouchAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(AllocatePixelMemory(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) noexcept { FreePixelMemory(p, n * sizeof(T)); }
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+};
+
+// RGBA8 (or plane) scratch written by the parallel kernels
+using PixelBuffer = std::vector<std::uint8_t, FirstTouchAllocator<std::uint8_t>>;
+
+#endif //PIXEL_BUFFER_H
@@ -0,0 +1,543 @@
+#include "pch.h"
+#include "pixel_expr.h"
+#include "parallel.h"
+#include "transitions.h"
+#include "det_math.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+    const int MAX_REGISTERS = 255;
+    const float SNAP_EPSILON = 1e-4f;
+
+    enum Op : std::uint8_t {
+        OP_LOAD_U, OP_LOAD_V, OP_LOAD_X, OP_LOAD_Y,
+        OP_NEG, OP_ABS, OP_FLOOR, OP_FRACT, OP_SQRT, OP_SIN, OP_COS,
+        OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MIN, OP_MAX, OP_POW, OP_STEP,
+        OP_LESS, OP_GREATER, OP_LESS_EQ, OP_GREATER_EQ,
+        OP_MIX, OP_CLAMP, OP_SMOOTHSTEP, OP_SELECT,
+        OP_SAMPLE_A, OP_SAMPLE_B, OP_NOISE, OP_LUMA, OP_LENGTH
+    };
+
+    struct Token {
+        enum Kind { Number, Name, Symbol, End } kind;
+        std::string text;
+        float number = 0.0f;
+        int line = 1;
+    };
+
+    // Newlines are returned as ';' so they separate statements like semicolons do
+    std::vector<Token> Tokenize(const std::string& source, std::string& error)
+    {
+        std::vector<Token> tokens;
+        int line = 1;
+        for (size_t i = 0; i < source.size();) {
+            char c = source[i];
+            if (c == '#') {
+                while (i < source.size() && source[i] != '\n') ++i;
+                continue;
+            }
+            if (c == '\n') { tokens.push_back({ Token::Symbol, ";", 0.0f, line++ }); ++i; continue; }
+            if (std::isspace(static_cast<unsigned char>(c))) { ++i; continue; }
+            if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < source.size() && std::isdigit(static_cast<unsigned char>(source[i + 1])))) {
+                char* end = nullptr;
+                float value = std::strtof(source.c_str() + i, &end);
+                size_t length = static_cast<size_t>(end - (source.c_str() + i));
+                tokens.push_back({ Token::Number, source.substr(i, length), value, line });
+                i += length;
+                continue;
+            }
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                size_t start = i;
+                while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) ++i;
+                tokens.push_back({ Token::Name, source.substr(start, i - start), 0.0f, line });
+                continue;
+            }
+            if ((c == '<' || c == '>') && i + 1 < source.size() && source[i + 1] == '=') {
+                tokens.push_back({ Token::Symbol, source.substr(i, 2), 0.0f, line });
+                i += 2;
+                continue;
+            }
+            if (std::string("+-*/(),?:<>=;").find(c) == std::string::npos) {
+                error = "line " + std::to_string(line) + ": unexpected character '" + std::string(1, c) + "'";
+                return {};
+            }
+            tokens.push_back({ Token::Symbol, std::string(1, c), 0.0f, line });
+            ++i;
+        }
+        tokens.push_back({ Token::End, "", 0.0f, line });
+        return tokens;
+    }
+
+    inline float Hash2(int x, int y)
+    {
+        std::uint32_t h = static_cast<std::uint32_t>(x) * 374761393u + static_cast<std::uint32_t>(y) * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return static_cast<float>(h ^ (h >> 16)) * (1.0f / 4294967295.0f);
+    }
+
+    // Smooth value noise with one lattice cell per unit
+    inline float ValueNoise(float x, float y)
+    {
+        float fx = std::floor(x), fy = std::floor(y);
+        int ix = static_cast<int>(fx), iy = static_cast<int>(fy);
+        float tx = x - fx, ty = y - fy;
+        tx = tx * tx * (3.0f - 2.0f * tx);
+        ty = ty * ty * (3.0f - 2.0f * ty);
+        float top = Hash2(ix, iy) + (Hash2(ix + 1, iy) - Hash2(ix, iy)) * tx;
+        float bottom = Hash2(ix, iy + 1) + (Hash2(ix + 1, iy + 1) - Hash2(ix, iy + 1)) * tx;
+        return top + (bottom - top) * ty;
+    }
+
+    // Bilinear sample of LANES points of an image stretched over 0..1, edges clamped.
+    // Coordinates and weights are computed in plain lane loops; only the texel fetch is
+    // scalar. Points on texel centres (inputs already at canvas size) take one fetch.
+    void SampleBilinear(const sf::Image& image, const float* u, const float* v, float* r, float* g, float* b, float* a)
+    {
+        const int lanes = PixelProgram::LANES;
+        sf::Vector2u size = image.getSize();
+        if (size.x == 0 || size.y == 0) {
+            for (int l = 0; l < lanes; ++l) r[l] = g[l] = b[l] = a[l] = 0.0f;
+            return;
+        }
+        float maxX = static_cast<float>(size.x - 1), maxY = static_cast<float>(size.y - 1);
+        unsigned int ix[lanes], iy[lanes];
+        float fx[lanes], fy[lanes];
+        for (int l = 0; l < lanes; ++l) {
+            float px = std::min(std::max(u[l] * size.x - 0.5f, 0.0f), maxX);
+            float py = std::min(std::max(v[l] * size.y - 0.5f, 0.0f), maxY);
+            // Rounding to the nearest texel first snaps float error around texel centres,
+            // which is far below one 8-bit step
+            ix[l] = static_cast<unsigned int>(px + 0.5f);
+            iy[l] = static_cast<unsigned int>(py + 0.5f);
+            fx[l] = px - ix[l];
+            fy[l] = py - iy[l];
+            if (std::fabs(fx[l]) < SNAP_EPSILON) fx[l] = 0.0f;
+            if (std::fabs(fy[l]) < SNAP_EPSILON) fy[l] = 0.0f;
+            if (fx[l] < 0.0f) { --ix[l]; fx[l] += 1.0f; }
+            if (fy[l] < 0.0f) { --iy[l]; fy[l] += 1.0f; }
+        }
+
+        const std::uint8_t* pixels = image.getPixelsPtr();
+        const float scale = 1.0f / 255.0f;
+        for (int l = 0; l < lanes; ++l) {
+            unsigned int x0 = ix[l], y0 = iy[l];
+            const std::uint8_t* p00 = pixels + (static_cast<size_t>(y0) * size.x + x0) * 4;
+            if (fx[l] == 0.0f && fy[l] == 0.0f) {
+                r[l] = p00[0] * scale; g[l] = p00[1] * scale; b[l] = p00[2] * scale; a[l] = p00[3] * scale;
+                continue;
+            }
+            size_t dx = x0 + 1 < size.x ? 4 : 0;
+            size_t dy = y0 + 1 < size.y ? static_cast<size_t>(size.x) * 4 : 0;
+            const std::uint8_t* p10 = p00 + dx;
+            const std::uint8_t* p01 = p00 + dy;
+            const std::uint8_t* p11 = p01 + dx;
+            float w00 = (1 - fx[l]) * (1 - fy[l]) * scale, w10 = fx[l] * (1 - fy[l]) * scale;
+            float w01 = (1 - fx[l]) * fy[l] * scale, w11 = fx[l] * fy[l] * scale;
+            r[l] = p00[0] * w00 + p10[0] * w10 + p01[0] * w01 + p11[0] * w11;
+            g[l] = p00[1] * w00 + p10[1] * w10 + p01[1] * w01 + p11[1] * w11;
+            b[l] = p00[2] * w00 + p10[2] * w10 + p01[2] * w01 + p11[2] * w11;
+            a[l] = p00[3] * w00 + p10[3] * w10 + p01[3] * w01 + p11[3] * w11;
+        }
+    }
+}
+
+// --- COMPILER ---
+// Recursive descent straight to bytecode. Every value gets fresh registers (there is no
+// control flow, so nothing is ever overwritten); colours are four scalar registers and
+// colour arithmetic is lowered to one instruction per channel.
+class PixelCompiler {
+public:
+    PixelCompiler(std::vector<Token> tokens, PixelProgram& program) : tokens(std::move(tokens)), program(program) {}
+
+    bool Compile(std::string& error)
+    {
+        Value result;
+        bool haveResult = false;
+        while (!failed && Peek().kind != Token::End) {
+            if (Accept(";")) continue;
+            if (Peek().kind == Token::Name && tokens[pos + 1].text == "=") {
+                std::string name = Next().text;
+                Next();
+                if (IsBuiltin(name)) { Fail("cannot assign to built-in '" + name + "'"); break; }
+                variables[name] = Expression();
+                haveResult = false;
+            }
+            else {
+                result = Expression();
+                haveResult = true;
+            }
+            if (!failed && !Accept(";") && Peek().kind != Token::End) Fail("expected end of statement, found '" + Peek().text + "'");
+        }
+        if (!failed && !haveResult) Fail("the script must end with the output colour");
+        if (failed) {
+            error = message;
+            return false;
+        }
+        for (int c = 0; c < 4; ++c)
+            program.output[c] = result.color ? result.reg[c] : (c == 3 ? Constant(1.0f).reg[0] : result.reg[0]);
+        if (failed) {
+            error = message;
+            return false;
+        }
+        program.registerCount = nextRegister;
+        return true;
+    }
+
+private:
+    struct Value {
+        bool color = false;
+        std::uint8_t reg[4] = {};
+    };
+
+    const Token& Peek() const { return tokens[pos]; }
+    const Token& Next() { return tokens[pos < tokens.size() - 1 ? pos++ : pos]; }
+    bool Accept(const char* symbol)
+    {
+        if (Peek().kind == Token::Symbol && Peek().text == symbol) { ++pos; return true; }
+        return false;
+    }
+    void Expect(const char* symbol)
+    {
+        if (!Accept(symbol)) Fail(std::string("expected '") + symbol + "', found '" + Peek().text + "'");
+    }
+
+    Value Fail(const std::string& text)
+    {
+        if (!failed) message = "line " + std::to_string(Peek().line) + ": " + text;
+        failed = true;
+        pos = tokens.size() - 1;   // Park on End so every loop stops
+        return Value();
+    }
+
+    static bool IsBuiltin(const std::string& name)
+    {
+        static const char* names[] = { "u", "v", "x", "y", "progress", "width", "height", "aspect" };
+        return std::find_if(std::begin(names), std::end(names), [&](const char* n) { return name == n; }) != std::end(names);
+    }
+
+    std::uint8_t NewRegister()
+    {
+        if (nextRegister >= MAX_REGISTERS) {
+            Fail("script is too complex");
+            return 0;
+        }
+        return static_cast<std::uint8_t>(nextRegister++);
+    }
+
+    void Emit(Op op, std::uint8_t dst, std::uint8_t a = 0, std::uint8_t b = 0, std::uint8_t c = 0)
+    {
+        program.code.push_back({ op, dst, a, b, c });
+    }
+
+    Value Scalar(std::uint8_t reg)
+    {
+        Value v;
+        v.reg[0] = reg;
+        return v;
+    }
+
+    Value Constant(float value)
+    {
+        auto found = constants.find(value);
+        if (found != constants.end()) return Scalar(found->second);
+        std::uint8_t reg = NewRegister();
+        constants[value] = reg;
+        program.constants.push_back({ reg, value });
+        return Scalar(reg);
+    }
+
+    // Per-pixel inputs are loaded once, at their first use
+    Value Input(const std::string& name)
+    {
+        auto found = inputs.find(name);
+        if (found != inputs.end()) return Scalar(found->second);
+        std::uint8_t reg = NewRegister();
+        if (name == "progress") program.progressRegister = reg;
+        else Emit(name == "u" ? OP_LOAD_U : name == "v" ? OP_LOAD_V : name == "x" ? OP_LOAD_X : OP_LOAD_Y, reg);
+        inputs[name] = reg;
+        return Scalar(reg);
+    }
+
+    // Applies a scalar op channel-wise; scalars broadcast against colours
+    Value Elementwise(Op op, const std::vector<Value>& args)
+    {
+        bool color = std::any_of(args.begin(), args.end(), [](const Value& v) { return v.color; });
+        Value out;
+        out.color = color;
+        for (int c = 0; c < (color ? 4 : 1); ++c) {
+            std::uint8_t r[3] = {};
+            for (size_t i = 0; i < args.size(); ++i) r[i] = args[i].color ? args[i].reg[c] : args[i].reg[0];
+            out.reg[c] = NewRegister();
+            Emit(op, out.reg[c], r[0], r[1], r[2]);
+        }
+        return out;
+    }
+
+    Value Expression()
+    {
+        Value cond = Comparison();
+        if (!Accept("?")) return cond;
+        Value a = Expression();
+        Expect(":");
+        Value b = Expression();
+        return Elementwise(OP_SELECT, { cond, a, b });
+    }
+
+    Value Comparison()
+    {
+        Value left = Additive();
+        struct { const char* symbol; Op op; } ops[] = {
+            { "<=", OP_LESS_EQ }, { ">=", OP_GREATER_EQ }, { "<", OP_LESS }, { ">", OP_GREATER } };
+        for (const auto& o : ops) {
+            if (Accept(o.symbol)) return Elementwise(o.op, { left, Additive() });
+        }
+        return left;
+    }
+
+    Value Additive()
+    {
+        Value left = Multiplicative();
+        while (!failed) {
+            if (Accept("+")) left = Elementwise(OP_ADD, { left, Multiplicative() });
+            else if (Accept("-")) left = Elementwise(OP_SUB, { left, Multiplicative() });
+            else break;
+        }
+        return left;
+    }
+
+    Value Multiplicative()
+    {
+        Value left = Unary();
+        while (!failed) {
+            if (Accept("*")) left = Elementwise(OP_MUL, { left, Unary() });
+            else if (Accept("/")) left = Elementwise(OP_DIV, { left, Unary() });
+            else break;
+        }
+        return left;
+    }
+
+    Value Unary()
+    {
+        if (Accept("-")) {
+            if (Peek().kind == Token::Number) return Constant(-Next().number);
+            return Elementwise(OP_NEG, { Unary() });
+        }
+        return Primary();
+    }
+
+    Value Primary()
+    {
+        const Token& token = Peek();
+        if (token.kind == Token::Number) return Constant(Next().number);
+        if (Accept("(")) {
+            Value v = Expression();
+            Expect(")");
+            return v;
+        }
+        if (token.kind != Token::Name) return Fail("unexpected '" + token.text + "'");
+
+        std::string name = Next().text;
+        if (!Accept("(")) {
+            if (name == "width") return Constant(static_cast<float>(canvasWidth));
+            if (name == "height") return Constant(static_cast<float>(canvasHeight));
+            if (name == "aspect") return Constant(static_cast<float>(canvasWidth) / canvasHeight);
+            if (IsBuiltin(name)) return Input(name);
+            auto found = variables.find(name);
+            if (found == variables.end()) return Fail("unknown name '" + name + "'");
+            return found->second;
+        }
+
+        std::vector<Value> args;
+        if (!Accept(")")) {
+            do { args.push_back(Expression()); } while (!failed && Accept(","));
+            Expect(")");
+        }
+        if (failed) return Value();
+        return Call(name, args);
+    }
+
+    Value Call(const std::string& name, const std::vector<Value>& args)
+    {
+        struct Builtin { const char* name; Op op; size_t arity; };
+        static const Builtin elementwise[] = {
+            { "abs", OP_ABS, 1 }, { "floor", OP_FLOOR, 1 }, { "fract", OP_FRACT, 1 }, { "sqrt", OP_SQRT, 1 },
+            { "sin", OP_SIN, 1 }, { "cos", OP_COS, 1 },
+            { "min", OP_MIN, 2 }, { "max", OP_MAX, 2 }, { "pow", OP_POW, 2 }, { "step", OP_STEP, 2 },
+            { "mix", OP_MIX, 3 }, { "clamp", OP_CLAMP, 3 }, { "smoothstep", OP_SMOOTHSTEP, 3 } };
+
+        auto arity = [&](size_t n) {
+            if (args.size() == n) return true;
+            Fail(name + "() takes " + std::to_string(n) + " arguments");
+            return false;
+        };
+        auto scalars = [&]() {
+            for (const Value& v : args) {
+                if (v.color) { Fail(name + "() takes numbers, not colours"); return false; }
+            }
+            return true;
+        };
+
+        for (const Builtin& f : elementwise) {
+            if (name == f.name) return arity(f.arity) ? Elementwise(f.op, args) : Value();
+        }
+        if (name == "sampleA" || name == "sampleB") {
+            if (!arity(2) || !scalars()) return Value();
+            Value out;
+            out.color = true;
+            for (int c = 0; c < 4; ++c) out.reg[c] = NewRegister();
+            // Channels land in dst..dst+3
+            Emit(name == "sampleA" ? OP_SAMPLE_A : OP_SAMPLE_B, out.reg[0], args[0].reg[0], args[1].reg[0]);
+            return out;
+        }
+        if (name == "noise" || name == "length") {
+            if (!arity(2) || !scalars()) return Value();
+            std::uint8_t reg = NewRegister();
+            Emit(name == "noise" ? OP_NOISE : OP_LENGTH, reg, args[0].reg[0], args[1].reg[0]);
+            return Scalar(reg);
+        }
+        if (name == "rgb" || name == "rgba") {
+            size_t n = name == "rgb" ? 3 : 4;
+            if (!arity(n) || !scalars()) return Value();
+            Value out;
+            out.color = true;
+            for (int c = 0; c < 4; ++c) out.reg[c] = c < static_cast<int>(n) ? args[c].reg[0] : Constant(1.0f).reg[0];
+            return out;
+        }
+        if (name == "luma" || name == "alpha") {
+            if (!arity(1)) return Value();
+            if (!args[0].color) return Fail(name + "() takes a colour");
+            if (name == "alpha") return Scalar(args[0].reg[3]);
+            std::uint8_t reg = NewRegister();
+            Emit(OP_LUMA, reg, args[0].reg[0], args[0].reg[1], args[0].reg[2]);
+            return Scalar(reg);
+        }
+        return Fail("unknown function '" + name + "'");
+    }
+
+public:
+    unsigned int canvasWidth = 0, canvasHeight = 0;
+
+private:
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    PixelProgram& program;
+    std::map<std::string, Value> variables;
+    std::map<std::string, std::uint8_t> inputs;
+    std::map<float, std::uint8_t> constants;
+    int nextRegister = 0;
+    bool failed = false;
+    std::string message;
+};
+
+std::shared_ptr<const PixelProgram> CompilePixelProgram(const std::string& source, std::string& error)
+{
+    std::vector<Token> tokens = Tokenize(source, error);
+    if (tokens.empty()) return nullptr;
+    auto program = std::make_shared<PixelProgram>();
+    PixelCompiler compiler(std::move(tokens), *program);
+    compiler.canvasWidth = CANVAS_WIDTH;
+    compiler.canvasHeight = CANVAS_HEIGHT;
+    if (!compiler.Compile(error)) return nullptr;
+    return program;
+}
+
+std::shared_ptr<const PixelProgram> LoadPixelProgram(const std::filesystem::path& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot read " + path.string();
+        return nullptr;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return CompilePixelProgram(ss.str(), error);
+}
+
+// --- INTERPRETER ---
+void PixelProgram::RunBatch(float* regs, const sf::Image& imgA, const sf::Image& imgB, float x0, float y, float invW, float invH,
+    bool deterministic) const
+{
+    for (const Instruction& in : code) {
+        float* d = regs + in.dst * LANES;
+        const float* a = regs + in.a * LANES;
+        const float* b = regs + in.b * LANES;
+        const float* c = regs + in.c * LANES;
+        switch (in.op) {
+        case OP_LOAD_U: for (int l = 0; l < LANES; ++l) d[l] = (x0 + l + 0.5f) * invW; break;
+        case OP_LOAD_V: for (int l = 0; l < LANES; ++l) d[l] = (y + 0.5f) * invH; break;
+        case OP_LOAD_X: for (int l = 0; l < LANES; ++l) d[l] = x0 + l; break;
+        case OP_LOAD_Y: for (int l = 0; l < LANES; ++l) d[l] = y; break;
+        case OP_NEG: for (int l = 0; l < LANES; ++l) d[l] = -a[l]; break;
+        case OP_ABS: for (int l = 0; l < LANES; ++l) d[l] = std::fabs(a[l]); break;
+        case OP_FLOOR: for (int l = 0; l < LANES; ++l) d[l] = std::floor(a[l]); break;
+        case OP_FRACT: for (int l = 0; l < LANES; ++l) d[l] = a[l] - std::floor(a[l]); break;
+        case OP_SQRT: for (int l = 0; l < LANES; ++l) d[l] = std::sqrt(std::max(a[l], 0.0f)); break;
+        case OP_SIN: for (int l = 0; l < LANES; ++l) d[l] = deterministic ? DetSin(a[l]) : std::sin(a[l]); break;
+        case OP_COS: for (int l = 0; l < LANES; ++l) d[l] = deterministic ? DetCos(a[l]) : std::cos(a[l]); break;
+        case OP_ADD: for (int l = 0; l < LANES; ++l) d[l] = a[l] + b[l]; break;
+        case OP_SUB: for (int l = 0; l < LANES; ++l) d[l] = a[l] - b[l]; break;
+        case OP_MUL: for (int l = 0; l < LANES; ++l) d[l] = a[l] * b[l]; break;
+        case OP_DIV: for (int l = 0; l < LANES; ++l) d[l] = b[l] != 0.0f ? a[l] / b[l] : 0.0f; break;
+        case OP_MIN: for (int l = 0; l < LANES; ++l) d[l] = std::min(a[l], b[l]); break;
+        case OP_MAX: for (int l = 0; l < LANES; ++l) d[l] = std::max(a[l], b[l]); break;
+        case OP_POW: for (int l = 0; l < LANES; ++l) d[l] = deterministic ? DetPow(a[l], b[l]) : std::pow(std::max(a[l], 0.0f), b[l]); break;
+        case OP_STEP: for (int l = 0; l < LANES; ++l) d[l] = b[l] >= a[l] ? 1.0f : 0.0f; break;
+        case OP_LESS: for (int l = 0; l < LANES; ++l) d[l] = a[l] < b[l] ? 1.0f : 0.0f; break;
+        case OP_GREATER: for (int l = 0; l < LANES; ++l) d[l] = a[l] > b[l] ? 1.0f : 0.0f; break;
+        case OP_LESS_EQ: for (int l = 0; l < LANES; ++l) d[l] = a[l] <= b[l] ? 1.0f : 0.0f; break;
+        case OP_GREATER_EQ: for (int l = 0; l < LANES; ++l) d[l] = a[l] >= b[l] ? 1.0f : 0.0f; break;
+        case OP_MIX: for (int l = 0; l < LANES; ++l) d[l] = a[l] + (b[l] - a[l]) * c[l]; break;
+        case OP_CLAMP: for (int l = 0; l < LANES; ++l) d[l] = std::min(std::max(a[l], b[l]), c[l]); break;
+        case OP_SMOOTHSTEP:
+            for (int l = 0; l < LANES; ++l) {
+                float range = b[l] - a[l];
+                float t = range != 0.0f ? std::min(std::max((c[l] - a[l]) / range, 0.0f), 1.0f) : (c[l] >= b[l] ? 1.0f : 0.0f);
+                d[l] = t * t * (3.0f - 2.0f * t);
+            }
+            break;
+        case OP_SELECT: for (int l = 0; l < LANES; ++l) d[l] = a[l] != 0.0f ? b[l] : c[l]; break;
+        case OP_SAMPLE_A:
+        case OP_SAMPLE_B: {
+            SampleBilinear(in.op == OP_SAMPLE_A ? imgA : imgB, a, b, d, d + LANES, d + 2 * LANES, d + 3 * LANES);
+            break;
+        }
+        case OP_NOISE: for (int l = 0; l < LANES; ++l) d[l] = ValueNoise(a[l], b[l]); break;
+        case OP_LENGTH: for (int l = 0; l < LANES; ++l) d[l] = std::sqrt(a[l] * a[l] + b[l] * b[l]); break;
+        case OP_LUMA: for (int l = 0; l < LANES; ++l) d[l] = 0.299f * a[l] + 0.587f * b[l] + 0.114f * c[l]; break;
+        }
+    }
+}
+
+void PixelProgram::Render(const sf::Image& imgA, const sf::Image& imgB, float progress,
+    unsigned int width, unsigned int height, std::uint8_t* out) const
+{
+    const float invW = 1.0f / width, invH = 1.0f / height;
+    // Render switches are thread_local; the workers get the caller's
+    const bool deterministic = deterministicRendering;
+    ParallelFor(height, [&](unsigned int begin, unsigned int end) {
+        KernelCounterScope counters("expression", static_cast<std::uint64_t>(end - begin) * width);
+        std::vector<float> regs(static_cast<size_t>(std::max(registerCount, 1)) * LANES);
+        for (const auto& [reg, value] : constants) std::fill_n(regs.begin() + reg * LANES, LANES, value);
+        if (progressRegister >= 0) std::fill_n(regs.begin() + progressRegister * LANES, LANES, progress);
+
+        for (unsigned int y = begin; y < end; ++y) {
+            std::uint8_t* row = out + static_cast<size_t>(y) * width * 4;
+            for (unsigned int x0 = 0; x0 < width; x0 += LANES) {
+                RunBatch(regs.data(), imgA, imgB, static_cast<float>(x0), static_cast<float>(y), invW, invH, deterministic);
+                unsigned int lanes = std::min<unsigned int>(LANES, width - x0);
+                for (int c = 0; c < 4; ++c) {
+                    const float* channel = regs.data() + output[c] * LANES;
+                    for (unsigned int l = 0; l < lanes; ++l)
+                        row[(x0 + l) * 4 + c] = static_cast<std::uint8_t>(std::min(std::max(channel[l], 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+            }
+        }
+    }, 8);
+}
@@ -0,0 +1,64 @@
+#ifndef PIXEL_EXPR_H
+#define PIXEL_EXPR_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+// User-defined per-pixel transitions (.tfx files). A script is a list of assignments
+// followed by one expression giving the output colour, separated by newlines or ';':
+//
+//   # circle wipe
+//   d = length(u - 0.5, (v - 0.5) / aspect)
+//   mix(sampleA(u, v), sampleB(u, v), step(d, progress * 0.8))
+//
+// Values are numbers or colours (r, g, b, a in 0..1); arithmetic mixes them per channel.
+// Inputs:    u, v (0..1 across the canvas), x, y (pixels), progress, width, height, aspect
+// Functions: sampleA(u, v), sampleB(u, v), rgb(r, g, b), rgba(r, g, b, a), luma(c), alpha(c),
+//            noise(x, y), length(x, y), mix, clamp, step, smoothstep, min, max, pow,
+//            abs, floor, fract, sqrt, sin, cos, and c ? a : b with < > <= >=
+//
+// Scripts compile to a register bytecode in which every instruction processes a batch of
+// LANES pixels (plain loops over the lanes that the compiler vectorizes); rows of the
+// canvas are split across all hardware threads.
+class PixelProgram {
+public:
+    static constexpr int LANES = 16;
+
+    // Straight samples come from imgA / imgB stretched to the canvas (bilinear).
+    // Writes width x height RGBA8 pixels to 'out'.
+    void Render(const sf::Image& imgA, const sf::Image& imgB, float progress,
+        unsigned int width, unsigned int height, std::uint8_t* out) const;
+
+    size_t InstructionCount() const { return code.size(); }
+
+private:
+    friend class PixelCompiler;
+
+    struct Instruction {
+        std::uint8_t op, dst, a, b, c;
+    };
+
+    // 'deterministic' routes sin/cos/pow through det_math.h (see deterministicRendering)
+    void RunBatch(float* regs, const sf::Image& imgA, const sf::Image& imgB, float x0, float y, float invW, float invH,
+        bool deterministic) const;
+
+    std::vector<Instruction> code;
+    std::vector<std::pair<std::uint8_t, float>> constants;   // Registers preset once per thread
+    int progressRegister = -1;
+    int registerCount = 0;
+    std::uint8_t output[4] = {};
+};
+
+// Compiles a script; width, height and aspect are constants of the canvas size.
+// Returns nullptr and a "line N: ..." message on errors.
+std::shared_ptr<const PixelProgram> CompilePixelProgram(const std::string& source, std::string& error);
+
+// Reads and compiles a .tfx file
+std::shared_ptr<const PixelProgram> LoadPixelProgram(const std::filesystem::path& path, std::string& error);
+
+#endif //PIXEL_EXPR_H
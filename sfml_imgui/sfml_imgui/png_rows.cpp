@@ -0,0 +1,582 @@
+#include "pch.h"
+#include "png_rows.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+    const std::uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    // Wider rows are refused rather than allocated
+    const unsigned int MAX_PNG_WIDTH = 1u << 24;
+
+    std::uint32_t ReadBigEndian(const std::uint8_t* p)
+    {
+        return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+            (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    bool ReadChunkHeader(std::istream& in, std::uint32_t& length, std::string& type)
+    {
+        std::uint8_t bytes[8];
+        if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) return false;
+        length = ReadBigEndian(bytes);
+        type.assign(reinterpret_cast<const char*>(bytes + 4), 4);
+        return length <= 0x7fffffffu;
+    }
+
+    // --- IDAT STREAM ---
+    // The zlib stream, split over consecutive IDAT chunks
+    class IdatReader {
+    public:
+        IdatReader(std::istream& in, std::uint32_t firstLength) : in(in), remaining(firstLength), buffer(1 << 16) {}
+
+        // Next byte of the stream; false at the end of the IDAT chunks
+        bool Next(std::uint8_t& byte)
+        {
+            if (pos == filled && !Fill()) return false;
+            byte = buffer[pos++];
+            return true;
+        }
+
+    private:
+        bool Fill()
+        {
+            while (remaining == 0) {
+                if (done) return false;
+                std::uint32_t length = 0;
+                std::string type;
+                in.ignore(4);   // CRC
+                if (!ReadChunkHeader(in, length, type) || type != "IDAT") {
+                    done = true;
+                    return false;
+                }
+                remaining = length;
+            }
+            size_t n = std::min<size_t>(remaining, buffer.size());
+            if (!in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(n))) {
+                done = true;
+                return false;
+            }
+            remaining -= static_cast<std::uint32_t>(n);
+            pos = 0;
+            filled = n;
+            return true;
+        }
+
+        std::istream& in;
+        std::uint32_t remaining;
+        std::vector<std::uint8_t> buffer;
+        size_t pos = 0, filled = 0;
+        bool done = false;
+    };
+
+    // --- INFLATE ---
+    const int FAST_BITS = 9;
+    const size_t WINDOW_SIZE = 1 << 16;        // Twice the deflate distance limit
+    const size_t WINDOW_MASK = WINDOW_SIZE - 1;
+    const size_t FLUSH_BYTES = 1 << 14;         // Output handed to the sink at a time
+
+    const std::uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const std::uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const std::uint16_t DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const std::uint8_t DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const std::uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // Canonical Huffman code: short codes through a lookup table, longer ones bit by bit
+    struct Huffman {
+        std::uint16_t fast[1 << FAST_BITS];   // (length << 9) | symbol, 0 for longer codes
+        std::uint16_t count[16];              // Codes per length
+        std::uint16_t symbols[288];           // Ordered by length, then symbol
+
+        // False for an over-subscribed code; incomplete codes are valid in deflate
+        bool Build(const std::uint8_t* lengths, int n)
+        {
+            std::memset(fast, 0, sizeof(fast));
+            std::memset(count, 0, sizeof(count));
+            for (int i = 0; i < n; ++i) count[lengths[i]]++;
+            count[0] = 0;
+            int left = 1;
+            for (int len = 1; len < 16; ++len) {
+                left = (left << 1) - count[len];
+                if (left < 0) return false;
+            }
+
+            std::uint16_t offsets[16] = {};
+            int next[16] = {};
+            int code = 0;
+            for (int len = 1; len < 16; ++len) {
+                if (len > 1) offsets[len] = offsets[len - 1] + count[len - 1];
+                code = (code + count[len - 1]) << 1;
+                next[len] = code;
+            }
+            for (int i = 0; i < n; ++i) {
+                int len = lengths[i];
+                if (len == 0) continue;
+                symbols[offsets[len]++] = static_cast<std::uint16_t>(i);
+                int c = next[len]++;
+                if (len > FAST_BITS) continue;
+                // Deflate sends codes most significant bit first into an LSB-first stream
+                int reversed = 0;
+                for (int b = 0; b < len; ++b) reversed |= ((c >> b) & 1) << (len - 1 - b);
+                for (int j = reversed; j < (1 << FAST_BITS); j += 1 << len)
+                    fast[j] = static_cast<std::uint16_t>((len << 9) | i);
+            }
+            return true;
+        }
+    };
+
+    // Inflates a zlib stream into a sliding window and hands the output to 'sink' in
+    // spans of up to FLUSH_BYTES. The sink returns false to stop early.
+    class Inflater {
+    public:
+        using Sink = std::function<bool(const std::uint8_t* data, size_t size)>;
+
+        Inflater(IdatReader& source, Sink sink) : source(source), sink(std::move(sink)), window(WINDOW_SIZE) {}
+
+        bool Run(std::string& error)
+        {
+            unsigned int cmf = Bits(8), flg = Bits(8);
+            if ((cmf & 15) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 32)) {
+                error = "bad zlib header";
+                return false;
+            }
+            bool last = false;
+            while (!last && Ok()) {
+                last = Bits(1) != 0;
+                unsigned int type = Bits(2);
+                if (type == 0) Stored();
+                else if (type == 1) Codes(FixedLiterals(), FixedDistances());
+                else if (type == 2) { if (Dynamic()) Codes(literals, distances); }
+                else failed = true;
+            }
+            if (Ok()) Flush();
+            if (truncated) error = "truncated image data";
+            else if (failed) error = "corrupt image data";
+            return !truncated && !failed;
+        }
+
+    private:
+        bool Ok() const { return !failed && !truncated && !stopped; }
+
+        void Refill()
+        {
+            std::uint8_t byte;
+            while (bitCount <= 56 && source.Next(byte)) {
+                bits |= static_cast<std::uint64_t>(byte) << bitCount;
+                bitCount += 8;
+            }
+        }
+
+        unsigned int Bits(int n)
+        {
+            if (n == 0) return 0;
+            if (bitCount < n) Refill();
+            if (bitCount < n) {
+                truncated = true;
+                return 0;
+            }
+            unsigned int value = static_cast<unsigned int>(bits & ((1ull << n) - 1));
+            bits >>= n;
+            bitCount -= n;
+            return value;
+        }
+
+        // Next symbol of 'h', -1 for an unassigned code
+        int Decode(const Huffman& h)
+        {
+            if (bitCount < 15) Refill();
+            std::uint16_t entry = h.fast[bits & ((1u << FAST_BITS) - 1)];
+            if (entry != 0) {
+                int len = entry >> 9;
+                if (len > bitCount) {
+                    truncated = true;
+                    return -1;
+                }
+                bits >>= len;
+                bitCount -= len;
+                return entry & 511;
+            }
+            int code = 0, first = 0, index = 0;
+            for (int len = 1; len < 16 && len <= bitCount; ++len) {
+                code |= static_cast<int>((bits >> (len - 1)) & 1);
+                int c = h.count[len];
+                if (code - c < first) {
+                    bits >>= len;
+                    bitCount -= len;
+                    return h.symbols[index + (code - first)];
+                }
+                index += c;
+                first = (first + c) << 1;
+                code <<= 1;
+            }
+            if (bitCount < 15) truncated = true;
+            return -1;
+        }
+
+        bool Flush()
+        {
+            while (flushed < written) {
+                size_t start = static_cast<size_t>(flushed & WINDOW_MASK);
+                size_t n = static_cast<size_t>(std::min<std::uint64_t>(written - flushed, WINDOW_SIZE - start));
+                flushed += n;
+                if (!sink(&window[start], n)) {
+                    stopped = true;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void Stored()
+        {
+            int skip = bitCount % 8;
+            bits >>= skip;
+            bitCount -= skip;
+            unsigned int length = Bits(16), inverse = Bits(16);
+            if (Ok() && (length ^ 0xffff) != inverse) failed = true;
+            for (; length > 0 && Ok(); --length) {
+                window[written++ & WINDOW_MASK] = static_cast<std::uint8_t>(Bits(8));
+                if (written - flushed >= FLUSH_BYTES) Flush();
+            }
+        }
+
+        void Codes(const Huffman& lit, const Huffman& dist)
+        {
+            while (Ok()) {
+                int symbol = Decode(lit);
+                if (symbol < 0) { failed = !truncated; return; }
+                if (symbol < 256) {
+                    window[written++ & WINDOW_MASK] = static_cast<std::uint8_t>(symbol);
+                }
+                else if (symbol == 256) {
+                    return;
+                }
+                else {
+                    symbol -= 257;
+                    if (symbol >= 29) { failed = true; return; }
+                    unsigned int length = LENGTH_BASE[symbol] + Bits(LENGTH_EXTRA[symbol]);
+                    int d = Decode(dist);
+                    if (d < 0 || d >= 30) { failed = !truncated; return; }
+                    unsigned int distance = DIST_BASE[d] + Bits(DIST_EXTRA[d]);
+                    if (distance > written) { failed = true; return; }
+                    for (unsigned int i = 0; i < length; ++i, ++written)
+                        window[written & WINDOW_MASK] = window[(written - distance) & WINDOW_MASK];
+                }
+                if (written - flushed >= FLUSH_BYTES) Flush();
+            }
+        }
+
+        bool Dynamic()
+        {
+            unsigned int literalCount = Bits(5) + 257;
+            unsigned int distanceCount = Bits(5) + 1;
+            unsigned int codeLengthCount = Bits(4) + 4;
+            std::uint8_t lengths[320] = {};
+            for (unsigned int i = 0; i < codeLengthCount; ++i) lengths[CODE_LENGTH_ORDER[i]] = static_cast<std::uint8_t>(Bits(3));
+            Huffman codeLengths;
+            if (!Ok() || !codeLengths.Build(lengths, 19)) { failed = !truncated; return false; }
+
+            std::memset(lengths, 0, sizeof(lengths));
+            unsigned int total = literalCount + distanceCount;
+            for (unsigned int n = 0; n < total;) {
+                int symbol = Decode(codeLengths);
+                if (symbol < 0 || !Ok()) { failed = !truncated; return false; }
+                if (symbol < 16) {
+                    lengths[n++] = static_cast<std::uint8_t>(symbol);
+                    continue;
+                }
+                std::uint8_t value = 0;
+                unsigned int repeat;
+                if (symbol == 16) {
+                    if (n == 0) { failed = true; return false; }
+                    value = lengths[n - 1];
+                    repeat = 3 + Bits(2);
+                }
+                else if (symbol == 17) {
+                    repeat = 3 + Bits(3);
+                }
+                else {
+                    repeat = 11 + Bits(7);
+                }
+                if (n + repeat > total) { failed = true; return false; }
+                while (repeat--) lengths[n++] = value;
+            }
+            if (lengths[256] == 0 || !literals.Build(lengths, static_cast<int>(literalCount)) ||
+                !distances.Build(lengths + literalCount, static_cast<int>(distanceCount))) {
+                failed = true;
+                return false;
+            }
+            return true;
+        }
+
+        const Huffman& FixedLiterals()
+        {
+            if (!fixedBuilt) BuildFixed();
+            return fixedLiterals;
+        }
+
+        const Huffman& FixedDistances()
+        {
+            if (!fixedBuilt) BuildFixed();
+            return fixedDistances;
+        }
+
+        void BuildFixed()
+        {
+            std::uint8_t lengths[288];
+            std::fill(lengths, lengths + 144, static_cast<std::uint8_t>(8));
+            std::fill(lengths + 144, lengths + 256, static_cast<std::uint8_t>(9));
+            std::fill(lengths + 256, lengths + 280, static_cast<std::uint8_t>(7));
+            std::fill(lengths + 280, lengths + 288, static_cast<std::uint8_t>(8));
+            fixedLiterals.Build(lengths, 288);
+            std::fill(lengths, lengths + 30, static_cast<std::uint8_t>(5));
+            fixedDistances.Build(lengths, 30);
+            fixedBuilt = true;
+        }
+
+        IdatReader& source;
+        Sink sink;
+        std::vector<std::uint8_t> window;
+        std::uint64_t written = 0;   // Bytes produced so far
+        std::uint64_t flushed = 0;   // Bytes handed to the sink
+        std::uint64_t bits = 0;
+        int bitCount = 0;
+        bool failed = false, truncated = false, stopped = false;
+        Huffman literals, distances;
+        Huffman fixedLiterals, fixedDistances;
+        bool fixedBuilt = false;
+    };
+
+    // --- ROW FILTERS ---
+    bool Unfilter(int filter, std::uint8_t* row, const std::uint8_t* previous, size_t size, size_t bpp)
+    {
+        switch (filter) {
+        case 0:
+            return true;
+        case 1:
+            for (size_t i = bpp; i < size; ++i) row[i] = static_cast<std::uint8_t>(row[i] + row[i - bpp]);
+            return true;
+        case 2:
+            for (size_t i = 0; i < size; ++i) row[i] = static_cast<std::uint8_t>(row[i] + previous[i]);
+            return true;
+        case 3:
+            for (size_t i = 0; i < size; ++i) {
+                int left = i >= bpp ? row[i - bpp] : 0;
+                row[i] = static_cast<std::uint8_t>(row[i] + ((left + previous[i]) >> 1));
+            }
+            return true;
+        case 4:
+            for (size_t i = 0; i < size; ++i) {
+                int a = i >= bpp ? row[i - bpp] : 0;
+                int b = previous[i];
+                int c = i >= bpp ? previous[i - bpp] : 0;
+                int p = a + b - c;
+                int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                int predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                row[i] = static_cast<std::uint8_t>(row[i] + predictor);
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    int Channels(int colorType)
+    {
+        switch (colorType) {
+        case 0: return 1;
+        case 2: return 3;
+        case 3: return 1;
+        case 4: return 2;
+        case 6: return 4;
+        default: return 0;
+        }
+    }
+}
+
+bool ReadPngHeader(std::istream& in, PngHeader& header)
+{
+    std::uint8_t signature[8];
+    if (!in.read(reinterpret_cast<char*>(signature), sizeof(signature)) ||
+        std::memcmp(signature, PNG_SIGNATURE, sizeof(signature)) != 0) return false;
+    std::uint32_t length = 0;
+    std::string type;
+    std::uint8_t ihdr[13];
+    if (!ReadChunkHeader(in, length, type) || type != "IHDR" || length != sizeof(ihdr) ||
+        !in.read(reinterpret_cast<char*>(ihdr), sizeof(ihdr))) return false;
+    in.ignore(4);   // CRC
+
+    header.width = ReadBigEndian(ihdr);
+    header.height = ReadBigEndian(ihdr + 4);
+    header.bitDepth = ihdr[8];
+    header.colorType = ihdr[9];
+    header.interlaced = ihdr[12] == 1;
+    int depth = header.bitDepth;
+    bool depthValid = false;
+    switch (header.colorType) {
+    case 0: depthValid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+    case 3: depthValid = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+    case 2: case 4: case 6: depthValid = depth == 8 || depth == 16; break;
+    }
+    return header.width > 0 && header.height > 0 && header.width <= 0x7fffffffu && header.height <= 0x7fffffffu &&
+        depthValid && ihdr[10] == 0 && ihdr[11] == 0 && ihdr[12] <= 1;
+}
+
+bool DecodePngRows(std::istream& in, const PngHeader& header,
+    const std::function<void(unsigned int y, const std::uint8_t* rgba)>& onRow, std::string& error)
+{
+    if (header.interlaced) {
+        error = "interlaced PNG files cannot be decoded row by row";
+        return false;
+    }
+    if (header.width > MAX_PNG_WIDTH) {
+        error = "PNG rows wider than " + std::to_string(MAX_PNG_WIDTH) + " pixels are not supported";
+        return false;
+    }
+
+    // Palette entries default to opaque black; tRNS supplies palette alpha or the colour key
+    std::vector<std::uint8_t> palette(256 * 4, 0);
+    for (size_t i = 0; i < 256; ++i) palette[i * 4 + 3] = 255;
+    bool hasPalette = false;
+    bool hasKey = false;
+    unsigned int key[3] = {};
+
+    std::uint32_t length = 0;
+    std::string type;
+    for (;;) {
+        if (!ReadChunkHeader(in, length, type)) {
+            error = "truncated PNG file";
+            return false;
+        }
+        if (type == "IDAT") break;
+        if (type == "IEND") {
+            error = "PNG file has no image data";
+            return false;
+        }
+        if (type == "PLTE" || type == "tRNS") {
+            std::vector<std::uint8_t> data(length);
+            if (!in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(length))) {
+                error = "truncated PNG file";
+                return false;
+            }
+            if (type == "PLTE") {
+                for (size_t i = 0; i < std::min<size_t>(length / 3, 256); ++i)
+                    std::memcpy(&palette[i * 4], &data[i * 3], 3);
+                hasPalette = true;
+            }
+            else if (header.colorType == 3) {
+                for (size_t i = 0; i < std::min<size_t>(length, 256); ++i) palette[i * 4 + 3] = data[i];
+            }
+            else if ((header.colorType == 0 && length >= 2) || (header.colorType == 2 && length >= 6)) {
+                for (int c = 0; c < (header.colorType == 0 ? 1 : 3); ++c) key[c] = (data[c * 2] << 8) | data[c * 2 + 1];
+                hasKey = true;
+            }
+        }
+        else {
+            in.ignore(length);
+        }
+        in.ignore(4);   // CRC
+    }
+    if (header.colorType == 3 && !hasPalette) {
+        error = "PNG palette is missing";
+        return false;
+    }
+
+    const int bitDepth = header.bitDepth;
+    const int colorType = header.colorType;
+    const unsigned int width = header.width;
+    const unsigned int maxSample = (1u << bitDepth) - 1;
+    size_t bitsPerPixel = static_cast<size_t>(Channels(colorType)) * bitDepth;
+    size_t stride = (static_cast<size_t>(width) * bitsPerPixel + 7) / 8;
+    size_t bpp = std::max<size_t>(1, bitsPerPixel / 8);
+
+    std::vector<std::uint8_t> current(stride), previous(stride, 0), rgba(static_cast<size_t>(width) * 4);
+    size_t rowPos = 0;   // 0: the filter byte is next
+    int filter = 0;
+    unsigned int y = 0;
+    bool badFilter = false;
+
+    // Sample 'index' of the current row at its full bit depth
+    auto sample = [&](size_t index) -> unsigned int {
+        if (bitDepth == 8) return current[index];
+        if (bitDepth == 16) return (current[index * 2] << 8) | current[index * 2 + 1];
+        size_t bit = index * bitDepth;
+        return (current[bit >> 3] >> (8 - bitDepth - (bit & 7))) & maxSample;
+    };
+    auto to8 = [&](unsigned int value) -> std::uint8_t {
+        if (bitDepth == 16) return static_cast<std::uint8_t>(value >> 8);
+        if (bitDepth == 8) return static_cast<std::uint8_t>(value);
+        return static_cast<std::uint8_t>(value * 255 / maxSample);
+    };
+    auto convertRow = [&]() {
+        for (unsigned int x = 0; x < width; ++x) {
+            std::uint8_t* o = &rgba[static_cast<size_t>(x) * 4];
+            switch (colorType) {
+            case 0: {
+                unsigned int v = sample(x);
+                o[0] = o[1] = o[2] = to8(v);
+                o[3] = hasKey && v == key[0] ? 0 : 255;
+                break;
+            }
+            case 2: {
+                unsigned int r = sample(x * 3ull), g = sample(x * 3ull + 1), b = sample(x * 3ull + 2);
+                o[0] = to8(r); o[1] = to8(g); o[2] = to8(b);
+                o[3] = hasKey && r == key[0] && g == key[1] && b == key[2] ? 0 : 255;
+                break;
+            }
+            case 3:
+                std::memcpy(o, &palette[static_cast<size_t>(sample(x)) * 4], 4);
+                break;
+            case 4:
+                o[0] = o[1] = o[2] = to8(sample(x * 2ull));
+                o[3] = to8(sample(x * 2ull + 1));
+                break;
+            default:
+                for (int c = 0; c < 4; ++c) o[c] = to8(sample(x * 4ull + c));
+                break;
+            }
+        }
+    };
+
+    IdatReader idat(in, length);
+    Inflater inflater(idat, [&](const std::uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size;) {
+            if (rowPos == 0) {
+                filter = data[i++];
+                rowPos = 1;
+                continue;
+            }
+            size_t take = std::min(size - i, stride - (rowPos - 1));
+            std::memcpy(&current[rowPos - 1], data + i, take);
+            i += take;
+            rowPos += take;
+            if (rowPos - 1 < stride) continue;
+
+            if (!Unfilter(filter, current.data(), previous.data(), stride, bpp)) {
+                badFilter = true;
+                return false;
+            }
+            convertRow();
+            onRow(y, rgba.data());
+            std::swap(current, previous);
+            rowPos = 0;
+            if (++y == header.height) return false;
+        }
+        return true;
+    });
+    if (!inflater.Run(error) && y < header.height) return false;
+    if (badFilter) {
+        error = "corrupt PNG row filter";
+        return false;
+    }
+    if (y < header.height) {
+        error = "truncated image data";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef PNG_ROWS_H
+#define PNG_ROWS_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+
+// Streaming PNG decoder: inflates the IDAT stream with a 64 KB window and hands out one
+// RGBA8 row at a time, so memory stays at a few rows however tall the image is. Used to
+// load panoramas that would not fit in memory decoded whole.
+// Every colour type and bit depth is supported (16-bit samples keep their high byte,
+// tRNS becomes alpha); interlaced (Adam7) files are not, they need the whole image.
+// Checksums are not verified.
+
+struct PngHeader {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    int bitDepth = 0;
+    int colorType = 0;
+    bool interlaced = false;
+};
+
+// Reads the signature and IHDR chunk. Returns false when 'in' is not a valid PNG.
+bool ReadPngHeader(std::istream& in, PngHeader& header);
+
+// Decodes the rest of 'in' after ReadPngHeader. 'onRow' gets the rows in order,
+// width * 4 bytes each. Returns false (with 'error' set) on interlaced, malformed or
+// truncated files.
+bool DecodePngRows(std::istream& in, const PngHeader& header,
+    const std::function<void(unsigned int y, const std::uint8_t* rgba)>& onRow, std::string& error);
+
+#endif //PNG_ROWS_H
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "prepared_input.h"
+#include "transitions.h"
+#include "alpha.h"
+#include "large_image.h"
+#include "render_graph.h"
+#include <tuple>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Identifies a file version without reading it: path, size and modification time
+    GraphKey FileKey(const fs::path& path)
+    {
+        std::error_code ec;
+        fs::path canonical = fs::weakly_canonical(path, ec);
+        GraphKey key = HashString(ec ? path.string() : canonical.string());
+        key = HashCombine(key, static_cast<GraphKey>(fs::file_size(path, ec)));
+        return HashCombine(key, static_cast<GraphKey>(fs::last_write_time(path, ec).time_since_epoch().count()));
+    }
+}
+
+namespace {
+    GraphNode<sf::Image> AddDecodeNode(RenderGraph& graph, const fs::path& path)
+    {
+        return graph.Add<sf::Image>("decode", {}, FileKey(path), [path](const GraphInputs&) {
+            auto image = std::make_shared<sf::Image>();
+            return LoadInputImage(path, *image) ? image : nullptr;
+        });
+    }
+}
+
+std::shared_ptr<const sf::Image> DecodeInputSource(const fs::path& path, std::uint64_t& key, bool* decoded)
+{
+    RenderGraph graph;
+    auto decode = AddDecodeNode(graph, path);
+    if (!graph.Evaluate({ decode.id })) return nullptr;
+    key = graph.Key(decode.id);
+    if (decoded) *decoded = !graph.Reused(decode.id);
+    return graph.Result(decode);
+}
+
+std::uint64_t InputSourceKey(const fs::path& path)
+{
+    RenderGraph graph;
+    return graph.Key(AddDecodeNode(graph, path).id);
+}
+
+bool LoadInput(PreparedInput& input, const fs::path& path)
+{
+    std::uint64_t key = 0;
+    std::shared_ptr<const sf::Image> source = DecodeInputSource(path, key);
+    if (!source) return false;
+    input.source = std::move(source);
+    input.sourceKey = key;
+    PrepareInput(input);
+    return input.IsLoaded();
+}
+
+bool ComputeInputStages(const sf::Image& source, std::uint64_t sourceKey, bool premultiply, InputStages& stages)
+{
+    // source -> cache -> { histogram, luma }; the two analyses run in parallel
+    RenderGraph graph;
+    auto src = graph.Constant("source", sourceKey, source);
+    // The CPU copy and the luma plane are copied into the PreparedInput, so the memo only
+    // keeps the small histogram
+    auto cache = graph.AddTransient<sf::Image>("cache", { src.id }, premultiply, [premultiply](const GraphInputs& in) {
+        const sf::Image& image = in.Get<sf::Image>(0);
+        return std::make_shared<sf::Image>(premultiply ? PremultiplyAlpha(image) : image);
+    });
+    auto histogram = graph.Add<ChannelHistogram>("histogram", { cache.id }, 0, [](const GraphInputs& in) {
+        return std::make_shared<ChannelHistogram>(ComputeHistogramParallel(in.Get<sf::Image>(0)));
+    });
+    auto luma = graph.AddTransient<std::vector<std::uint8_t>>("luma", { cache.id }, 0, [](const GraphInputs& in) {
+        return std::make_shared<std::vector<std::uint8_t>>(ComputeLumaPlane(in.Get<sf::Image>(0)));
+    });
+    if (!graph.Evaluate({ cache.id, histogram.id, luma.id })) return false;
+    stages.cache = graph.Result(cache);
+    stages.histogram = graph.Result(histogram);
+    stages.luma = graph.Result(luma);
+    return true;
+}
+
+bool ApplyInputStages(PreparedInput& input, const InputStages& stages)
+{
+    // Texture upload needs the GL context, so it stays on the calling thread
+    input.cache = *stages.cache;
+    if (!input.texture.loadFromImage(input.cache)) return false;
+    input.sprite.setTexture(input.texture, true);
+    input.histogram = *stages.histogram;
+    input.luma = *stages.luma;
+    input.generation++;
+    return true;
+}
+
+size_t PreparedInputBytes(const PreparedInput& input)
+{
+    return GraphValueBytes(input.cache) + input.luma.size();
+}
+
+void PrepareInput(PreparedInput& input)
+{
+    if (!input.source) return;
+    if (input.sourceKey == 0) input.sourceKey = HashImage(*input.source);
+    InputStages stages;
+    if (ComputeInputStages(*input.source, input.sourceKey, premultipliedPipeline, stages))
+        ApplyInputStages(input, stages);
+}
+
+void UpdateExposureMatchedInputs(ExposureMatchState& state, const PreparedInput& in1, const PreparedInput& in2,
+    float progress, bool needImages)
+{
+    if (!state.lutValid || state.generation1 != in1.generation || state.generation2 != in2.generation) {
+        state.lut1To2 = BuildMatchingLut(in1.histogram, in2.histogram);
+        state.lut2To1 = BuildMatchingLut(in2.histogram, in1.histogram);
+        state.generation1 = in1.generation;
+        state.generation2 = in2.generation;
+        state.lutValid = true;
+    }
+
+    ApplyChannelLut(in1.cache, state.pixels1, BlendLutWithIdentity(state.lut1To2, progress));
+    ApplyChannelLut(in2.cache, state.pixels2, BlendLutWithIdentity(state.lut2To1, 1.0f - progress));
+
+    sf::Vector2u size1 = in1.cache.getSize();
+    sf::Vector2u size2 = in2.cache.getSize();
+    if (state.texture1.getSize() != size1) {
+        std::ignore = state.texture1.resize(size1);
+        state.sprite1.setTexture(state.texture1, true);
+    }
+    if (state.texture2.getSize() != size2) {
+        std::ignore = state.texture2.resize(size2);
+        state.sprite2.setTexture(state.texture2, true);
+    }
+    state.texture1.update(state.pixels1.data());
+    state.texture2.update(state.pixels2.data());
+
+    // Blur Fade and Luma Wipe read CPU pixels, so they also need graded sf::Image copies
+    if (needImages) {
+        state.image1.resize(size1, state.pixels1.data());
+        state.image2.resize(size2, state.pixels2.data());
+    }
+}
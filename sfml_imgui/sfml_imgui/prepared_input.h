@@ -0,0 +1,89 @@
+#ifndef PREPARED_INPUT_H
+#define PREPARED_INPUT_H
+
+#include <filesystem>
+#include <memory>
+#include <SFML/Graphics.hpp>
+#include "exposure_match.h"
+
+class ClipStream;
+
+// One transition input with everything derived from it at load time.
+// Not copyable: the sprite keeps a pointer to the texture next to it.
+struct PreparedInput {
+    std::shared_ptr<const sf::Image> source;  // Exactly as loaded from disk (straight alpha); shared with the memo
+    sf::Image cache;              // CPU copy for the CPU kernels (premultiplied in the alpha-preserving mode)
+    sf::Texture texture;
+    sf::Sprite sprite{ texture };
+    ChannelHistogram histogram;
+    std::vector<std::uint8_t> luma;  // Luminance of 'cache', the Luma Wipe mask when this is the second input
+    unsigned int generation = 0;  // Bumped on every prepare so dependent caches can tell they are stale
+    std::uint64_t sourceKey = 0;  // Content key of 'source' in the render graph (0: not known yet)
+    std::shared_ptr<ClipStream> clip;  // Set for video-clip inputs: advanced once per exported frame
+
+    PreparedInput() = default;
+    PreparedInput(const PreparedInput&) = delete;
+    PreparedInput& operator=(const PreparedInput&) = delete;
+
+    bool IsLoaded() const { return texture.getSize().x > 0; }
+    bool IsReady() const { return IsLoaded() || clip != nullptr; }
+};
+
+// Loads an image file (reduced to the detail it can show, see LoadInputImage) and
+// prepares it. Leaves 'input' untouched on failure.
+bool LoadInput(PreparedInput& input, const std::filesystem::path& path);
+
+// Derives the texture, CPU copy, histogram and luma plane from input.source using the current
+// alpha mode. Runs once per load, and again when the alpha mode is switched. The CPU stages
+// are render graph nodes; the CPU copy and the luma plane are kept by the input itself,
+// not by the memo, so only the decoded source and the histogram are shared.
+void PrepareInput(PreparedInput& input);
+
+// The two halves of LoadInput / PrepareInput, for callers that run the CPU work on another
+// thread (see async_jobs.h). Everything except ApplyInputStages is safe on any thread.
+struct InputStages {
+    std::shared_ptr<const sf::Image> cache;
+    std::shared_ptr<const ChannelHistogram> histogram;
+    std::shared_ptr<const std::vector<std::uint8_t>> luma;
+};
+
+// Decode node of LoadInput, memoized by path, size and modification time.
+// Returns nullptr on failure; 'key' receives the content key of the result and 'decoded'
+// whether the file was actually decoded (false when the memo had it).
+std::shared_ptr<const sf::Image> DecodeInputSource(const std::filesystem::path& path, std::uint64_t& key,
+    bool* decoded = nullptr);
+// Key DecodeInputSource would give the file, without decoding it
+std::uint64_t InputSourceKey(const std::filesystem::path& path);
+bool ComputeInputStages(const sf::Image& source, std::uint64_t sourceKey, bool premultiply, InputStages& stages);
+// Uploads the texture; must run on the thread that draws 'input'
+bool ApplyInputStages(PreparedInput& input, const InputStages& stages);
+
+// Memory held by the CPU copy and luma plane of 'input'. 'source' is left out: it is
+// charged to its decode node in the memo.
+size_t PreparedInputBytes(const PreparedInput& input);
+
+// --- EXPOSURE MATCHING ---
+// Graded copies of a pair of inputs, refreshed every frame while matching is enabled
+struct ExposureMatchState {
+    ChannelLut lut1To2, lut2To1;
+    unsigned int generation1 = 0, generation2 = 0;
+    bool lutValid = false;
+
+    PixelBuffer pixels1, pixels2;     // Rewritten every frame by the parallel LUT pass
+    sf::Image image1, image2;
+    sf::Texture texture1, texture2;
+    sf::Sprite sprite1{ texture1 };
+    sf::Sprite sprite2{ texture2 };
+
+    ExposureMatchState() = default;
+    ExposureMatchState(const ExposureMatchState&) = delete;
+    ExposureMatchState& operator=(const ExposureMatchState&) = delete;
+};
+
+// Grades both inputs toward each other. Image 1 drifts toward the tones of image 2
+// as progress grows and image 2 starts fully matched to image 1, so the middle of a
+// fade never pulses in brightness and both ends still show the untouched originals.
+void UpdateExposureMatchedInputs(ExposureMatchState& state, const PreparedInput& in1, const PreparedInput& in2,
+    float progress, bool needImages);
+
+#endif //PREPARED_INPUT_H
@@ -0,0 +1,180 @@
+#include "pch.h"
+#include "qoi.h"
+#include <cstring>
+
+namespace {
+    const std::uint8_t QOI_OP_INDEX = 0x00;
+    const std::uint8_t QOI_OP_DIFF = 0x40;
+    const std::uint8_t QOI_OP_LUMA = 0x80;
+    const std::uint8_t QOI_OP_RUN = 0xc0;
+    const std::uint8_t QOI_OP_RGB = 0xfe;
+    const std::uint8_t QOI_OP_RGBA = 0xff;
+    const std::uint8_t QOI_MASK_2 = 0xc0;
+    const std::uint8_t QOI_PADDING[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    // Limit from the reference decoder: 400 megapixels, 1.6 GB decoded
+    const std::uint64_t QOI_PIXELS_MAX = 400000000;
+    // Longest run a single chunk can produce
+    const std::uint64_t QOI_MAX_RUN = 62;
+
+    struct Px { std::uint8_t r, g, b, a; };
+
+    inline bool operator==(const Px& x, const Px& y) { return std::memcmp(&x, &y, 4) == 0; }
+    inline int Hash(const Px& p) { return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64; }
+
+    void WriteU32(std::vector<std::uint8_t>& out, std::uint32_t v)
+    {
+        out.push_back(static_cast<std::uint8_t>(v >> 24));
+        out.push_back(static_cast<std::uint8_t>(v >> 16));
+        out.push_back(static_cast<std::uint8_t>(v >> 8));
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    std::uint32_t ReadU32(const std::uint8_t* p)
+    {
+        return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+    }
+}
+
+std::vector<std::uint8_t> EncodeQoi(const std::uint8_t* rgba, unsigned int width, unsigned int height)
+{
+    std::vector<std::uint8_t> out;
+    size_t totalPixels = static_cast<size_t>(width) * height;
+    // Worst case is one QOI_OP_RGBA per pixel
+    out.reserve(14 + totalPixels * 5 + sizeof(QOI_PADDING));
+
+    out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+    WriteU32(out, width);
+    WriteU32(out, height);
+    out.push_back(4); // channels
+    out.push_back(0); // sRGB with linear alpha
+
+    Px index[64] = {};
+    Px prev = { 0, 0, 0, 255 };
+    int run = 0;
+
+    for (size_t i = 0; i < totalPixels; ++i) {
+        Px px;
+        std::memcpy(&px, rgba + i * 4, 4);
+
+        if (px == prev) {
+            ++run;
+            if (run == 62 || i + 1 == totalPixels) {
+                out.push_back(static_cast<std::uint8_t>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            out.push_back(static_cast<std::uint8_t>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        int h = Hash(px);
+        if (index[h] == px) {
+            out.push_back(static_cast<std::uint8_t>(QOI_OP_INDEX | h));
+        }
+        else {
+            index[h] = px;
+            if (px.a == prev.a) {
+                signed char vr = static_cast<signed char>(px.r - prev.r);
+                signed char vg = static_cast<signed char>(px.g - prev.g);
+                signed char vb = static_cast<signed char>(px.b - prev.b);
+                signed char vgr = static_cast<signed char>(vr - vg);
+                signed char vgb = static_cast<signed char>(vb - vg);
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    out.push_back(static_cast<std::uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                }
+                else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                    out.push_back(static_cast<std::uint8_t>(QOI_OP_LUMA | (vg + 32)));
+                    out.push_back(static_cast<std::uint8_t>((vgr + 8) << 4 | (vgb + 8)));
+                }
+                else {
+                    out.insert(out.end(), { QOI_OP_RGB, px.r, px.g, px.b });
+                }
+            }
+            else {
+                out.insert(out.end(), { QOI_OP_RGBA, px.r, px.g, px.b, px.a });
+            }
+        }
+        prev = px;
+    }
+
+    out.insert(out.end(), std::begin(QOI_PADDING), std::end(QOI_PADDING));
+    return out;
+}
+
+bool DecodeQoi(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& rgba,
+    unsigned int& width, unsigned int& height)
+{
+    if (size < 14 + sizeof(QOI_PADDING) || std::memcmp(data, "qoif", 4) != 0) return false;
+
+    width = ReadU32(data + 4);
+    height = ReadU32(data + 8);
+    if (width == 0 || height == 0) return false;
+    // Checked before allocating: a corrupt header must not ask for gigabytes the file
+    // could never fill, and every chunk covers at most QOI_MAX_RUN pixels
+    std::uint64_t totalPixels = std::uint64_t(width) * height;
+    if (totalPixels > QOI_PIXELS_MAX || totalPixels > (size - 14 - sizeof(QOI_PADDING)) * QOI_MAX_RUN) return false;
+
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    return DecodeQoiInto(data, size, rgba.data(), width, height);
+}
+
+bool DecodeQoiInto(const std::uint8_t* data, size_t size, std::uint8_t* rgba,
+    unsigned int width, unsigned int height)
+{
+    if (size < 14 + sizeof(QOI_PADDING) || std::memcmp(data, "qoif", 4) != 0) return false;
+    if (ReadU32(data + 4) != width || ReadU32(data + 8) != height || data[12] < 3 || data[12] > 4) return false;
+
+    size_t totalPixels = static_cast<size_t>(width) * height;
+
+    Px index[64] = {};
+    Px px = { 0, 0, 0, 255 };
+    size_t p = 14;
+    size_t chunksEnd = size - sizeof(QOI_PADDING);
+    int run = 0;
+
+    for (size_t i = 0; i < totalPixels; ++i) {
+        if (run > 0) {
+            --run;
+        }
+        else if (p < chunksEnd) {
+            std::uint8_t b1 = data[p++];
+            if (b1 == QOI_OP_RGB) {
+                if (p + 3 > chunksEnd) return false;
+                px.r = data[p++]; px.g = data[p++]; px.b = data[p++];
+            }
+            else if (b1 == QOI_OP_RGBA) {
+                if (p + 4 > chunksEnd) return false;
+                px.r = data[p++]; px.g = data[p++]; px.b = data[p++]; px.a = data[p++];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                px.r += ((b1 >> 4) & 0x03) - 2;
+                px.g += ((b1 >> 2) & 0x03) - 2;
+                px.b += (b1 & 0x03) - 2;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                if (p + 1 > chunksEnd) return false;
+                std::uint8_t b2 = data[p++];
+                int vg = (b1 & 0x3f) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 0x0f);
+            }
+            else {
+                run = b1 & 0x3f;
+            }
+            index[Hash(px)] = px;
+        }
+        else {
+            return false;
+        }
+        std::memcpy(rgba + i * 4, &px, 4);
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include <cstdint>
+#include <vector>
+
+// Minimal encoder for the "Quite OK Image" format (https://qoiformat.org).
+// Input is tightly packed RGBA8; output is a complete .qoi file in memory.
+// QOI is lossless and several times faster to write than PNG, which makes it a
+// good intermediate format for long frame sequences.
+std::vector<std::uint8_t> EncodeQoi(const std::uint8_t* rgba, unsigned int width, unsigned int height);
+
+// Decodes a .qoi file into RGBA8. Returns false on malformed input, including headers
+// claiming more than 400 megapixels or more pixels than the data can encode.
+bool DecodeQoi(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& rgba,
+    unsigned int& width, unsigned int& height);
+
+// Decodes a .qoi file of exactly width x height pixels into caller-owned memory
+// (width * height * 4 bytes). Returns false on malformed input or a size mismatch.
+bool DecodeQoiInto(const std::uint8_t* data, size_t size, std::uint8_t* rgba,
+    unsigned int width, unsigned int height);
+
+#endif //QOI_H
@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "render_graph.h"
+#include <cstring>
+#include <future>
+
+GraphKey HashBytes(const void* data, size_t size, GraphKey seed)
+{
+    // FNV-1a over 8-byte words: fast enough to key whole images
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+    GraphKey h = seed ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        h = (h ^ word) * 1099511628211ull;
+    }
+    for (; i < size; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+GraphKey HashCombine(GraphKey a, GraphKey b)
+{
+    return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+}
+
+GraphKey HashImage(const sf::Image& image)
+{
+    sf::Vector2u size = image.getSize();
+    GraphKey h = HashCombine(size.x, size.y);
+    if (size.x == 0 || size.y == 0) return h;
+    return HashBytes(image.getPixelsPtr(), GraphValueBytes(image), h);
+}
+
+// --- MEMO ---
+std::shared_ptr<const void> GraphMemo::Find(GraphKey key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+    lru.splice(lru.begin(), lru, found->second);
+    return found->second->value;
+}
+
+void GraphMemo::Store(GraphKey key, std::shared_ptr<const void> value, size_t bytes)
+{
+    // Evicted values are released after the lock: prepared inputs free GPU textures
+    std::list<Entry> evicted;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > budget || index.count(key)) return;
+    lru.push_front(Entry{ key, std::move(value), bytes });
+    index[key] = lru.begin();
+    stats.bytes += bytes;
+    while (stats.bytes > budget) {
+        stats.bytes -= lru.back().bytes;
+        index.erase(lru.back().key);
+        evicted.splice(evicted.end(), lru, std::prev(lru.end()));
+    }
+}
+
+bool GraphMemo::Contains(GraphKey key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.count(key) != 0;
+}
+
+void GraphMemo::Erase(GraphKey key)
+{
+    std::list<Entry> erased;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) return;
+    stats.bytes -= found->second->bytes;
+    erased.splice(erased.end(), lru, found->second);
+    index.erase(found);
+}
+
+void GraphMemo::Clear()
+{
+    std::list<Entry> cleared;
+    std::lock_guard<std::mutex> lock(mutex);
+    cleared.swap(lru);
+    index.clear();
+    stats.bytes = 0;
+}
+
+GraphMemo::Stats GraphMemo::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s = stats;
+    s.entries = lru.size();
+    return s;
+}
+
+GraphMemo& SharedGraphMemo()
+{
+    static GraphMemo memo;
+    return memo;
+}
+
+// --- GRAPH ---
+void RenderGraph::Require(int id, std::vector<bool>& needed)
+{
+    Node& node = nodes[id];
+    if (needed[id] || node.value) return;
+    if (node.memoize) {
+        if (auto value = memo.Find(node.key)) {
+            node.value = std::move(value);
+            node.reused = true;
+            stats.reused++;
+            return;
+        }
+    }
+    needed[id] = true;
+    for (int in : node.inputs) Require(in, needed);
+}
+
+bool RenderGraph::Evaluate(const std::vector<int>& targets)
+{
+    std::vector<bool> needed(nodes.size(), false);
+    for (int id : targets) Require(id, needed);
+
+    // Waves: every node whose inputs are all available runs concurrently with the others
+    for (;;) {
+        std::vector<int> ready;
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            Node& node = nodes[id];
+            if (!needed[id] || node.value || node.failed) continue;
+            bool waiting = false;
+            for (int in : node.inputs) {
+                if (nodes[in].failed) node.failed = true;
+                else if (!nodes[in].value) waiting = true;
+            }
+            if (!node.failed && !waiting) ready.push_back(static_cast<int>(id));
+        }
+        if (ready.empty()) break;
+
+        std::vector<std::future<Computed>> running;
+        for (size_t i = 1; i < ready.size(); ++i) {
+            Node& node = nodes[ready[i]];
+            GraphInputs in;
+            for (int id : node.inputs) in.values.push_back(nodes[id].value);
+            running.push_back(std::async(std::launch::async, node.compute, std::move(in)));
+        }
+        std::vector<Computed> results(ready.size());
+        {
+            // The first ready node runs on the calling thread
+            GraphInputs in;
+            for (int id : nodes[ready[0]].inputs) in.values.push_back(nodes[id].value);
+            results[0] = nodes[ready[0]].compute(in);
+        }
+        for (size_t i = 1; i < ready.size(); ++i) results[i] = running[i - 1].get();
+
+        for (size_t i = 0; i < ready.size(); ++i) {
+            Node& node = nodes[ready[i]];
+            stats.computed++;
+            if (!results[i].value) {
+                node.failed = true;
+                continue;
+            }
+            node.value = results[i].value;
+            if (node.memoize) memo.Store(node.key, results[i].value, results[i].bytes);
+        }
+    }
+
+    for (int id : targets) {
+        if (!nodes[id].value) return false;
+    }
+    return true;
+}
@@ -0,0 +1,181 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+// Small dataflow runtime for the image pipeline. Nodes declare their inputs and a hash
+// of their parameters; every result is identified by a content key (operation, parameters
+// and the keys of its inputs), so a node whose key was computed before - in this graph,
+// an earlier one, the preview or a batch job - is taken from the shared memo instead of
+// being recomputed. Changing a parameter therefore only reruns the nodes downstream of it.
+// Independent nodes of one evaluation run in parallel.
+
+using GraphKey = std::uint64_t;
+
+GraphKey HashBytes(const void* data, size_t size, GraphKey seed = 1469598103934665603ull);
+GraphKey HashCombine(GraphKey a, GraphKey b);
+inline GraphKey HashString(const std::string& text, GraphKey seed = 1469598103934665603ull)
+{
+    return HashBytes(text.data(), text.size(), seed);
+}
+// Content hash of the pixels (and size) of an image
+GraphKey HashImage(const sf::Image& image);
+
+// Approximate memory held by a result, charged against the memo budget
+inline size_t GraphValueBytes(const sf::Image& image) { return static_cast<size_t>(image.getSize().x) * image.getSize().y * 4; }
+inline size_t GraphValueBytes(const std::vector<std::uint8_t>& data) { return data.size(); }
+template <typename T> size_t GraphValueBytes(const T&) { return sizeof(T); }
+
+// Results by content key, LRU bounded in bytes. Thread safe.
+class GraphMemo {
+public:
+    // Also holds the prepared inputs of every InputCache
+    static constexpr size_t DEFAULT_BUDGET = size_t(1) << 30;
+
+    struct Stats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    explicit GraphMemo(size_t budget = DEFAULT_BUDGET) : budget(budget) {}
+
+    std::shared_ptr<const void> Find(GraphKey key);
+    void Store(GraphKey key, std::shared_ptr<const void> value, size_t bytes);
+    // Neither counts as a hit or a miss nor changes the LRU order
+    bool Contains(GraphKey key) const;
+    void Erase(GraphKey key);
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        GraphKey key;
+        std::shared_ptr<const void> value;
+        size_t bytes;
+    };
+
+    size_t budget;
+    mutable std::mutex mutex;
+    std::list<Entry> lru;   // Most recently used first
+    std::unordered_map<GraphKey, std::list<Entry>::iterator> index;
+    Stats stats;
+};
+
+// Memo shared by the GUI and all headless jobs of the process
+GraphMemo& SharedGraphMemo();
+
+// Input values handed to a node's compute function, in declaration order
+class GraphInputs {
+public:
+    template <typename T> const T& Get(size_t i) const { return *static_cast<const T*>(values[i].get()); }
+
+    std::vector<std::shared_ptr<const void>> values;
+};
+
+template <typename T> struct GraphNode {
+    int id = -1;
+};
+
+class RenderGraph {
+public:
+    struct Stats {
+        size_t computed = 0;
+        size_t reused = 0;   // Taken from the memo
+    };
+
+    explicit RenderGraph(GraphMemo& memo = SharedGraphMemo()) : memo(memo) {}
+
+    // Value owned by the caller (it must outlive the evaluation); never memoized.
+    // 'key' identifies its content.
+    template <typename T>
+    GraphNode<T> Constant(const std::string& name, GraphKey key, const T& value)
+    {
+        Node node;
+        node.name = name;
+        node.key = key;
+        node.memoize = false;
+        node.value = std::shared_ptr<const void>(std::shared_ptr<const void>(), &value);
+        nodes.push_back(std::move(node));
+        return { static_cast<int>(nodes.size()) - 1 };
+    }
+
+    // Node computing a T from 'inputs'. 'params' hashes everything besides the inputs that
+    // affects the result. 'compute' returns std::shared_ptr<T>; nullptr marks a failure,
+    // which is not memoized and fails every node downstream.
+    template <typename T, typename Fn>
+    GraphNode<T> Add(const std::string& name, std::vector<int> inputs, GraphKey params, Fn compute)
+    {
+        Node node;
+        node.name = name;
+        node.key = HashCombine(HashString(name), params);
+        for (int in : inputs) node.key = HashCombine(node.key, nodes[in].key);
+        node.inputs = std::move(inputs);
+        node.compute = [compute](const GraphInputs& in) -> Computed {
+            std::shared_ptr<const T> value = compute(in);
+            return { value, value ? GraphValueBytes(*value) : 0 };
+        };
+        nodes.push_back(std::move(node));
+        return { static_cast<int>(nodes.size()) - 1 };
+    }
+
+    // Like Add, but the result stays with this graph and never goes to the memo: for
+    // results the caller keeps anyway, which the memo would otherwise hold a second time
+    template <typename T, typename Fn>
+    GraphNode<T> AddTransient(const std::string& name, std::vector<int> inputs, GraphKey params, Fn compute)
+    {
+        GraphNode<T> node = Add<T>(name, std::move(inputs), params, std::move(compute));
+        nodes[node.id].memoize = false;
+        return node;
+    }
+
+    // True when the last Evaluate took this node from the memo
+    bool Reused(int id) const { return nodes[id].reused; }
+
+    // Computes the targets and everything they need that is not memoized.
+    // Returns false if any target failed.
+    bool Evaluate(const std::vector<int>& targets);
+
+    template <typename T>
+    std::shared_ptr<const T> Result(GraphNode<T> node) const
+    {
+        return std::static_pointer_cast<const T>(nodes[node.id].value);
+    }
+
+    GraphKey Key(int id) const { return nodes[id].key; }
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Computed {
+        std::shared_ptr<const void> value;
+        size_t bytes;
+    };
+
+    struct Node {
+        std::string name;
+        std::vector<int> inputs;
+        GraphKey key = 0;
+        bool memoize = true;
+        std::function<Computed(const GraphInputs&)> compute;
+        std::shared_ptr<const void> value;
+        bool failed = false;
+        bool reused = false;
+    };
+
+    void Require(int id, std::vector<bool>& needed);
+
+    GraphMemo& memo;
+    std::vector<Node> nodes;   // Inputs always precede their users
+    Stats stats;
+};
+
+#endif //RENDER_GRAPH_H
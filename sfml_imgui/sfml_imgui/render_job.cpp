@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "render_job.h"
+#include "transitions.h"
+#include "clip_source.h"
+#include "slideshow.h"
+#include "pixel_expr.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+bool ParseRenderJob(const JsonObject& obj, RenderJob& job, std::string& error)
+{
+    job.id = JsonGetString(obj, "id", "job");
+    job.image1 = JsonGetString(obj, "image1");
+    job.image2 = JsonGetString(obj, "image2");
+    job.output = JsonGetString(obj, "output");
+    SequenceSettings& s = job.settings;
+    s.ring = JsonGetString(obj, "ring");
+    s.archive = JsonGetString(obj, "archive");
+    s.archiveIndex = JsonGetBool(obj, "archiveIndex", true);
+    s.mezzanine = JsonGetString(obj, "mezzanine");
+    job.slideshow = JsonGetString(obj, "slideshow");
+    if ((job.slideshow.empty() && (job.image1.empty() || job.image2.empty())) ||
+        (job.output.empty() && s.ring.empty() && s.archive.empty() && s.mezzanine.empty())) {
+        error = "image1, image2 (or slideshow) and output (or archive, mezzanine, or ring) are required";
+        return false;
+    }
+    if (!job.slideshow.empty() && (job.output.empty() || !s.ring.empty() || !s.archive.empty() || !s.mezzanine.empty())) {
+        // Every segment is a separate export, which only folder output can append to
+        error = "slideshow output must be a folder";
+        return false;
+    }
+    job.storeBudgetMb = static_cast<int>(JsonGetInt(obj, "storeBudgetMB", 512));
+    if (job.storeBudgetMb < 1) { error = "storeBudgetMB must be positive"; return false; }
+    s.mezzanineKeyInterval = static_cast<unsigned int>(JsonGetInt(obj, "mezzanineKeyInterval",
+        MezzanineWriter::DEFAULT_KEY_INTERVAL));
+    if (s.mezzanineKeyInterval < 1 || s.mezzanineKeyInterval > 1000) {
+        error = "mezzanineKeyInterval must be 1..1000"; return false;
+    }
+    s.writer.queueDepth = static_cast<unsigned int>(JsonGetInt(obj, "ioDepth", 8));
+    s.writer.directIo = JsonGetBool(obj, "directIo", false);
+    s.writer.allowUring = JsonGetString(obj, "ioBackend", "auto") != "threads";
+    if (s.writer.queueDepth < 1 || s.writer.queueDepth > 256) { error = "ioDepth must be 1..256"; return false; }
+    s.ringSlots = static_cast<unsigned int>(JsonGetInt(obj, "ringSlots", 4));
+    s.ringEncoded = JsonGetBool(obj, "ringEncoded", false);
+    if (s.ringSlots < 1 || s.ringSlots > 64) { error = "ringSlots must be 1..64"; return false; }
+
+    s.transition = static_cast<int>(JsonGetInt(obj, "transition", 0));
+    s.frames = static_cast<int>(JsonGetInt(obj, "frames", 60));
+    s.exposureMatch = JsonGetBool(obj, "exposureMatch", false);
+    job.expression = JsonGetString(obj, "expression");
+    if (!job.expression.empty()) s.transition = EXPRESSION_TRANSITION;
+    else if (s.transition < 0 || s.transition > 15) { error = "transition must be 0..15"; return false; }
+    if (s.frames < 1 || s.frames > 100000) { error = "frames out of range"; return false; }
+    s.firstFrame = static_cast<int>(JsonGetInt(obj, "firstFrame", 0));
+    s.lastFrame = static_cast<int>(JsonGetInt(obj, "lastFrame", s.frames));
+    if (s.firstFrame < 0 || s.lastFrame > s.frames || s.firstFrame > s.lastFrame) {
+        error = "firstFrame..lastFrame must lie within 0..frames"; return false;
+    }
+
+    std::string format = JsonGetString(obj, "format", "png");
+    if (format == "png") s.output.format = FrameFormat::Png;
+    else if (format == "qoi") s.output.format = FrameFormat::Qoi;
+    else { error = "unknown format '" + format + "'"; return false; }
+
+    job.transparent = JsonGetBool(obj, "transparent", false);
+    job.deterministic = JsonGetBool(obj, "deterministic", false);
+    job.clip1Offset = static_cast<int>(JsonGetInt(obj, "clip1Offset", -1));
+    job.clip2Offset = static_cast<int>(JsonGetInt(obj, "clip2Offset", 0));
+    if (job.clip1Offset < -1 || job.clip2Offset < -1) { error = "clip offsets must be -1 or a frame number"; return false; }
+    s.output.unpremultiply = JsonGetBool(obj, "unpremultiply", true);
+
+    int factor = static_cast<int>(JsonGetInt(obj, "supersample", 1));
+    if (factor != 1 && factor != 2 && factor != 4) { error = "supersample must be 1, 2 or 4"; return false; }
+    s.supersample.factor = factor;
+    s.supersample.filter = JsonGetString(obj, "filter", "box") == "lanczos" ? DownsampleFilter::Lanczos3 : DownsampleFilter::Box;
+    s.supersample.dither = JsonGetBool(obj, "dither", true);
+    return true;
+}
+
+std::string RenderJobToJson(const RenderJob& job)
+{
+    const SequenceSettings& s = job.settings;
+    return JsonWriter()
+        .Add("id", job.id)
+        .Add("image1", job.image1)
+        .Add("image2", job.image2)
+        .Add("output", job.output)
+        .Add("transition", s.transition)
+        .Add("frames", s.frames)
+        .Add("firstFrame", s.firstFrame)
+        .Add("lastFrame", s.lastFrame < 0 ? s.frames : s.lastFrame)
+        .Add("format", s.output.format == FrameFormat::Qoi ? "qoi" : "png")
+        .Add("transparent", job.transparent)
+        .Add("deterministic", job.deterministic)
+        .Add("clip1Offset", job.clip1Offset)
+        .Add("clip2Offset", job.clip2Offset)
+        .Add("slideshow", job.slideshow)
+        .Add("storeBudgetMB", job.storeBudgetMb)
+        .Add("expression", job.expression)
+        .Add("unpremultiply", s.output.unpremultiply)
+        .Add("supersample", s.supersample.factor)
+        .Add("filter", s.supersample.filter == DownsampleFilter::Lanczos3 ? "lanczos" : "box")
+        .Add("dither", s.supersample.dither)
+        .Add("exposureMatch", s.exposureMatch)
+        .Add("ioDepth", s.writer.queueDepth)
+        .Add("directIo", s.writer.directIo)
+        .Add("ioBackend", s.writer.allowUring ? "auto" : "threads")
+        .Add("archive", s.archive)
+        .Add("archiveIndex", s.archiveIndex)
+        .Add("mezzanine", s.mezzanine)
+        .Add("mezzanineKeyInterval", s.mezzanineKeyInterval)
+        .Add("ring", s.ring)
+        .Add("ringSlots", s.ringSlots)
+        .Add("ringEncoded", s.ringEncoded)
+        .str();
+}
+
+int ExecuteRenderJob(const RenderJob& job, InputCache& cache, const FrameCallback& onFrame, std::string& error)
+{
+    error.clear();
+    premultipliedPipeline = job.transparent;
+    blueNoiseDither = job.settings.supersample.dither;
+    deterministicRendering = job.deterministic;
+
+    SequenceSettings settings = job.settings;
+    if (!job.expression.empty()) {
+        settings.expression = LoadPixelProgram(job.expression, error);
+        if (!settings.expression) return 0;
+    }
+
+    if (!job.slideshow.empty()) {
+        std::vector<std::string> images;
+        if (!ReadSlideshowList(job.slideshow, images, error)) return 0;
+        ImageStore store(static_cast<size_t>(job.storeBudgetMb) << 20);
+        return ExportSlideshow(images, store, settings, job.output, onFrame, &error);
+    }
+
+    // Clips are streams with a read position, so they are opened per job and never cached
+    auto acquire = [&](const std::string& path, int clipOffset) {
+        if (IsClipPath(path))
+            return OpenClipInput(path, clipOffset, job.settings.frames, std::max(0, job.settings.firstFrame), &error);
+        return cache.Acquire(path, &error);
+    };
+    std::shared_ptr<PreparedInput> in1 = acquire(job.image1, job.clip1Offset);
+    std::shared_ptr<PreparedInput> in2 = in1 ? acquire(job.image2, job.clip2Offset) : nullptr;
+    if (!in1 || !in2) return 0;
+    return ExportSequence(*in1, *in2, settings, job.output, onFrame, &error);
+}
+
+bool ReadJobText(const std::string& job, std::string& text)
+{
+    text = job;
+    if (text.empty() || text[0] != '{') {
+        std::ifstream file(job);
+        if (!file) return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        text = ss.str();
+    }
+    // The protocol is line based, so a pretty-printed job file is folded onto one line
+    for (char& c : text) if (c == '\n' || c == '\r') c = ' ';
+    return true;
+}
+
+bool LoadRenderJob(const std::string& job, RenderJob& out, std::string& error)
+{
+    std::string text;
+    if (!ReadJobText(job, text)) { error = "cannot open job file " + job; return false; }
+    JsonObject obj;
+    if (!ParseFlatJson(text, obj)) { error = "job is not a flat JSON object"; return false; }
+    return ParseRenderJob(obj, out, error);
+}
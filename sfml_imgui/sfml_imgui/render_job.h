@@ -0,0 +1,44 @@
+#ifndef RENDER_JOB_H
+#define RENDER_JOB_H
+
+#include <string>
+#include "json_lite.h"
+#include "sequence_export.h"
+#include "input_cache.h"
+
+// A complete, self-contained export request as used by the headless modes
+struct RenderJob {
+    std::string id;
+    std::string image1;
+    std::string image2;
+    std::string output;          // Output folder
+    bool transparent = false;    // Alpha-preserving (premultiplied) pipeline
+    bool deterministic = false;  // Bit-exact frames on every machine (deterministicRendering)
+    int clip1Offset = -1;        // Clip frame at transition frame 0 (-1: end clip 1 with the transition)
+    int clip2Offset = 0;
+    std::string slideshow;       // List file of images; replaces image1/image2
+    int storeBudgetMb = 512;     // Decompressed images a slideshow keeps cached
+    std::string expression;      // .tfx script; selects EXPRESSION_TRANSITION
+    SequenceSettings settings;
+};
+
+// Fills 'job' from a parsed job line. Unknown keys are ignored; missing optional keys keep defaults.
+bool ParseRenderJob(const JsonObject& obj, RenderJob& job, std::string& error);
+
+// Reads a job given either as inline JSON (starting with '{') or as a path to a JSON file,
+// folded onto a single line. Returns false when the file cannot be read.
+bool ReadJobText(const std::string& job, std::string& text);
+
+// ReadJobText, ParseFlatJson and ParseRenderJob in one step
+bool LoadRenderJob(const std::string& job, RenderJob& out, std::string& error);
+
+// Sets this thread's render switches for the job, takes both inputs from 'cache' (or
+// opens them as streamed clips, see IsClipPath) and exports. Slideshow jobs go through
+// a compressed ImageStore instead. An expression script is compiled here, so relative
+// paths resolve against the caller's final paths. Returns the number of frames written; 'error' is empty on success.
+int ExecuteRenderJob(const RenderJob& job, InputCache& cache, const FrameCallback& onFrame, std::string& error);
+
+// Inverse of ParseRenderJob (single line, no trailing newline)
+std::string RenderJobToJson(const RenderJob& job);
+
+#endif //RENDER_JOB_H
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "render_service.h"
+#include "local_socket.h"
+#include "input_cache.h"
+#include "render_job.h"
+#include "render_graph.h"
+#include "transitions.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    std::string EventLine(const char* event, const std::string& id)
+    {
+        return JsonWriter().Add("event", event).Add("id", id).str();
+    }
+
+    std::string ErrorLine(const std::string& id, const std::string& message)
+    {
+        return JsonWriter().Add("event", "error").Add("id", id).Add("message", message).str();
+    }
+
+    // Runs one job and streams its events back. Returns false when the client went away.
+    bool ServeJob(LocalSocket& client, InputCache& cache, const RenderJob& job)
+    {
+        if (!client.SendLine(EventLine("accepted", job.id))) return false;
+
+        auto start = std::chrono::steady_clock::now();
+        bool clientAlive = true;
+        std::string error;
+        int written = ExecuteRenderJob(job, cache, [&](int frame, int total) {
+            clientAlive = client.SendLine(JsonWriter()
+                .Add("event", "progress").Add("id", job.id).Add("frame", frame).Add("total", total).str());
+            return clientAlive;   // Nobody is listening any more: stop rendering
+        }, error);
+        if (!clientAlive) return false;
+
+        if (!error.empty()) return client.SendLine(ErrorLine(job.id, error));
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return client.SendLine(JsonWriter()
+            .Add("event", "done").Add("id", job.id).Add("frames", written).Add("ms", ms).str());
+    }
+}
+
+int RunRenderService(const std::string& socketPath)
+{
+    LocalSocket server;
+    if (!server.Listen(socketPath)) {
+        std::cerr << "Render service: cannot listen on " << socketPath << std::endl;
+        return 1;
+    }
+    std::cout << "Render service listening on " << socketPath << std::endl;
+
+    InputCache cache;
+    bool running = true;
+    while (running) {
+        LocalSocket client = server.Accept();
+        if (!client.IsValid()) continue;
+
+        std::string line;
+        while (running && client.ReadLine(line)) {
+            if (line.empty()) continue;
+
+            JsonObject request;
+            if (!ParseFlatJson(line, request)) {
+                if (!client.SendLine(ErrorLine("", "malformed request"))) break;
+                continue;
+            }
+
+            std::string cmd = JsonGetString(request, "cmd");
+            if (cmd == "ping") {
+                if (!client.SendLine(JsonWriter().Add("event", "pong").str())) break;
+            }
+            else if (cmd == "stats") {
+                InputCache::Stats st = cache.GetStats();
+                GraphMemo::Stats memo = SharedGraphMemo().GetStats();
+                if (!client.SendLine(JsonWriter().Add("event", "stats")
+                    .Add("cachedInputs", static_cast<long long>(st.entries))
+                    .Add("hits", static_cast<long long>(st.hits))
+                    .Add("misses", static_cast<long long>(st.misses))
+                    .Add("reprepared", static_cast<long long>(st.reprepared))
+                    .Add("memoEntries", static_cast<long long>(memo.entries))
+                    .Add("memoBytes", static_cast<long long>(memo.bytes))
+                    .Add("memoHits", static_cast<long long>(memo.hits)).str())) break;
+            }
+            else if (cmd == "shutdown") {
+                client.SendLine(JsonWriter().Add("event", "bye").str());
+                running = false;
+            }
+            else if (!cmd.empty()) {
+                if (!client.SendLine(ErrorLine("", "unknown command '" + cmd + "'"))) break;
+            }
+            else {
+                RenderJob job;
+                std::string error;
+                if (!ParseRenderJob(request, job, error)) {
+                    if (!client.SendLine(ErrorLine(JsonGetString(request, "id"), error))) break;
+                    continue;
+                }
+                if (!ServeJob(client, cache, job)) break;
+            }
+        }
+    }
+    return 0;
+}
+
+int RunRenderClient(const std::string& socketPath, const std::string& job)
+{
+    std::string request;
+    if (!ReadJobText(job, request)) {
+        std::cerr << "Cannot open job file " << job << std::endl;
+        return 1;
+    }
+
+    JsonObject parsed;
+    if (!ParseFlatJson(request, parsed)) {
+        std::cerr << "Job is not a flat JSON object" << std::endl;
+        return 1;
+    }
+    std::string cmd = JsonGetString(parsed, "cmd");
+
+    LocalSocket socket;
+    if (!socket.Connect(socketPath)) {
+        std::cerr << "Cannot connect to render service at " << socketPath << std::endl;
+        return 1;
+    }
+    if (!socket.SendLine(request)) return 1;
+
+    std::string line;
+    while (socket.ReadLine(line)) {
+        std::cout << line << std::endl;
+        JsonObject event;
+        if (!ParseFlatJson(line, event)) continue;
+        std::string name = JsonGetString(event, "event");
+        if (name == "error") return 1;
+        if (name == "done") return 0;
+        // Commands get exactly one reply
+        if (!cmd.empty()) return 0;
+    }
+    std::cerr << "Render service closed the connection" << std::endl;
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef RENDER_SERVICE_H
+#define RENDER_SERVICE_H
+
+#include <string>
+
+// --- HEADLESS RENDER SERVICE ---
+// Long-running process that accepts export jobs on a Unix domain socket, so repeated
+// jobs don't pay for process start-up, GL context creation or re-decoding shared inputs.
+//
+// Protocol: one flat JSON object per line in both directions.
+//   Job:      {"id":"a1","image1":"in/a.jpg","image2":"in/b.jpg","output":"out/a1",
+//              "transition":7,"frames":60,"format":"png"|"qoi","transparent":false,
+//              "clip1Offset":-1,"clip2Offset":0,          (image1/2 may be "a.y4m" or "a_####.png")
+//              "slideshow":"list.txt","storeBudgetMB":512,  (slideshow replaces image1/image2)
+//              "expression":"wipe.tfx",                     (script replaces transition)
+//              "unpremultiply":true,"supersample":1|2|4,"filter":"box"|"lanczos",
+//              "dither":true,"exposureMatch":false,"firstFrame":0,"lastFrame":60,
+//              "ioDepth":8,"directIo":false,"ioBackend":"auto"|"threads",
+//              "archive":"out/a1.tar","archiveIndex":true,           (archive replaces output)
+//              "mezzanine":"out/a1.tmz","mezzanineKeyInterval":30,   (mezzanine replaces output)
+//              "ring":"name","ringSlots":4,"ringEncoded":false}   (ring replaces output)
+//   Commands: {"cmd":"ping"}, {"cmd":"stats"}, {"cmd":"shutdown"}
+//   Events:   {"event":"accepted",...}, {"event":"progress","id":..,"frame":n,"total":m},
+//             {"event":"done","id":..,"frames":n,"ms":t}, {"event":"error","id":..,"message":..},
+//             {"event":"pong"}, {"event":"stats",...}
+// Connections are served one at a time; jobs run in order of arrival.
+
+// Serves until a shutdown command arrives. Returns the process exit code.
+int RunRenderService(const std::string& socketPath);
+
+// Stub client for local testing: submits one job (a JSON file, or inline JSON starting
+// with '{') and prints every event to stdout until the job is done or fails.
+int RunRenderClient(const std::string& socketPath, const std::string& job);
+
+#endif //RENDER_SERVICE_H
@@ -0,0 +1,82 @@
+#include "pch.h"
+#include "ring_consumer.h"
+#include "frame_ring.h"
+#include "frame_export.h"
+#include "json_lite.h"
+#include "qoi.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+    const int RING_WAIT_MS = 30000;
+
+    // FNV-1a over the payload; touching every byte is what a real consumer would pay too
+    std::uint64_t Checksum(const std::uint8_t* data, size_t size)
+    {
+        std::uint64_t h = 1469598103934665603ull;
+        for (size_t i = 0; i < size; ++i) {
+            h ^= data[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    std::string Hex(std::uint64_t value)
+    {
+        std::stringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << value;
+        return ss.str();
+    }
+}
+
+int RunRingConsumer(const std::string& name, const std::string& folder)
+{
+    FrameRingReader reader;
+    if (!reader.Open(name, RING_WAIT_MS)) {
+        std::cerr << "No frame ring named " << name << std::endl;
+        return 1;
+    }
+    if (!folder.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    long long frames = 0, bytes = 0;
+    RingFrame frame;
+    while (reader.NextFrame(frame, RING_WAIT_MS)) {
+        std::uint64_t sum = Checksum(frame.data, frame.size);
+
+        if (!folder.empty()) {
+            FrameFormat format = frame.format == RingFormat::Png ? FrameFormat::Png : FrameFormat::Qoi;
+            std::filesystem::path file = std::filesystem::path(folder) / FrameFileName(static_cast<int>(frame.sequence), format);
+            bool ok = frame.format == RingFormat::Rgba8
+                ? WriteFrameFile(file, EncodeQoi(frame.data, frame.width, frame.height))
+                : WriteFrameFile(file, std::vector<std::uint8_t>(frame.data, frame.data + frame.size));
+            if (!ok) std::cerr << "Cannot write " << file.string() << std::endl;
+        }
+
+        std::cout << JsonWriter().Add("event", "frame")
+            .Add("sequence", static_cast<long long>(frame.sequence))
+            .Add("format", static_cast<int>(frame.format))
+            .Add("width", frame.width).Add("height", frame.height)
+            .Add("size", static_cast<long long>(frame.size))
+            .Add("checksum", Hex(sum)).str() << std::endl;
+
+        frames++;
+        bytes += static_cast<long long>(frame.size);
+        reader.ReleaseFrame();
+    }
+
+    if (!reader.Finished()) {
+        std::cerr << "Timed out waiting for frames on ring " << name << std::endl;
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << JsonWriter().Add("event", "done").Add("frames", frames).Add("bytes", bytes)
+        .Add("ms", ms).Add("GBps", ms > 0 ? bytes / (ms * 1e6) : 0.0).str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef RING_CONSUMER_H
+#define RING_CONSUMER_H
+
+#include <string>
+
+// Reference consumer for the shared-memory frame ring (--ring-consume). Attaches to
+// ring 'name', reads every frame in place and prints one JSON line per frame with a
+// checksum of the payload, then the overall read throughput. With a 'folder' the
+// frames are also saved there (raw frames as QOI, encoded frames unchanged).
+// Returns the process exit code.
+int RunRingConsumer(const std::string& name, const std::string& folder);
+
+#endif //RING_CONSUMER_H
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "sequence_export.h"
+#include "transitions.h"
+#include "frame_sink.h"
+#include "clip_source.h"
+#include "perf_counters.h"
+#include <memory>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+int ExportSequence(PreparedInput& in1, PreparedInput& in2, const SequenceSettings& settings,
+    const fs::path& folder, const FrameCallback& onFrame, std::string* error)
+{
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+    };
+
+    if (!in1.IsReady() || !in2.IsReady()) { fail("both inputs must be loaded"); return 0; }
+
+    sf::RenderTexture renderTex;
+    if (!renderTex.resize({ CANVAS_WIDTH, CANVAS_HEIGHT })) { fail("cannot create render target"); return 0; }
+    SupersampleRenderer supersampler;
+    auto matched = std::make_unique<ExposureMatchState>();
+    auto scratch = std::make_unique<RenderScratch>();
+
+    ExportSettings output = settings.output;
+    output.transparent = premultipliedPipeline;
+
+    std::unique_ptr<FrameSink> sink;
+    std::string sinkError;
+    if (settings.onFrameHash) {
+        sink = std::make_unique<HashSink>(settings.onFrameHash);
+    }
+    else if (!settings.ring.empty()) {
+        auto ring = std::make_unique<RingSink>();
+        if (!ring->Open(settings.ring, settings.ringSlots, settings.ringEncoded, output,
+            { CANVAS_WIDTH, CANVAS_HEIGHT }, sinkError)) { fail(sinkError); return 0; }
+        sink = std::move(ring);
+    }
+    else if (!settings.archive.empty()) {
+        fs::path archive = settings.archive;
+        std::error_code ec;
+        if (archive.has_parent_path()) fs::create_directories(archive.parent_path(), ec);
+        auto tar = std::make_unique<TarSink>();
+        if (!tar->Open(archive, settings.archiveIndex, output, sinkError)) { fail(sinkError); return 0; }
+        sink = std::move(tar);
+    }
+    else if (!settings.mezzanine.empty()) {
+        fs::path file = settings.mezzanine;
+        std::error_code ec;
+        if (file.has_parent_path()) fs::create_directories(file.parent_path(), ec);
+        auto mezz = std::make_unique<MezzanineSink>();
+        if (!mezz->Open(file, settings.mezzanineKeyInterval, output, { CANVAS_WIDTH, CANVAS_HEIGHT }, sinkError)) {
+            fail(sinkError);
+            return 0;
+        }
+        sink = std::move(mezz);
+    }
+    else {
+        std::error_code ec;
+        fs::create_directories(folder, ec);
+        if (!fs::is_directory(folder)) { fail("cannot create output folder " + folder.string()); return 0; }
+        FrameWriterSettings writer = settings.writer;
+        // Registered buffers sized for a raw frame hold any PNG/QOI frame of the canvas
+        if (writer.bufferBytes == 0) writer.bufferBytes = static_cast<size_t>(CANVAS_WIDTH) * CANVAS_HEIGHT * 4;
+        sink = std::make_unique<FolderSink>(folder, output, writer);
+    }
+
+    int first = std::max(0, settings.firstFrame);
+    int last = settings.lastFrame < 0 ? settings.frames : std::min(settings.lastFrame, settings.frames);
+
+    // Progress is only reported for frames whose file is complete. The folder sink writes
+    // asynchronously, and a shard coordinator resumes a crashed worker after the last
+    // frame it reported.
+    int written = 0;
+    int reported = 0;
+    bool cancelled = false;
+    auto report = [&](int completed) {
+        for (; reported < completed; ++reported)
+            if (onFrame && !onFrame(first + reported, settings.frames)) return false;
+        return true;
+    };
+    for (int i = first; i <= last; i++)
+    {
+        float p = (float)i / (float)settings.frames;
+        // Clip inputs step to their next prefetched frame
+        if ((in1.clip && !in1.clip->Present(in1, sinkError)) || (in2.clip && !in2.clip->Present(in2, sinkError))) {
+            fail(sinkError);
+            break;
+        }
+        if (settings.exposureMatch) {
+            UpdateExposureMatchedInputs(*matched, in1, in2, p, UsesCpuImages(settings.transition));
+        }
+        auto drawFrame = [&](sf::RenderTarget& target) {
+            if (settings.exposureMatch)
+                RenderTransitionFrame(target, settings.transition, p, matched->sprite1, matched->sprite2,
+                    matched->texture1, matched->texture2, matched->image1, matched->image2, in2.luma, *scratch,
+                    settings.expression.get());
+            else
+                RenderTransitionFrame(target, settings.transition, p, in1.sprite, in2.sprite,
+                    in1.texture, in2.texture, in1.cache, in2.cache, in2.luma, *scratch,
+                    settings.expression.get());
+        };
+
+        sf::Image img;
+        bool rendered = true;
+        {
+            // Everything this thread does for the frame, including the kernels counted on
+            // their own and the wait for the GPU readback
+            KernelCounterScope counters("frame", static_cast<std::uint64_t>(CANVAS_WIDTH) * CANVAS_HEIGHT);
+            if (settings.supersample.factor > 1) {
+                rendered = supersampler.RenderFrame(drawFrame, { CANVAS_WIDTH, CANVAS_HEIGHT }, settings.supersample, img);
+            }
+            else {
+                drawFrame(renderTex);
+                renderTex.display();
+                img = renderTex.getTexture().copyToImage();
+            }
+        }
+        if (!rendered) {
+            fail("cannot create supersampling tile target");
+            break;
+        }
+
+        if (!sink->WriteFrame(settings.frameNumberOffset + i, img, sinkError)) {
+            fail(sinkError);
+            break;
+        }
+        written++;
+
+        if (!report(sink->CompletedFrames(written))) {
+            cancelled = true;
+            break;
+        }
+    }
+    if (!sink->Finish(sinkError)) fail(sinkError);
+    else if (!cancelled) report(written);
+    return written;
+}
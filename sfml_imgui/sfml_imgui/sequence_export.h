@@ -0,0 +1,51 @@
+#ifndef SEQUENCE_EXPORT_H
+#define SEQUENCE_EXPORT_H
+
+#include <filesystem>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "prepared_input.h"
+#include "frame_export.h"
+#include "supersample.h"
+#include "frame_writer.h"
+#include "mezzanine.h"
+#include "pixel_expr.h"
+
+struct SequenceSettings {
+    int transition = 0;
+    std::shared_ptr<const PixelProgram> expression;   // Script for EXPRESSION_TRANSITION
+    int frames = 60;                 // Frames 0..frames are written (frames + 1 files)
+    int firstFrame = 0;              // Sub-range actually rendered; sharded exports split 0..frames
+    int lastFrame = -1;              // -1: up to 'frames'
+    int frameNumberOffset = 0;       // Added to frame numbers on output (slideshow segments)
+    bool exposureMatch = false;
+    ExportSettings output;
+    SupersampleSettings supersample;
+    FrameWriterSettings writer;      // Asynchronous file writes for folder output
+    std::string archive;             // Stream all frames into this tar file instead of the folder
+    bool archiveIndex = true;        // Also write "<archive>.idx" with the offset of every frame
+    std::string mezzanine;           // Write all frames into this .tmz container instead of the folder
+    unsigned int mezzanineKeyInterval = MezzanineWriter::DEFAULT_KEY_INTERVAL;
+    std::string ring;                // Publish into this shared-memory frame ring instead of the folder
+    unsigned int ringSlots = 4;
+    bool ringEncoded = false;        // Ring carries PNG/QOI files instead of raw RGBA8
+    // When set, frames are only hashed (HashImage of the rendered pixels) and reported here;
+    // nothing is written. Used to compare renders across configurations.
+    std::function<void(int frame, std::uint64_t hash)> onFrameHash;
+};
+
+// Called after every written frame; returning false cancels the export
+using FrameCallback = std::function<bool(int frame, int total)>;
+
+// Renders the sequence (or its firstFrame..lastFrame range) into 'folder' (created if needed),
+// or into settings.archive / settings.mezzanine / settings.ring when set.
+// Shared by the GUI, the headless render service and shard workers. Every frame depends
+// only on the inputs and its index, so ranges rendered by different processes fit together.
+// Returns the number of frames written; 'error' is filled when the export stops early for
+// any reason other than cancellation.
+int ExportSequence(PreparedInput& in1, PreparedInput& in2, const SequenceSettings& settings,
+    const std::filesystem::path& folder, const FrameCallback& onFrame, std::string* error = nullptr);
+
+#endif //SEQUENCE_EXPORT_H
@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "shard_export.h"
+#include "child_process.h"
+#include "huge_pages.h"
+#include "numa.h"
+#include "render_job.h"
+#include "transitions.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Shard {
+        int index = 0;
+        int node = -1;             // NUMA node the worker process is bound to, -1 for none
+        int first = 0, last = 0;
+        int next = 0;              // First frame not yet confirmed by a worker
+        int restarts = 0;
+        bool finished = false;
+        std::string error;
+    };
+
+    // Serializes the merged event stream of all shard threads
+    struct ProgressMerger {
+        std::mutex mutex;
+        std::string id;
+        int total = 0;
+        int done = 0;
+
+        void Emit(const std::string& line)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cout << line << std::endl;
+        }
+
+        void FrameDone()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done++;
+            std::cout << JsonWriter().Add("event", "progress").Add("id", id)
+                .Add("frame", done).Add("total", total).str() << std::endl;
+        }
+    };
+
+    // Drives one shard to completion, restarting its worker from the first missing frame
+    void RunShard(const RenderJob& job, Shard& shard, const std::string& exe, ProgressMerger& merger)
+    {
+        fs::path jobFile = fs::path(job.output) / (".shard_" + std::to_string(shard.index) + ".json");
+
+        while (!shard.finished) {
+            RenderJob part = job;
+            part.id = job.id + "." + std::to_string(shard.index);
+            part.settings.firstFrame = shard.next;
+            part.settings.lastFrame = shard.last;
+            {
+                std::ofstream file(jobFile, std::ios::trunc);
+                file << RenderJobToJson(part) << '\n';
+                if (!file) { shard.error = "cannot write " + jobFile.string(); break; }
+            }
+
+            std::vector<std::string> args = { "--render", jobFile.string() };
+            if (shard.node >= 0) {
+                args.push_back("--numa-node");
+                args.push_back(std::to_string(shard.node));
+            }
+            ChildProcess worker;
+            if (!worker.Start(exe, args)) {
+                shard.error = "cannot start worker process";
+                break;
+            }
+
+            std::string line, workerError;
+            while (worker.ReadLine(line)) {
+                JsonObject event;
+                if (!ParseFlatJson(line, event)) continue;
+                std::string name = JsonGetString(event, "event");
+                if (name == "progress") {
+                    // Workers report frames in order once their file is written, so the frame
+                    // index is also the resume point
+                    int frame = static_cast<int>(JsonGetInt(event, "frame", -1));
+                    if (frame >= shard.next && frame <= shard.last) {
+                        shard.next = frame + 1;
+                        merger.FrameDone();
+                    }
+                }
+                else if (name == "error") {
+                    workerError = JsonGetString(event, "message");
+                }
+            }
+            int exitCode = worker.Wait();
+
+            if (exitCode == 0 && shard.next > shard.last) {
+                shard.finished = true;
+                break;
+            }
+            if (shard.restarts >= MAX_SHARD_RESTARTS) {
+                shard.error = "shard " + std::to_string(shard.index) + " failed: " +
+                    (workerError.empty() ? "exit code " + std::to_string(exitCode) : workerError);
+                break;
+            }
+            shard.restarts++;
+            merger.Emit(JsonWriter().Add("event", "restart").Add("id", job.id)
+                .Add("shard", shard.index).Add("from", shard.next).Add("exitCode", exitCode).str());
+        }
+
+        std::error_code ec;
+        fs::remove(jobFile, ec);
+    }
+}
+
+int RunRenderJob(const std::string& jobText, int numaNode)
+{
+    // Bind before anything is loaded so the inputs and frame buffers land on the node's memory
+    if (numaNode >= 0) BindProcessToNode(static_cast<unsigned int>(numaNode));
+
+    RenderJob job;
+    std::string error;
+    auto fail = [&](const std::string& message) {
+        std::cout << JsonWriter().Add("event", "error").Add("id", job.id).Add("message", message).str() << std::endl;
+        return 1;
+    };
+    if (!LoadRenderJob(jobText, job, error)) return fail(error);
+
+    InputCache cache;
+    auto start = std::chrono::steady_clock::now();
+    int written = ExecuteRenderJob(job, cache, [&](int frame, int total) {
+        std::cout << JsonWriter().Add("event", "progress").Add("id", job.id)
+            .Add("frame", frame).Add("total", total).str() << std::endl;
+        return true;
+    }, error);
+    if (!error.empty()) return fail(error);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // Read while the frame buffers are still mapped
+    HugePageStats hugePages = GetHugePageStats();
+    std::cout << JsonWriter().Add("event", "done").Add("id", job.id)
+        .Add("frames", written).Add("ms", ms)
+        .Add("hugePages", HugePageModeName(CurrentHugePageMode()))
+        .Add("hugePageBuffers", static_cast<long long>(hugePages.hugeAllocations))
+        .Add("hugePageFallbacks", static_cast<long long>(hugePages.fallbackAllocations))
+        .Add("hugePageBackedBytes", static_cast<long long>(hugePages.backedBytes)).str() << std::endl;
+    return 0;
+}
+
+int RunShardedExport(const std::string& jobText, int workers)
+{
+    RenderJob job;
+    std::string error;
+    if (!LoadRenderJob(jobText, job, error)) {
+        std::cerr << "Invalid job: " << error << std::endl;
+        return 1;
+    }
+    if (!job.settings.ring.empty() || !job.settings.archive.empty() || !job.settings.mezzanine.empty()) {
+        // The ring has exactly one producer; archives and mezzanine files are one sequential stream
+        std::cerr << "Invalid job: ring, archive and mezzanine output cannot be sharded" << std::endl;
+        return 1;
+    }
+    if (!job.slideshow.empty()) {
+        std::cerr << "Invalid job: slideshows cannot be sharded" << std::endl;
+        return 1;
+    }
+    std::string exe = CurrentExecutablePath();
+    if (exe.empty()) {
+        std::cerr << "Cannot locate this executable to start workers" << std::endl;
+        return 1;
+    }
+    std::error_code ec;
+    fs::create_directories(job.output, ec);
+
+    const SequenceSettings& s = job.settings;
+    int first = s.firstFrame;
+    int last = s.lastFrame < 0 ? s.frames : s.lastFrame;
+    int count = last - first + 1;
+    workers = std::clamp(workers, 1, count);
+
+    // Contiguous ranges keep each worker's exposure LUTs and scratch buffers warm.
+    // On a multi-node machine the shards are spread evenly over the nodes; every worker
+    // loads its own copy of the inputs, so each node reads from local memory only.
+    const std::vector<NumaNode>& nodes = NumaTopology();
+    std::vector<Shard> shards(static_cast<size_t>(workers));
+    for (int k = 0; k < workers; ++k) {
+        Shard& shard = shards[k];
+        shard.index = k;
+        if (nodes.size() > 1) shard.node = nodes[static_cast<size_t>(k) * nodes.size() / workers].id;
+        shard.first = first + count * k / workers;
+        shard.last = first + count * (k + 1) / workers - 1;
+        shard.next = shard.first;
+    }
+
+    ProgressMerger merger;
+    merger.id = job.id;
+    merger.total = count;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (Shard& shard : shards)
+        threads.emplace_back([&job, &shard, &exe, &merger] { RunShard(job, shard, exe, merger); });
+    for (std::thread& t : threads) t.join();
+
+    int restarts = 0;
+    for (const Shard& shard : shards) {
+        restarts += shard.restarts;
+        if (!shard.finished && error.empty()) error = shard.error;
+    }
+
+    // Merge results: every frame of the range has to be on disk, whichever worker wrote it
+    if (error.empty()) {
+        for (int i = first; i <= last; ++i) {
+            if (!fs::exists(fs::path(job.output) / FrameFileName(i, s.output.format))) {
+                error = "frame " + std::to_string(i) + " is missing";
+                break;
+            }
+        }
+    }
+    if (!error.empty()) {
+        merger.Emit(JsonWriter().Add("event", "error").Add("id", job.id).Add("message", error).str());
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    merger.Emit(JsonWriter().Add("event", "done").Add("id", job.id).Add("frames", count)
+        .Add("ms", ms).Add("workers", workers).Add("restarts", restarts).str());
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef SHARD_EXPORT_H
+#define SHARD_EXPORT_H
+
+#include <string>
+
+// --- SHARDED EXPORT ---
+// One process cannot saturate the memory bandwidth of a multi-socket machine, so a
+// coordinator splits the frame range of a job into contiguous shards and runs each in
+// a separate worker process (a copy of this executable started with --render).
+//
+// Workers print the same JSON event lines as the render service on stdout. The
+// coordinator merges them into one progress stream for the whole job and restarts a
+// shard that exits early from the first frame it has not confirmed yet.
+// Everything is local: the job goes to the workers as a file in the output folder.
+// On machines with several NUMA nodes the workers are spread over the nodes in blocks
+// (--numa-node), so every process renders from inputs in its own node's memory.
+
+// Retries per shard before the whole export is reported as failed
+const int MAX_SHARD_RESTARTS = 3;
+
+// Renders one job (JSON file or inline JSON) in this process, honouring its
+// firstFrame..lastFrame range. With 'numaNode' >= 0 the process is bound to that
+// node (OS node number) first. Returns the process exit code.
+int RunRenderJob(const std::string& job, int numaNode = -1);
+
+// Splits the job over 'workers' processes and waits for all of them.
+// Returns the process exit code.
+int RunShardedExport(const std::string& job, int workers);
+
+#endif //SHARD_EXPORT_H
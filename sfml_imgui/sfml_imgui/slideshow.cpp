@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "slideshow.h"
+#include <fstream>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::shared_ptr<PreparedInput> PrepareFromStore(ImageStore& store, int id)
+    {
+        std::shared_ptr<const DecodedImage> image = store.Get(id);
+        if (!image) return nullptr;
+        auto input = std::make_shared<PreparedInput>();
+        input->source = std::make_shared<const sf::Image>(image->size, image->pixels.data());
+        PrepareInput(*input);
+        return input->IsLoaded() ? input : nullptr;
+    }
+}
+
+bool ReadSlideshowList(const fs::path& list, std::vector<std::string>& images, std::string& error)
+{
+    std::ifstream file(list);
+    if (!file) {
+        error = "cannot read " + list.string();
+        return false;
+    }
+    fs::path base = list.parent_path();
+    std::string line;
+    while (std::getline(file, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.pop_back();
+        if (line.empty()) continue;
+        fs::path p = line;
+        images.push_back(p.is_relative() ? (base / p).string() : line);
+    }
+    if (images.size() < 2) {
+        error = "a slideshow needs at least two images";
+        return false;
+    }
+    return true;
+}
+
+int ExportSlideshow(const std::vector<std::string>& images, ImageStore& store, const SequenceSettings& settings,
+    const fs::path& folder, const FrameCallback& onFrame, std::string* error)
+{
+    std::string message;
+    std::vector<int> ids;
+    for (const std::string& path : images) {
+        int id = store.AddFile(path, &message);
+        if (id < 0) {
+            if (error) *error = message;
+            return 0;
+        }
+        ids.push_back(id);
+    }
+
+    int segments = static_cast<int>(ids.size()) - 1;
+    int total = segments * settings.frames;
+    int written = 0;
+    std::shared_ptr<PreparedInput> from = PrepareFromStore(store, ids[0]);
+    for (int k = 0; k < segments && from; ++k) {
+        std::shared_ptr<PreparedInput> to = PrepareFromStore(store, ids[k + 1]);
+        if (!to) break;
+
+        SequenceSettings segment = settings;
+        segment.frameNumberOffset = k * settings.frames;
+        segment.firstFrame = k == 0 ? 0 : 1;   // Frame 0 repeats the previous segment's last frame
+        segment.lastFrame = settings.frames;
+        int expected = segment.lastFrame - segment.firstFrame + 1;
+        bool cancelled = false;
+        int done = ExportSequence(*from, *to, segment, folder, [&](int frame, int) {
+            cancelled = onFrame && !onFrame(segment.frameNumberOffset + frame, total);
+            return !cancelled;
+        }, &message);
+        written += done;
+        if (done < expected) {
+            if (!cancelled && error) *error = message;
+            return written;
+        }
+        from = std::move(to);
+    }
+    if (written < total + 1 && error) *error = "cannot decompress slideshow image";
+    return written;
+}
@@ -0,0 +1,22 @@
+#ifndef SLIDESHOW_H
+#define SLIDESHOW_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "image_store.h"
+#include "sequence_export.h"
+
+// Reads a slideshow list: one image path per line (blank lines skipped); relative paths
+// are resolved against the folder of the list file
+bool ReadSlideshowList(const std::filesystem::path& list, std::vector<std::string>& images, std::string& error);
+
+// Renders the transition between every pair of consecutive images into 'folder' with
+// continuous frame numbers: image k to k+1 covers frames k*frames .. (k+1)*frames, the
+// shared end frames written once. All images are loaded into 'store' up front, so only
+// the store's decoded budget plus the two inputs being rendered are held uncompressed.
+// Returns the number of frames written, like ExportSequence.
+int ExportSlideshow(const std::vector<std::string>& images, ImageStore& store, const SequenceSettings& settings,
+    const std::filesystem::path& folder, const FrameCallback& onFrame, std::string* error = nullptr);
+
+#endif //SLIDESHOW_H
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "supersample.h"
+#include "parallel.h"
+#include "dither.h"
+#include "det_math.h"
+#include "perf_counters.h"
+#include <future>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    // Lanczos-3 reaches 3 output pixels on each side, so tiles are rendered with this apron
+    const unsigned int LANCZOS_APRON = 3;
+
+    float Lanczos3(float x)
+    {
+        if (x == 0.0f) return 1.0f;
+        if (x <= -3.0f || x >= 3.0f) return 0.0f;
+        const float pi = 3.14159265f;
+        float px = pi * x;
+        // Weights are shared by all frames, so they come from det_math.h regardless of the mode
+        return 3.0f * DetSin(px) * DetSin(px / 3.0f) / (px * px);
+    }
+
+    // With an integer factor every output pixel sits at the same phase, so one weight
+    // vector serves the whole tile. Taps are relative to the first source pixel of the output pixel.
+    void BuildLanczosWeights(int factor, std::vector<float>& weights, int& firstTap)
+    {
+        float center = (factor - 1) * 0.5f;
+        firstTap = static_cast<int>(std::floor(center - 3.0f * factor)) + 1;
+        int lastTap = static_cast<int>(std::ceil(center + 3.0f * factor)) - 1;
+        weights.clear();
+        float sum = 0.0f;
+        for (int d = firstTap; d <= lastTap; ++d) {
+            float w = Lanczos3((d - center) / factor);
+            weights.push_back(w);
+            sum += w;
+        }
+        for (float& w : weights) w /= sum;
+    }
+
+    void DownsampleBoxRows(const std::uint8_t* src, size_t srcStride, sf::Vector2u srcOrigin, int factor, bool dither,
+        std::uint8_t* dst, size_t dstStride, sf::Vector2u dstBegin, sf::Vector2u dstEnd,
+        unsigned int rowBegin, unsigned int rowEnd)
+    {
+        unsigned int outW = dstEnd.x - dstBegin.x;
+        unsigned int area = static_cast<unsigned int>(factor * factor);
+        std::vector<std::uint32_t> acc(static_cast<size_t>(outW) * 4);
+        std::vector<std::uint16_t> wide(dither ? acc.size() : 0);
+
+        for (unsigned int oy = rowBegin; oy < rowEnd; ++oy) {
+            std::fill(acc.begin(), acc.end(), 0u);
+            size_t sy0 = static_cast<size_t>(oy - srcOrigin.y) * factor;
+            size_t sx0 = static_cast<size_t>(dstBegin.x - srcOrigin.x) * factor;
+
+            // Plain accumulate loops over contiguous bytes; the compiler vectorizes these
+            for (int ky = 0; ky < factor; ++ky) {
+                const std::uint8_t* row = src + (sy0 + ky) * srcStride + sx0 * 4;
+                for (unsigned int ox = 0; ox < outW; ++ox) {
+                    const std::uint8_t* p = row + static_cast<size_t>(ox) * factor * 4;
+                    std::uint32_t* a = &acc[static_cast<size_t>(ox) * 4];
+                    for (int kx = 0; kx < factor; ++kx) {
+                        a[0] += p[kx * 4]; a[1] += p[kx * 4 + 1]; a[2] += p[kx * 4 + 2]; a[3] += p[kx * 4 + 3];
+                    }
+                }
+            }
+
+            std::uint8_t* out = dst + static_cast<size_t>(oy) * dstStride + static_cast<size_t>(dstBegin.x) * 4;
+            if (dither) {
+                // Averages of 4 or 16 samples carry 2-4 extra bits; keep them as 8.8 fixed point
+                for (size_t i = 0; i < acc.size(); ++i)
+                    wide[i] = static_cast<std::uint16_t>((acc[i] * 256 + area / 2) / area);
+                QuantizeRowDithered(wide.data(), out, outW, dstBegin.x, oy);
+            }
+            else {
+                for (size_t i = 0; i < acc.size(); ++i)
+                    out[i] = static_cast<std::uint8_t>((acc[i] + area / 2) / area);
+            }
+        }
+    }
+
+    void DownsampleLanczosRows(const std::uint8_t* src, size_t srcStride, unsigned int srcW, unsigned int srcH,
+        sf::Vector2u srcOrigin, int factor, bool dither, std::uint8_t* dst, size_t dstStride,
+        sf::Vector2u dstBegin, sf::Vector2u dstEnd, unsigned int rowBegin, unsigned int rowEnd)
+    {
+        std::vector<float> weights;
+        int firstTap = 0;
+        BuildLanczosWeights(factor, weights, firstTap);
+        int taps = static_cast<int>(weights.size());
+
+        unsigned int outW = dstEnd.x - dstBegin.x;
+        std::vector<float> horiz(static_cast<size_t>(outW) * 4 * taps);
+        std::vector<float> sum(static_cast<size_t>(outW) * 4);
+
+        for (unsigned int oy = rowBegin; oy < rowEnd; ++oy) {
+            int sy0 = static_cast<int>(oy - srcOrigin.y) * factor + firstTap;
+
+            // Horizontal pass for every source row the vertical kernel touches
+            for (int t = 0; t < taps; ++t) {
+                int sy = std::clamp(sy0 + t, 0, static_cast<int>(srcH) - 1);
+                const std::uint8_t* row = src + static_cast<size_t>(sy) * srcStride;
+                float* h = &horiz[static_cast<size_t>(t) * outW * 4];
+                for (unsigned int ox = 0; ox < outW; ++ox) {
+                    int sx0 = static_cast<int>(dstBegin.x + ox - srcOrigin.x) * factor + firstTap;
+                    float r = 0, g = 0, b = 0, a = 0;
+                    for (int k = 0; k < taps; ++k) {
+                        int sx = std::clamp(sx0 + k, 0, static_cast<int>(srcW) - 1);
+                        const std::uint8_t* p = row + static_cast<size_t>(sx) * 4;
+                        float w = weights[k];
+                        r += p[0] * w; g += p[1] * w; b += p[2] * w; a += p[3] * w;
+                    }
+                    h[ox * 4] = r; h[ox * 4 + 1] = g; h[ox * 4 + 2] = b; h[ox * 4 + 3] = a;
+                }
+            }
+
+            // Vertical pass
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            for (int t = 0; t < taps; ++t) {
+                const float* h = &horiz[static_cast<size_t>(t) * outW * 4];
+                float w = weights[t];
+                for (size_t i = 0; i < sum.size(); ++i) sum[i] += h[i] * w;
+            }
+
+            // Lanczos rings, so values are clamped back into range
+            std::uint8_t* out = dst + static_cast<size_t>(oy) * dstStride + static_cast<size_t>(dstBegin.x) * 4;
+            if (dither) {
+                QuantizeRowDithered(sum.data(), out, outW, dstBegin.x, oy);
+            }
+            else {
+                for (size_t i = 0; i < sum.size(); ++i)
+                    out[i] = static_cast<std::uint8_t>(std::clamp(sum[i] + 0.5f, 0.0f, 255.0f));
+            }
+        }
+    }
+}
+
+void DownsampleTile(const std::uint8_t* src, size_t srcStride, unsigned int srcW, unsigned int srcH,
+    sf::Vector2u srcOrigin, int factor, DownsampleFilter filter, bool dither,
+    std::uint8_t* dst, size_t dstStride, sf::Vector2u dstBegin, sf::Vector2u dstEnd)
+{
+    if (dstEnd.x <= dstBegin.x || dstEnd.y <= dstBegin.y) return;
+
+    ParallelFor(dstEnd.y - dstBegin.y, [&](unsigned int begin, unsigned int end) {
+        KernelCounterScope counters(filter == DownsampleFilter::Lanczos3 ? "supersample-lanczos" : "supersample-box",
+            static_cast<std::uint64_t>(end - begin) * (dstEnd.x - dstBegin.x));
+        if (filter == DownsampleFilter::Lanczos3)
+            DownsampleLanczosRows(src, srcStride, srcW, srcH, srcOrigin, factor, dither, dst, dstStride,
+                dstBegin, dstEnd, dstBegin.y + begin, dstBegin.y + end);
+        else
+            DownsampleBoxRows(src, srcStride, srcOrigin, factor, dither, dst, dstStride,
+                dstBegin, dstEnd, dstBegin.y + begin, dstBegin.y + end);
+    }, 8);
+}
+
+bool SupersampleRenderer::RenderFrame(const std::function<void(sf::RenderTarget&)>& draw, sf::Vector2u canvasSize,
+    const SupersampleSettings& settings, sf::Image& out)
+{
+    int factor = std::max(1, settings.factor);
+    unsigned int apron = (settings.filter == DownsampleFilter::Lanczos3) ? LANCZOS_APRON : 0;
+
+    // Output pixels covered by one tile, excluding the apron on both sides
+    unsigned int tileOut = MAX_TILE_SIZE / factor - 2 * apron;
+    unsigned int targetSize = (tileOut + 2 * apron) * factor;
+    if (tileTarget.getSize() != sf::Vector2u(targetSize, targetSize)) {
+        if (!tileTarget.resize({ targetSize, targetSize })) return false;
+    }
+
+    framePixels.assign(static_cast<size_t>(canvasSize.x) * canvasSize.y * 4, 0);
+    size_t dstStride = static_cast<size_t>(canvasSize.x) * 4;
+
+    std::future<void> pending;
+    for (unsigned int oy0 = 0; oy0 < canvasSize.y; oy0 += tileOut) {
+        for (unsigned int ox0 = 0; ox0 < canvasSize.x; ox0 += tileOut) {
+            sf::Vector2u dstBegin(ox0, oy0);
+            sf::Vector2u dstEnd(std::min(canvasSize.x, ox0 + tileOut), std::min(canvasSize.y, oy0 + tileOut));
+
+            // Rendered region = tile + apron, clamped to the canvas
+            sf::Vector2u rBegin(ox0 > apron ? ox0 - apron : 0, oy0 > apron ? oy0 - apron : 0);
+            sf::Vector2u rEnd(std::min(canvasSize.x, dstEnd.x + apron), std::min(canvasSize.y, dstEnd.y + apron));
+            sf::Vector2f rSize(static_cast<float>(rEnd.x - rBegin.x), static_cast<float>(rEnd.y - rBegin.y));
+
+            sf::View view(sf::FloatRect({ static_cast<float>(rBegin.x), static_cast<float>(rBegin.y) }, rSize));
+            view.setViewport(sf::FloatRect({ 0.f, 0.f },
+                { rSize.x * factor / targetSize, rSize.y * factor / targetSize }));
+            tileTarget.setView(view);
+            draw(tileTarget);
+            tileTarget.display();
+
+            auto tile = std::make_shared<sf::Image>(tileTarget.getTexture().copyToImage());
+
+            // Filter this tile on the workers while the GPU renders the next one
+            if (pending.valid()) pending.get();
+            unsigned int srcW = static_cast<unsigned int>(rSize.x) * factor;
+            unsigned int srcH = static_cast<unsigned int>(rSize.y) * factor;
+            pending = std::async(std::launch::async, [this, tile, srcW, srcH, rBegin, factor, settings, dstStride, dstBegin, dstEnd] {
+                DownsampleTile(tile->getPixelsPtr(), static_cast<size_t>(tile->getSize().x) * 4, srcW, srcH,
+                    rBegin, factor, settings.filter, settings.dither, framePixels.data(), dstStride, dstBegin, dstEnd);
+            });
+        }
+    }
+    if (pending.valid()) pending.get();
+
+    tileTarget.setView(tileTarget.getDefaultView());
+    out.resize(canvasSize, framePixels.data());
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef SUPERSAMPLE_H
+#define SUPERSAMPLE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include "pixel_buffer.h"
+
+enum class DownsampleFilter { Box = 0, Lanczos3 = 1 };
+
+struct SupersampleSettings {
+    int factor = 1;                              // 1 (off), 2 or 4
+    DownsampleFilter filter = DownsampleFilter::Box;
+    bool dither = true;                          // Blue-noise dither the filtered result down to 8 bits
+};
+
+// Filters a supersampled RGBA8 tile down by an integer factor.
+// 'src' holds the tile (srcW x srcH pixels, srcStride bytes per row); its top-left corner
+// lies at output pixel 'srcOrigin'. Output pixels [dstBegin, dstEnd) are written into 'dst'
+// (full frame, dstStride bytes per row). Rows are processed on all hardware threads.
+// The filter accumulates in high precision; with 'dither' the final conversion to 8 bits
+// goes through the blue-noise quantizer instead of plain rounding.
+void DownsampleTile(const std::uint8_t* src, size_t srcStride, unsigned int srcW, unsigned int srcH,
+    sf::Vector2u srcOrigin, int factor, DownsampleFilter filter, bool dither,
+    std::uint8_t* dst, size_t dstStride, sf::Vector2u dstBegin, sf::Vector2u dstEnd);
+
+// Renders frames at factor x resolution in tiles and filters them down to canvas size.
+// Memory stays bounded by the tile size no matter how large the factor is: only one
+// tile is being rendered while the previous one is filtered on the worker threads.
+class SupersampleRenderer {
+public:
+    // Largest edge of the offscreen tile in supersampled pixels
+    static constexpr unsigned int MAX_TILE_SIZE = 2048;
+
+    // 'draw' renders the whole frame in canvas coordinates; it is called once per tile.
+    bool RenderFrame(const std::function<void(sf::RenderTarget&)>& draw, sf::Vector2u canvasSize,
+        const SupersampleSettings& settings, sf::Image& out);
+
+private:
+    sf::RenderTexture tileTarget;
+    PixelBuffer framePixels;
+};
+
+#endif //SUPERSAMPLE_H
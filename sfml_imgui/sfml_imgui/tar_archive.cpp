@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "tar_archive.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+    const size_t TAR_BLOCK = 512;
+
+    // Octal number, zero padded to width - 1 digits and NUL terminated
+    void WriteOctal(char* field, size_t width, std::uint64_t value)
+    {
+        std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1), static_cast<unsigned long long>(value));
+    }
+}
+
+bool TarWriter::Open(const std::filesystem::path& path)
+{
+    entries.clear();
+    position = 0;
+    // Large stream buffer: frames arrive in MB-sized pieces
+    streamBuffer.resize(1 << 20);
+    file.rdbuf()->pubsetbuf(streamBuffer.data(), static_cast<std::streamsize>(streamBuffer.size()));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    return file.is_open();
+}
+
+bool TarWriter::Add(const std::string& name, const std::uint8_t* data, size_t size)
+{
+    if (!file || name.empty() || name.size() > 100) return false;
+
+    char header[TAR_BLOCK] = {};
+    std::memcpy(header, name.data(), name.size());
+    WriteOctal(header + 100, 8, 0644);                  // mode
+    WriteOctal(header + 108, 8, 0);                     // uid
+    WriteOctal(header + 116, 8, 0);                     // gid
+    WriteOctal(header + 124, 12, size);
+    WriteOctal(header + 136, 12, static_cast<std::uint64_t>(std::time(nullptr)));
+    header[156] = '0';                                  // regular file
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    // Checksum is computed with its own field filled with spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned int sum = 0;
+    for (unsigned char c : header) sum += c;
+    std::snprintf(header + 148, 8, "%06o", sum);
+    header[155] = ' ';
+
+    file.write(header, TAR_BLOCK);
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    size_t padding = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+    static const char zeros[TAR_BLOCK] = {};
+    file.write(zeros, static_cast<std::streamsize>(padding));
+
+    entries.push_back({ name, position + TAR_BLOCK, size });
+    position += TAR_BLOCK + size + padding;
+    return static_cast<bool>(file);
+}
+
+bool TarWriter::Close()
+{
+    if (!file.is_open()) return false;
+    static const char zeros[TAR_BLOCK * 2] = {};
+    file.write(zeros, sizeof(zeros));
+    file.close();
+    return !file.fail();
+}
+
+bool WriteTarIndex(const std::filesystem::path& path, const std::vector<TarWriter::Entry>& entries)
+{
+    std::ofstream index(path, std::ios::trunc);
+    if (!index) return false;
+    index << "# name\toffset\tsize\n";
+    for (const TarWriter::Entry& e : entries)
+        index << e.name << '\t' << e.offset << '\t' << e.size << '\n';
+    return static_cast<bool>(index);
+}
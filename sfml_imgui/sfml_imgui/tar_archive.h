@@ -0,0 +1,40 @@
+#ifndef TAR_ARCHIVE_H
+#define TAR_ARCHIVE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Streams regular files into a POSIX ustar archive. Everything is written strictly
+// sequentially (header, data, padding to 512 bytes), so the archive can go to a
+// network share or a pipe-like file system with one open and one close.
+class TarWriter {
+public:
+    struct Entry {
+        std::string name;
+        std::uint64_t offset = 0;   // Start of the file data inside the archive
+        std::uint64_t size = 0;
+    };
+
+    bool Open(const std::filesystem::path& path);
+    // Appends one file. 'name' must fit the ustar name field (100 bytes).
+    bool Add(const std::string& name, const std::uint8_t* data, size_t size);
+    // Writes the two zero blocks that end an archive
+    bool Close();
+
+    const std::vector<Entry>& Entries() const { return entries; }
+
+private:
+    std::ofstream file;
+    std::vector<char> streamBuffer;
+    std::uint64_t position = 0;
+    std::vector<Entry> entries;
+};
+
+// Index sidecar: one "name<TAB>offset<TAB>size" line per file, so a reader can seek
+// straight to any frame without walking the archive headers
+bool WriteTarIndex(const std::filesystem::path& path, const std::vector<TarWriter::Entry>& entries);
+
+#endif //TAR_ARCHIVE_H
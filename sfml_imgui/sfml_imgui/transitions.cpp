@@ -0,0 +1,597 @@
+#include "pch.h"
+#include "transitions.h"
+#include "cpu_kernels.h"
+#include "dither.h"
+#include "pixel_expr.h"
+#include "det_math.h"
+#include "perf_counters.h"
+#include <cstdint>    // Required for std::uint8_t
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <tuple>
+#include <algorithm>  // Required for std::min, std::max
+
+// --- GLOBAL RENDER STATE ---
+thread_local bool premultipliedPipeline = false;
+thread_local bool blueNoiseDither = true;
+thread_local bool deterministicRendering = false;
+
+const char* const TRANSITION_NAMES[TRANSITION_COUNT] = {
+    "Slide Left", "Slide Right", "Slide Top", "Slide Bottom",
+    "Box In", "Box Out", "Fade to Black", "Cross-Fade",
+    "Page Turn Horizontal", "Page Turn Vertical", "Shutter Open",
+    "Blur Fade", "3D Cube Rotation", "Ring", "Luma Wipe", "Fly Away",
+    "Custom Expression"
+};
+
+// --- ALPHA PIPELINE HELPERS ---
+sf::Color ClearColor()
+{
+    return premultipliedPipeline ? sf::Color::Transparent : sf::Color::Black;
+}
+
+// Sprite tint for fading. Premultiplied textures must be scaled on all four channels.
+sf::Color FadeColor(std::uint8_t alpha)
+{
+    if (premultipliedPipeline) return { alpha, alpha, alpha, alpha };
+    return { 255, 255, 255, alpha };
+}
+
+sf::RenderStates InputStates(const sf::Texture* texture)
+{
+    sf::RenderStates states;
+    states.texture = texture;
+    if (premultipliedPipeline)
+        states.blendMode = sf::BlendMode(sf::BlendMode::Factor::One, sf::BlendMode::Factor::OneMinusSrcAlpha);
+    return states;
+}
+
+sf::Image ResizeImageCPU(const sf::Image& original, unsigned int targetW, unsigned int targetH) {
+    sf::Vector2u origSize = original.getSize();
+    if (targetW == 0 || targetH == 0 || origSize.x == 0 || origSize.y == 0)
+        return sf::Image(sf::Vector2u{ targetW, targetH }, sf::Color::Transparent);
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(targetW) * targetH * 4);
+    KernelCounterScope counters("resize", static_cast<std::uint64_t>(targetW) * targetH);
+    CpuKernels().resize[static_cast<int>(PixelLayout::Rgba8)](original.getPixelsPtr(), origSize.x, origSize.y,
+        pixels.data(), targetW, targetH);
+    return sf::Image(sf::Vector2u{ targetW, targetH }, pixels.data());
+}
+
+namespace {
+    // Nearest-neighbour resize of a one-byte plane, same sampling as ResizeImageCPU
+    void ResizePlaneCPU(const std::vector<uint8_t>& src, sf::Vector2u srcSize, sf::Vector2u dstSize, std::vector<uint8_t>& dst)
+    {
+        dst.resize(static_cast<size_t>(dstSize.x) * dstSize.y);
+        KernelCounterScope counters("resize-plane", dst.size());
+        CpuKernels().resize[static_cast<int>(PixelLayout::Luma8)](src.data(), srcSize.x, srcSize.y,
+            dst.data(), dstSize.x, dstSize.y);
+    }
+}
+
+std::vector<uint8_t> ComputeLumaPlane(const sf::Image& image)
+{
+    sf::Vector2u size = image.getSize();
+    size_t totalPixels = static_cast<size_t>(size.x) * size.y;
+    std::vector<uint8_t> luma(totalPixels);
+    if (totalPixels > 0) {
+        KernelCounterScope counters("luma", totalPixels);
+        CpuKernels().luma(image.getPixelsPtr(), luma.data(), totalPixels);
+    }
+    return luma;
+}
+
+// --- OPTIMIZED CPU LUMA WIPE (Multithreaded) ---
+int LumaWipeThreshold(float progress)
+{
+    return static_cast<int>((1.0f - (progress * 1.1f)) * 255.0f);
+}
+
+void ApplyCpuLumaWipeOptimized(const sf::Image& imgA, const sf::Image& imgB, const std::vector<uint8_t>& lumaB,
+    sf::Texture& dstTex, float progress, RenderScratch& scratch)
+{
+    sf::Vector2u size = imgA.getSize();
+    size_t totalPixels = static_cast<size_t>(size.x) * size.y;
+
+    if (totalPixels == 0 || lumaB.size() != totalPixels) return;
+
+    PixelBuffer& resultPixels = scratch.wipePixels;
+    if (resultPixels.size() != totalPixels * 4) resultPixels.resize(totalPixels * 4);
+
+    const uint8_t* pA = imgA.getPixelsPtr();
+    const uint8_t* pB = imgB.getPixelsPtr();
+
+    int threshold = LumaWipeThreshold(progress);
+
+    // Whole RGBA pixel is taken from the winning input so transparency survives the wipe
+    {
+        KernelCounterScope counters("luma-select", totalPixels);
+        CpuKernels().select[static_cast<int>(PixelLayout::Rgba8)](pA, pB, lumaB.data(), resultPixels.data(),
+            totalPixels, threshold);
+    }
+
+    if (dstTex.getSize() != size) {
+        dstTex.resize(size);
+    }
+    dstTex.update(resultPixels.data());
+}
+
+// OPTIMIZED CPU BLUR 
+void ApplyCpuBlurOptimized(const sf::Image& src, sf::Texture& dstTex, int radius, RenderScratch& scratch)
+{
+    // If radius is 0, we just show the original image
+    if (radius < 1) {
+        // Ensure texture size matches the original image before updating
+        if (dstTex.getSize() != src.getSize()) {
+            dstTex.resize(src.getSize());
+        }
+        dstTex.update(src);
+        return;
+    }
+
+    sf::Vector2u orgSize = src.getSize();
+    const int SCALE = 4;
+    sf::Vector2u smallSize(orgSize.x / SCALE, orgSize.y / SCALE);
+
+    // Safety check: avoid processing if image is too small
+    if (smallSize.x < 1 || smallSize.y < 1) return;
+
+    // 1. Downsample logic
+    PixelBuffer& smallPixels = scratch.smallPixels;
+    if (smallPixels.size() != smallSize.x * smallSize.y * 4)
+        smallPixels.resize(smallSize.x * smallSize.y * 4);
+
+    const uint8_t* srcPixels = src.getPixelsPtr();
+
+    {
+        KernelCounterScope counters("downsample", static_cast<std::uint64_t>(smallSize.x) * smallSize.y);
+        for (unsigned int y = 0; y < smallSize.y; ++y) {
+            for (unsigned int x = 0; x < smallSize.x; ++x) {
+                int srcIdx = ((y * SCALE) * orgSize.x + (x * SCALE)) * 4;
+                int dstIdx = (y * smallSize.x + x) * 4;
+                std::memcpy(&smallPixels[dstIdx], &srcPixels[srcIdx], 4);
+            }
+        }
+    }
+
+    // 2. Separable Blur on small buffer
+    int smallRadius = std::max(1, radius / SCALE);
+    PixelBuffer& tempBuffer = scratch.blurPixels;
+    if (tempBuffer.size() != smallPixels.size()) tempBuffer.resize(smallPixels.size());
+
+    int w = smallSize.x;
+    int h = smallSize.y;
+
+    // Both passes come from the specialized kernel table (cpu_kernels.h): the radius is a
+    // compile-time constant for the small radii this transition uses, and the dither choice
+    // is made here once instead of in every pixel
+    const CpuKernelTable& kernels = CpuKernels();
+    const int layout = static_cast<int>(PixelLayout::Rgba8);
+    const int slot = BlurRadiusSlot(smallRadius);
+
+    // Horizontal Pass
+    {
+        KernelCounterScope counters("blur-rows", static_cast<std::uint64_t>(w) * h);
+        kernels.blurRows[layout][slot](smallPixels.data(), tempBuffer.data(), w, h, smallRadius);
+    }
+
+    // Vertical Pass
+    // With dithering the averages are kept as 8.8 fixed point and quantized per row, so
+    // smooth gradients in the blurred image don't collapse into visible bands
+    std::vector<uint16_t>& wideRow = scratch.wideRow;
+    if (wideRow.size() != static_cast<size_t>(w) * 4) wideRow.resize(static_cast<size_t>(w) * 4);
+
+    BlurOutput output = blueNoiseDither ? BlurOutput::Wide : BlurOutput::Truncate;
+    {
+        KernelCounterScope counters("blur-columns", static_cast<std::uint64_t>(w) * h);
+        kernels.blurColumns[layout][static_cast<int>(output)][slot](tempBuffer.data(), smallPixels.data(), wideRow.data(),
+            w, h, smallRadius, [](const uint16_t* wide, uint8_t* dst, int pixels, int y) {
+                QuantizeRowDithered(wide, dst, static_cast<unsigned int>(pixels), 0, static_cast<unsigned int>(y));
+            });
+    }
+
+    // 3. Update Texture: ensure it matches the SMALL size
+    if (dstTex.getSize() != smallSize) {
+        dstTex.resize(smallSize);
+    }
+    dstTex.update(smallPixels.data());
+}
+
+bool UsesCpuImages(int type)
+{
+    return type == 11 || type == 14 || type == EXPRESSION_TRANSITION;
+}
+
+// --- CORE RENDERING LOGIC ---
+void RenderTransitionFrame(sf::RenderTarget& target, int type, float progress,
+    sf::Sprite& s1, sf::Sprite& s2, sf::Texture& t1, sf::Texture& t2,
+    const sf::Image& imgCache1, const sf::Image& imgCache2,
+    const std::vector<uint8_t>& luma2, RenderScratch& scratch, const PixelProgram* expression)
+{
+    target.clear(ClearColor());
+    const sf::RenderStates states = InputStates();
+
+    float width = (float)CANVAS_WIDTH;
+    float height = (float)CANVAS_HEIGHT;
+
+    // Reset state. Only the cube filters its textures; setting the flag every frame keeps
+    // a previous cube frame from leaking smoothing into the next transition.
+    t1.setSmooth(type == 12);
+    t2.setSmooth(type == 12);
+    if (t1.getSize().x > 0) {
+        s1.setColor(sf::Color::White);
+        s1.setOrigin({ 0.f, 0.f });
+        s1.setPosition({ 0.f, 0.f });
+        s1.setRotation(sf::degrees(0.f));
+        sf::Vector2u sz1 = t1.getSize();
+        s1.setScale({ width / sz1.x, height / sz1.y });
+    }
+    if (t2.getSize().x > 0) {
+        s2.setColor(sf::Color::White);
+        s2.setOrigin({ 0.f, 0.f });
+        s2.setPosition({ 0.f, 0.f });
+        s2.setRotation(sf::degrees(0.f));
+        sf::Vector2u sz2 = t2.getSize();
+        s2.setScale({ width / sz2.x, height / sz2.y });
+    }
+
+    if (t1.getSize().x == 0 || t2.getSize().x == 0) {
+        if (t1.getSize().x > 0) target.draw(s1, states);
+        if (t2.getSize().x > 0) target.draw(s2, states);
+        return;
+    }
+
+    int drawMode = 0; 
+    float xOffset = 0.0f, yOffset = 0.0f;
+
+    switch (type) {
+    case 0: // Slide Left
+        xOffset = -width * (1.0f - progress);
+        s2.setPosition({ xOffset, yOffset });
+        break;
+    case 1: // Slide Right
+        xOffset = width * (1.0f - progress);
+        s2.setPosition({ xOffset, yOffset });
+        break;
+    case 2: // Slide Top
+        yOffset = -height * (1.0f - progress);
+        s2.setPosition({ xOffset, yOffset });
+        break;
+    case 3: // Slide Bottom
+        yOffset = height * (1.0f - progress);
+        s2.setPosition({ xOffset, yOffset });
+        break;
+    case 4: // Box In
+    {
+        sf::Vector2u sz2 = t2.getSize();
+        s2.setOrigin({ (float)sz2.x / 2.f, (float)sz2.y / 2.f });
+        s2.setPosition({ width / 2.f, height / 2.f });
+        float tX = width / sz2.x;
+        float tY = height / sz2.y;
+        s2.setScale({ tX * progress, tY * progress });
+    }
+    break;
+    case 5: // Box Out
+    {
+        sf::Vector2u sz1 = t1.getSize();
+        s1.setOrigin({ (float)sz1.x / 2.f, (float)sz1.y / 2.f });
+        s1.setPosition({ width / 2.f, height / 2.f });
+        float tX = width / sz1.x;
+        float tY = height / sz1.y;
+        float sf = 1.0f - progress;
+        s1.setScale({ tX * sf, tY * sf });
+    }
+    break;
+    case 6: // Fade to Black
+        if (progress <= 0.5f) {
+            float lp = progress * 2.0f;
+            s1.setColor(FadeColor((std::uint8_t)(255 * (1.0f - lp))));
+            s2.setColor(FadeColor(0));
+        }
+        else {
+            float lp = (progress - 0.5f) * 2.0f;
+            s1.setColor(FadeColor(0));
+            s2.setColor(FadeColor((std::uint8_t)(255 * lp)));
+        }
+        break;
+    case 7: // Cross-Fade
+        s2.setColor(FadeColor((std::uint8_t)(255 * progress)));
+        s2.setPosition({ 0.f, 0.f });
+        break;
+    case 8: // Page Turn H
+    {
+        sf::Vector2u sz1 = t1.getSize(); sf::Vector2u sz2 = t2.getSize();
+        s1.setOrigin({ (float)sz1.x / 2.f, (float)sz1.y / 2.f });
+        s2.setOrigin({ (float)sz2.x / 2.f, (float)sz2.y / 2.f });
+        s1.setPosition({ width / 2.f, height / 2.f });
+        s2.setPosition({ width / 2.f, height / 2.f });
+        if (progress <= 0.5f) {
+            drawMode = 1;
+            float sf = 1.0f - (progress * 2.0f);
+            s1.setScale({ (width / sz1.x) * sf, height / sz1.y });
+        } else {
+            drawMode = 2;
+            float sf = (progress - 0.5f) * 2.0f;
+            s2.setScale({ (width / sz2.x) * sf, height / sz2.y });
+        }
+    }
+    break;
+    case 9: // Page Turn V
+    {
+        sf::Vector2u sz1 = t1.getSize(); sf::Vector2u sz2 = t2.getSize();
+        s1.setOrigin({ (float)sz1.x / 2.f, (float)sz1.y / 2.f });
+        s2.setOrigin({ (float)sz2.x / 2.f, (float)sz2.y / 2.f });
+        s1.setPosition({ width / 2.f, height / 2.f });
+        s2.setPosition({ width / 2.f, height / 2.f });
+        if (progress <= 0.5f) {
+            drawMode = 1;
+            float sf = 1.0f - (progress * 2.0f);
+            s1.setScale({ width / sz1.x, (height / sz1.y) * sf });
+        } else {
+            drawMode = 2;
+            float sf = (progress - 0.5f) * 2.0f;
+            s2.setScale({ width / sz2.x, (height / sz2.y) * sf });
+        }
+    }
+    break;
+    case 10: // Shutter Open
+    {
+        sf::Vector2u sz1 = t1.getSize();
+        s1.setOrigin({ (float)sz1.x, (float)sz1.y / 2.f });
+        s1.setPosition({ width, height / 2.f });
+        s1.setScale({ (width / sz1.x) * (1.0f - progress), height / sz1.y });
+        float ex = -width * (1.0f - progress);
+        s2.setPosition({ ex, 0.0f });
+    }
+    break;
+    case 11: // Blur Fade transition
+    {
+        sf::Texture& tempTex1 = scratch.blurTex1;
+        sf::Texture& tempTex2 = scratch.blurTex2;
+
+        int maxBlur = 12; // Maximum blur radius
+        int currentBlur = 0;
+
+        // Phase 1: Blur the first image (0% to 45% of progress)
+        if (progress <= 0.45f) {
+            // Calculate growing blur radius
+            currentBlur = (int)(progress * (1.0f / 0.45f) * maxBlur);
+
+            ApplyCpuBlurOptimized(imgCache1, tempTex1, currentBlur, scratch);
+
+            sf::Sprite tempSprite(tempTex1);
+            // Dynamically calculate scale because tempTex1 is now 4x smaller than original
+            sf::Vector2u sz = tempTex1.getSize();
+            tempSprite.setScale({ 1200.0f / (float)sz.x, 800.0f / (float)sz.y });
+
+            target.draw(tempSprite, states);
+        }
+        // Phase 3: Un-blur the second image (55% to 100% of progress)
+        else if (progress >= 0.55f) {
+            // Calculate decreasing blur radius
+            float localP = (progress - 0.55f) / 0.45f;
+            currentBlur = (int)((1.0f - localP) * maxBlur);
+
+            ApplyCpuBlurOptimized(imgCache2, tempTex2, currentBlur, scratch);
+
+            sf::Sprite tempSprite(tempTex2);
+            // Adjust scale to fit the 1200x800 window regardless of downsampling
+            sf::Vector2u sz = tempTex2.getSize();
+            tempSprite.setScale({ 1200.0f / (float)sz.x, 800.0f / (float)sz.y });
+
+            target.draw(tempSprite, states);
+        }
+        // Phase 2: Cross-fade between two blurred images (45% to 55% of progress)
+        else {
+            // Both images are blurred at maximum radius
+            ApplyCpuBlurOptimized(imgCache1, tempTex1, maxBlur, scratch);
+            ApplyCpuBlurOptimized(imgCache2, tempTex2, maxBlur, scratch);
+
+            sf::Sprite sA(tempTex1);
+            sf::Sprite sB(tempTex2);
+
+            // Apply scales for both sprites
+            sA.setScale({ 1200.0f / (float)tempTex1.getSize().x, 800.0f / (float)tempTex1.getSize().y });
+            sB.setScale({ 1200.0f / (float)tempTex2.getSize().x, 800.0f / (float)tempTex2.getSize().y });
+
+            // Calculate alpha blending (mix) factor for the cross-fade
+            float mix = (progress - 0.45f) * 10.0f; // Maps 0.45-0.55 range to 0.0-1.0
+
+            sA.setColor(FadeColor((std::uint8_t)(255 * (1.0f - mix))));
+            sB.setColor(FadeColor((std::uint8_t)(255 * mix)));
+
+            target.draw(sA, states);
+            target.draw(sB, states);
+        }
+        return;
+    }
+    break;
+    case 12: // Cube Rotate
+    {
+        float cx = width / 2.f, cy = height / 2.f, fov = 800.f;
+        const int STRIPS = 96;
+        float angle = progress * 1.5707963f;
+
+        sf::Vector2f scale1 = s1.getScale(), scale2 = s2.getScale();
+        float faceW = t1.getSize().x * scale1.x;
+        float faceH = t1.getSize().y * scale1.y;
+        float cubeDepth = t2.getSize().x * scale2.x;
+        float halfD = cubeDepth / 2.0f;
+
+        auto transformPoint = [&](sf::Vector3f p) -> sf::Vector3f {
+            float pz = p.z - halfD, px = p.x;
+            float c = deterministicRendering ? DetCos(angle) : std::cos(angle);
+            float s = deterministicRendering ? DetSin(angle) : std::sin(angle);
+            return { px * c + pz * s, p.y, -px * s + pz * c + halfD };
+        };
+        auto project = [&](sf::Vector3f p) -> sf::Vector2f {
+            float scale = fov / (fov + p.z);
+            return { cx + p.x * scale, cy + p.y * scale };
+        };
+        auto getShade = [&](float baseAngle) -> sf::Color {
+            float currentAngle = std::abs(baseAngle - std::abs(progress * 90.0f));
+            float rad = currentAngle * 0.017453f;
+            float light = deterministicRendering ? DetCos(rad) : std::cos(rad);
+            if (light < 0) light = 0;
+            float brightness = 0.6f + (light * 0.4f);
+            std::uint8_t val = static_cast<std::uint8_t>(255 * brightness);
+            return sf::Color(val, val, val);
+        };
+
+        sf::Color shade1 = getShade(0.0f), shade2 = getShade(90.0f);
+
+        auto drawStripMesh = [&](sf::Texture& tex, sf::Color col, bool isSideFace) {
+            sf::VertexArray va(sf::PrimitiveType::TriangleStrip, (STRIPS + 1) * 2);
+            float localW = faceW, localH = faceH;
+            float startX = -localW / 2.0f, yTop = -localH / 2.0f, yBot = localH / 2.0f;
+            for (int i = 0; i <= STRIPS; ++i) {
+                float u = (float)i / STRIPS;
+                sf::Vector3f pTop, pBot;
+                if (!isSideFace) {
+                    float x = startX + (u * localW);
+                    pTop = { x, yTop, 0.0f }; pBot = { x, yBot, 0.0f };
+                } else {
+                    float z = u * cubeDepth; float fixedX = localW / 2.0f;
+                    pTop = { fixedX, yTop, z }; pBot = { fixedX, yBot, z };
+                }
+                pTop = transformPoint(pTop); pBot = transformPoint(pBot);
+                sf::Vector2f sTop = project(pTop), sBot = project(pBot);
+                float tx = u * tex.getSize().x, tyTop = 0.0f, tyBot = (float)tex.getSize().y;
+                int idx = i * 2;
+                va[idx].position = sTop; va[idx].texCoords = { tx, tyTop }; va[idx].color = col;
+                va[idx + 1].position = sBot; va[idx + 1].texCoords = { tx, tyBot }; va[idx + 1].color = col;
+            }
+            sf::RenderStates rs = InputStates(&tex);
+            target.draw(va, rs);
+        };
+
+        target.clear(ClearColor());
+        sf::Vector3f tf = transformPoint({ 0.f, 0.f, 0.f });
+        sf::Vector3f ts = transformPoint({ faceW / 2.f, 0.f, cubeDepth / 2.f });
+        if (tf.z > ts.z) { drawStripMesh(t1, shade1, false); drawStripMesh(t2, shade2, true); }
+        else { drawStripMesh(t2, shade2, true); drawStripMesh(t1, shade1, false); }
+        return;
+    }
+    case 13: // Ring
+    {
+        float cx = width / 2.f, cy = height / 2.f;
+        float radius = 1000.f, depth = 670.f;
+        float a1 = progress * 1.5707963f, a2 = (1.0f - progress) * 1.5707963f;
+        auto ringPos = [&](float angle, float sideSign) {
+            float c = deterministicRendering ? DetCos(angle) : std::cos(angle);
+            float x = sideSign * (radius - c * radius);
+            float z = (deterministicRendering ? DetSin(angle) : std::sin(angle)) * radius;
+            float s = depth / (depth + z);
+            return std::tuple<float, float, float>(x, z, s);
+        };
+
+        auto [x1, z1, sC1] = ringPos(a1, +1.f);
+        sf::VertexArray quad1(sf::PrimitiveType::Triangles, 6);
+        float w1 = width * sC1, h1 = height * sC1;
+        float left1 = cx + x1 - w1 / 2.f, top1 = cy - h1 / 2.f;
+        float right1 = left1 + w1, bottom1 = top1 + h1;
+        quad1[0].position = { left1, top1 }; quad1[1].position = { right1, top1 }; quad1[2].position = { right1, bottom1 };
+        quad1[3].position = { left1, top1 }; quad1[4].position = { right1, bottom1 }; quad1[5].position = { left1, bottom1 };
+        quad1[0].texCoords = { 0.f, 0.f }; quad1[1].texCoords = { (float)t1.getSize().x, 0.f }; quad1[2].texCoords = { (float)t1.getSize().x, (float)t1.getSize().y };
+        quad1[3].texCoords = { 0.f, 0.f }; quad1[4].texCoords = { (float)t1.getSize().x, (float)t1.getSize().y }; quad1[5].texCoords = { 0.f, (float)t1.getSize().y };
+
+        auto [x2, z2, sC2] = ringPos(a2, -1.f);
+        sf::VertexArray quad2(sf::PrimitiveType::Triangles, 6);
+        float w2 = width * sC2, h2 = height * sC2;
+        float left2 = cx + x2 - w2 / 2.f, top2 = cy - h2 / 2.f;
+        float right2 = left2 + w2, bottom2 = top2 + h2;
+        quad2[0].position = { left2, top2 }; quad2[1].position = { right2, top2 }; quad2[2].position = { right2, bottom2 };
+        quad2[3].position = { left2, top2 }; quad2[4].position = { right2, bottom2 }; quad2[5].position = { left2, bottom2 };
+        quad2[0].texCoords = { 0.f, 0.f }; quad2[1].texCoords = { (float)t2.getSize().x, 0.f }; quad2[2].texCoords = { (float)t2.getSize().x, (float)t2.getSize().y };
+        quad2[3].texCoords = { 0.f, 0.f }; quad2[4].texCoords = { (float)t2.getSize().x, (float)t2.getSize().y }; quad2[5].texCoords = { 0.f, (float)t2.getSize().y };
+
+        target.clear(ClearColor());
+        sf::RenderStates rs1 = InputStates(&t1);
+        sf::RenderStates rs2 = InputStates(&t2);
+        if (z1 > z2) { target.draw(quad1, rs1); target.draw(quad2, rs2); }
+        else { target.draw(quad2, rs2); target.draw(quad1, rs1); }
+        return;
+    }
+    case 14: // Luma Wipe transition
+    {
+        sf::Texture& resultTex = scratch.wipeTex;
+        if (t1.getSize().x == 0 || t2.getSize().x == 0) return;
+
+        // 1. Create working copies (non-const) from textures
+        sf::Image workingImg1 = imgCache1;
+        sf::Image workingImg2 = imgCache2;
+
+        sf::Vector2u size1 = workingImg1.getSize();
+        sf::Vector2u size2 = workingImg2.getSize();
+        const std::vector<uint8_t>* mask = &luma2;
+
+        // 2. Logic: If sizes differ, resize both (and the mask) to the smallest common dimensions
+        if (size1 != size2) {
+            unsigned int minW = std::min(size1.x, size2.x);
+            unsigned int minH = std::min(size1.y, size2.y);
+
+            workingImg1 = ResizeImageCPU(workingImg1, minW, minH);
+            workingImg2 = ResizeImageCPU(workingImg2, minW, minH);
+            ResizePlaneCPU(luma2, size2, { minW, minH }, scratch.wipeMask);
+            mask = &scratch.wipeMask;
+        }
+
+        // 3. Process the transition on CPU (no shaders used as per )
+        ApplyCpuLumaWipeOptimized(workingImg1, workingImg2, *mask, resultTex, progress, scratch);
+
+        // 4. Final display
+        sf::Sprite s(resultTex);
+        // Stretch the result to fill our standard 1200x800 canvas [cite: 11]
+        s.setScale({ 1200.0f / resultTex.getSize().x, 800.0f / resultTex.getSize().y });
+
+        target.draw(s, states);
+        return;
+    }
+    break;
+    case 15: // Fly Away
+    {
+        sf::Vector2u sz1 = t1.getSize(); sf::Vector2u sz2 = t2.getSize();
+        sf::Vector2f center(width / 2.f, height / 2.f);
+        if (progress <= 0.5f) {
+            float lp = progress * 2.0f, invLp = 1.0f - lp;
+            s1.setOrigin({ (float)sz1.x / 2.f, (float)sz1.y / 2.f });
+            s1.setPosition(center);
+            s1.setScale({ (width / sz1.x) * invLp, (height / sz1.y) * invLp });
+            s1.setRotation(sf::degrees(lp * 180.0f));
+            s1.setColor(FadeColor((std::uint8_t)(255 * invLp)));
+            target.clear(ClearColor()); target.draw(s1, states);
+        } else {
+            float lp = (progress - 0.5f) * 2.0f;
+            s2.setOrigin({ (float)sz2.x / 2.f, (float)sz2.y / 2.f });
+            s2.setPosition(center);
+            s2.setScale({ (width / sz2.x) * lp, (height / sz2.y) * lp });
+            s2.setRotation(sf::degrees((1.0f - lp) * -180.0f));
+            s2.setColor(FadeColor((std::uint8_t)(255 * lp)));
+            target.clear(ClearColor()); target.draw(s2, states);
+        }
+        return;
+    }
+    case EXPRESSION_TRANSITION: // Custom Expression
+    {
+        if (!expression || t1.getSize().x == 0 || t2.getSize().x == 0) return;
+
+        // The script samples both inputs itself, so it is evaluated at canvas resolution
+        sf::Vector2u canvas(CANVAS_WIDTH, CANVAS_HEIGHT);
+        scratch.exprPixels.resize(static_cast<size_t>(canvas.x) * canvas.y * 4);
+        expression->Render(imgCache1, imgCache2, progress, canvas.x, canvas.y, scratch.exprPixels.data());
+
+        if (scratch.exprTex.getSize() != canvas) {
+            if (!scratch.exprTex.resize(canvas)) return;
+        }
+        scratch.exprTex.update(scratch.exprPixels.data());
+        target.draw(sf::Sprite(scratch.exprTex), states);
+        return;
+    }
+    }
+
+    if (type == 5 || type == 10) { target.draw(s2, states); target.draw(s1, states); }
+    else if (drawMode == 1) target.draw(s1, states);
+    else if (drawMode == 2) target.draw(s2, states);
+    else { target.draw(s1, states); target.draw(s2, states); }
+}
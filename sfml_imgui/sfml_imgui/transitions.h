@@ -0,0 +1,79 @@
+#ifndef TRANSITIONS_H
+#define TRANSITIONS_H
+
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "pixel_buffer.h"
+
+// Logical canvas every transition is laid out on (also the export resolution)
+const unsigned int CANVAS_WIDTH = 1200;
+const unsigned int CANVAS_HEIGHT = 800;
+
+// Transition index of the user-scripted transition (see pixel_expr.h); it is only valid
+// when a compiled program is passed to RenderTransitionFrame
+const int EXPRESSION_TRANSITION = 16;
+const int TRANSITION_COUNT = 17;
+
+// Display names, indexed by transition type
+extern const char* const TRANSITION_NAMES[TRANSITION_COUNT];
+
+class PixelProgram;
+
+// Render switches are per thread so headless workers can run jobs with different
+// settings side by side; the GUI only ever touches them from the main thread.
+
+// Alpha-preserving mode: inputs are premultiplied once when prepared, every draw and
+// CPU kernel blends premultiplied data and frames start from a transparent background
+extern thread_local bool premultipliedPipeline;
+
+// Quantize high-precision intermediates (blur sums, supersampled averages) with blue noise
+extern thread_local bool blueNoiseDither;
+
+// Bit-exact frames: the CPU-side math takes the portable det_math.h functions instead of
+// libm, so every thread count and instruction set produces the same bytes
+extern thread_local bool deterministicRendering;
+
+// Reusable buffers for the CPU kernels. Only allocations live here, never anything that
+// carries over from one frame to the next, so any renderer (or worker process) produces
+// the same pixels for the same frame no matter what it rendered before.
+struct RenderScratch {
+    sf::Texture blurTex1, blurTex2, wipeTex, exprTex;
+    PixelBuffer smallPixels, blurPixels, wipePixels;
+    std::vector<std::uint8_t> wipeMask;
+    PixelBuffer exprPixels;           // Written by row bands on the ParallelFor workers
+    std::vector<std::uint16_t> wideRow;
+};
+
+// --- ALPHA PIPELINE HELPERS ---
+sf::Color ClearColor();
+sf::Color FadeColor(std::uint8_t alpha);
+sf::RenderStates InputStates(const sf::Texture* texture = nullptr);
+
+// --- CPU KERNELS ---
+sf::Image ResizeImageCPU(const sf::Image& original, unsigned int targetW, unsigned int targetH);
+// Luminance plane of an image; computed once per prepared input and used as the Luma Wipe mask
+std::vector<std::uint8_t> ComputeLumaPlane(const sf::Image& image);
+// Mask threshold of the Luma Wipe at 'progress'; drops below 0 before the end so every pixel has switched
+int LumaWipeThreshold(float progress);
+// 'lumaB' must have one entry per pixel of imgB
+void ApplyCpuLumaWipeOptimized(const sf::Image& imgA, const sf::Image& imgB, const std::vector<std::uint8_t>& lumaB,
+    sf::Texture& dstTex, float progress, RenderScratch& scratch);
+void ApplyCpuBlurOptimized(const sf::Image& src, sf::Texture& dstTex, int radius, RenderScratch& scratch);
+
+// Transitions that work on CPU-side pixels instead of sprites
+bool UsesCpuImages(int type);
+
+// --- CORE RENDERING LOGIC ---
+// Draws one frame of transition 'type' at 'progress' (0..1) onto the canvas of 'target'.
+// The result depends only on the arguments: sprites and texture flags are reset on entry
+// and the CPU kernels work in 'scratch', so frames can be rendered in any order.
+// 'luma2' is the luminance plane of imgCache2 (PreparedInput::luma).
+// 'expression' is the compiled script for EXPRESSION_TRANSITION and ignored otherwise.
+void RenderTransitionFrame(sf::RenderTarget& target, int type, float progress,
+    sf::Sprite& s1, sf::Sprite& s2, sf::Texture& t1, sf::Texture& t2,
+    const sf::Image& imgCache1, const sf::Image& imgCache2,
+    const std::vector<std::uint8_t>& luma2, RenderScratch& scratch,
+    const PixelProgram* expression = nullptr);
+
+#endif //TRANSITIONS_H
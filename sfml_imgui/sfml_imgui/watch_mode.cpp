@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "watch_mode.h"
+#include "directory_watcher.h"
+#include "render_job.h"
+#include "slideshow.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    const char* MANIFEST_SUFFIX = ".job.json";
+    const char* PAIR_OUTPUT = "out";
+
+    std::mutex outputMutex;
+
+    void Emit(const std::string& line)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << line << std::endl;
+    }
+
+    std::string Normalize(const fs::path& path)
+    {
+        std::error_code ec;
+        fs::path p = fs::weakly_canonical(path, ec);
+        return (ec ? path : p).lexically_normal().string();
+    }
+
+    bool IsManifest(const fs::path& path)
+    {
+        std::string name = path.filename().string();
+        size_t n = std::char_traits<char>::length(MANIFEST_SUFFIX);
+        return name.size() > n && name.compare(name.size() - n, n, MANIFEST_SUFFIX) == 0;
+    }
+
+    bool IsImage(const fs::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+    }
+
+    // First image in 'dir' whose stem is 'stem' ("a" or "b")
+    fs::path FindPairImage(const fs::path& dir, const std::string& stem)
+    {
+        std::error_code ec, entryError;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+            if (it->is_regular_file(entryError) && it->path().stem() == stem && IsImage(it->path())) return it->path();
+        return {};
+    }
+
+    // --- RENDER WORKERS ---
+    // One thread per worker with its own queue and InputCache. A job that changes again
+    // while still queued is replaced, not queued twice.
+    class RenderWorker {
+    public:
+        RenderWorker() : thread([this] { Loop(); }) {}
+
+        ~RenderWorker()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+        }
+
+        void Enqueue(const std::string& key, const RenderJob& job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto queued = std::find_if(queue.begin(), queue.end(), [&](const auto& q) { return q.first == key; });
+                if (queued != queue.end()) queued->second = job;
+                else queue.emplace_back(key, job);
+            }
+            wake.notify_all();
+        }
+
+    private:
+        void Loop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                wake.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                RenderJob job = std::move(queue.front().second);
+                queue.pop_front();
+                lock.unlock();
+
+                auto start = Clock::now();
+                std::string error;
+                int written = ExecuteRenderJob(job, cache, nullptr, error);
+                if (!error.empty()) {
+                    Emit(JsonWriter().Add("event", "error").Add("id", job.id).Add("message", error).str());
+                }
+                else {
+                    InputCache::Stats st = cache.GetStats();
+                    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                    Emit(JsonWriter().Add("event", "done").Add("id", job.id).Add("frames", written).Add("ms", ms)
+                        .Add("cacheHits", static_cast<long long>(st.hits))
+                        .Add("cacheMisses", static_cast<long long>(st.misses)).str());
+                }
+                lock.lock();
+            }
+        }
+
+        InputCache cache;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::pair<std::string, RenderJob>> queue;
+        bool stopping = false;
+        std::thread thread;   // Last member: starts once everything above is constructed
+    };
+
+    // --- SCHEDULER (watch thread only) ---
+    struct WatchedJob {
+        bool isManifest = false;
+        fs::path source;                          // Manifest file, or the pair's folder
+        Clock::time_point changedAt;
+        bool dirty = false;
+        std::string reason;
+        std::map<std::string, std::uintmax_t> sizes;   // Snapshot for the stability check
+        std::vector<std::string> inputs;          // Normalized paths the last render read
+        std::string output;
+    };
+
+    class WatchScheduler {
+    public:
+        WatchScheduler(const RenderJob& pairTemplate, int workerCount)
+            : pairTemplate(pairTemplate)
+        {
+            for (int i = 0; i < workerCount; ++i) workers.push_back(std::make_unique<RenderWorker>());
+        }
+
+        void OnChange(const fs::path& path)
+        {
+            std::string key = Normalize(path);
+            if (IsInsideOutput(key)) return;
+
+            if (IsManifest(path)) MarkDirty(key, true, path, key);
+            else if (IsImage(path) && (path.stem() == "a" || path.stem() == "b"))
+                MarkDirty(Normalize(path.parent_path()), false, path.parent_path(), key);
+
+            // Manifests may point at images anywhere
+            auto deps = dependents.find(key);
+            if (deps != dependents.end())
+                for (const std::string& jobKey : deps->second) {
+                    WatchedJob& job = jobs[jobKey];
+                    MarkDirty(jobKey, job.isManifest, job.source, key);
+                }
+        }
+
+        // Hands every job whose files have settled to its worker
+        void DispatchSettled()
+        {
+            auto now = Clock::now();
+            for (auto it = jobs.begin(); it != jobs.end();) {
+                WatchedJob& watched = it->second;
+                if (!watched.dirty || now - watched.changedAt < std::chrono::milliseconds(WATCH_DEBOUNCE_MS)) {
+                    ++it;
+                    continue;
+                }
+
+                RenderJob job;
+                std::string error;
+                bool complete = BuildJob(it->first, watched, job, error);
+                if (!complete && error.empty()) {
+                    // Pair with one image missing (or removed): nothing to render yet
+                    watched.dirty = false;
+                    ++it;
+                    continue;
+                }
+
+                // A file still growing means a copy is in progress: wait another round
+                std::map<std::string, std::uintmax_t> sizes = SnapshotSizes(watched, job);
+                if (sizes != watched.sizes) {
+                    watched.sizes = sizes;
+                    watched.changedAt = now;
+                    ++it;
+                    continue;
+                }
+                watched.dirty = false;
+
+                if (!complete) {
+                    Emit(JsonWriter().Add("event", "error").Add("id", it->first).Add("message", error).str());
+                    ++it;
+                    continue;
+                }
+
+                // Editing a job's script or slideshow list re-renders it just like editing one of its images
+                std::vector<std::string> inputs;
+                for (const std::string& p : InputFiles(job)) inputs.push_back(Normalize(p));
+                UpdateDependents(it->first, watched, std::move(inputs));
+                watched.output = job.output.empty() ? std::string() : Normalize(job.output);
+                Emit(JsonWriter().Add("event", "queued").Add("id", job.id).Add("reason", watched.reason).str());
+                workers[std::hash<std::string>{}(it->first) % workers.size()]->Enqueue(it->first, job);
+                ++it;
+            }
+        }
+
+    private:
+        void MarkDirty(const std::string& key, bool isManifest, const fs::path& source, const std::string& reason)
+        {
+            WatchedJob& job = jobs[key];
+            job.isManifest = isManifest;
+            job.source = source;
+            job.dirty = true;
+            job.changedAt = Clock::now();
+            job.reason = reason;
+        }
+
+        bool IsInsideOutput(const std::string& path) const
+        {
+            for (const auto& [key, job] : jobs) {
+                if (job.output.empty()) continue;
+                if (path.compare(0, job.output.size(), job.output) == 0 &&
+                    (path.size() == job.output.size() || path[job.output.size()] == fs::path::preferred_separator))
+                    return true;
+            }
+            return false;
+        }
+
+        bool BuildJob(const std::string& key, const WatchedJob& watched, RenderJob& job, std::string& error)
+        {
+            if (!watched.isManifest) {
+                fs::path a = FindPairImage(watched.source, "a");
+                fs::path b = FindPairImage(watched.source, "b");
+                if (a.empty() || b.empty()) return false;
+                job = pairTemplate;
+                job.id = watched.source.filename().string();
+                job.image1 = a.string();
+                job.image2 = b.string();
+                job.output = (watched.source / PAIR_OUTPUT).string();
+                return true;
+            }
+
+            if (!fs::exists(watched.source)) return false;   // Manifest removed
+            std::string text;
+            JsonObject obj;
+            if (!ReadJobText(watched.source.string(), text) || !ParseFlatJson(text, obj)) {
+                error = "cannot parse " + key;
+                return false;
+            }
+            if (!ParseRenderJob(obj, job, error)) return false;
+
+            fs::path base = watched.source.parent_path();
+            auto resolve = [&](std::string& p) {
+                if (!p.empty() && fs::path(p).is_relative()) p = (base / p).string();
+            };
+            resolve(job.image1);
+            resolve(job.image2);
+            resolve(job.output);
+            resolve(job.settings.archive);
+            resolve(job.settings.mezzanine);
+            resolve(job.slideshow);
+            resolve(job.expression);
+            return true;
+        }
+
+        // Every file the job reads: images, slideshow list and the slides it names, expression
+        static std::vector<std::string> InputFiles(const RenderJob& job)
+        {
+            std::vector<std::string> files;
+            for (const std::string& p : { job.image1, job.image2, job.slideshow, job.expression })
+                if (!p.empty()) files.push_back(p);
+            std::vector<std::string> slides;
+            std::string error;
+            if (!job.slideshow.empty() && ReadSlideshowList(job.slideshow, slides, error))
+                files.insert(files.end(), slides.begin(), slides.end());
+            return files;
+        }
+
+        std::map<std::string, std::uintmax_t> SnapshotSizes(const WatchedJob& watched, const RenderJob& job) const
+        {
+            std::map<std::string, std::uintmax_t> sizes;
+            std::error_code ec;
+            std::vector<std::string> files = InputFiles(job);
+            files.push_back(watched.source.string());
+            for (const std::string& p : files) {
+                if (p.empty() || fs::is_directory(p, ec)) continue;
+                sizes[p] = fs::file_size(p, ec);
+                if (ec) sizes[p] = static_cast<std::uintmax_t>(-1);
+            }
+            return sizes;
+        }
+
+        void UpdateDependents(const std::string& key, WatchedJob& watched, std::vector<std::string> inputs)
+        {
+            for (const std::string& old : watched.inputs) dependents[old].erase(key);
+            for (const std::string& in : inputs) dependents[in].insert(key);
+            watched.inputs = std::move(inputs);
+        }
+
+        RenderJob pairTemplate;
+        std::map<std::string, WatchedJob> jobs;
+        std::unordered_map<std::string, std::set<std::string>> dependents;   // Input path -> job keys
+        std::vector<std::unique_ptr<RenderWorker>> workers;
+    };
+}
+
+int RunWatchMode(const std::string& root, const std::string& templateJob, int workerCount)
+{
+    // Pairs need settings; image and output fields of the template are ignored
+    JsonObject obj;
+    if (!templateJob.empty()) {
+        std::string text;
+        if (!ReadJobText(templateJob, text) || !ParseFlatJson(text, obj)) {
+            std::cerr << "Cannot read template job " << templateJob << std::endl;
+            return 1;
+        }
+    }
+    obj["image1"] = "a";
+    obj["image2"] = "b";
+    obj["output"] = PAIR_OUTPUT;
+    RenderJob pairTemplate;
+    std::string error;
+    if (!ParseRenderJob(obj, pairTemplate, error)) {
+        std::cerr << "Invalid template job: " << error << std::endl;
+        return 1;
+    }
+
+    DirectoryWatcher watcher;
+    if (!watcher.Start(root, error)) {
+        std::cerr << "Watch mode: " << error << std::endl;
+        return 1;
+    }
+    if (workerCount < 1) workerCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency() / 2));
+    WatchScheduler scheduler(pairTemplate, workerCount);
+
+    // Everything already in the tree counts as changed once; after that only events matter
+    std::error_code ec, entryError;
+    for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+        !ec && it != end; it.increment(ec))
+        if (it->is_regular_file(entryError)) scheduler.OnChange(it->path());
+    Emit(JsonWriter().Add("event", "watching").Add("root", root).Add("workers", workerCount).str());
+
+    std::vector<fs::path> changed;
+    for (;;) {
+        changed.clear();
+        if (!watcher.Poll(changed, 100)) {
+            std::cerr << "Watch mode: lost the watch on " << root << std::endl;
+            return 1;
+        }
+        for (const fs::path& path : changed) scheduler.OnChange(path);
+        scheduler.DispatchSettled();
+    }
+}
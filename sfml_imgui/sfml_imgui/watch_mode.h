@@ -0,0 +1,24 @@
+#ifndef WATCH_MODE_H
+#define WATCH_MODE_H
+
+#include <string>
+
+// --- WATCH-FOLDER MODE ---
+// Watches a directory tree and renders only what a change affects:
+//   *.job.json               a job manifest (render service format); relative image and
+//                            output paths are resolved against the manifest's folder
+//   a.<ext> + b.<ext>        an image pair in one folder, rendered with the template job
+//                            into <folder>/out
+// A job runs once its files have been quiet for WATCH_DEBOUNCE_MS and their sizes stopped
+// changing, so half-copied files are never picked up. Jobs stick to one worker thread
+// (by key), and every worker keeps its own InputCache, so re-rendering a pair after one
+// image changed only decodes the changed image again.
+// Events are printed as JSON lines: queued, done, error.
+
+const int WATCH_DEBOUNCE_MS = 750;
+
+// 'templateJob' (file, inline JSON or empty) supplies the settings for image pairs.
+// Runs until the watch fails. Returns the process exit code.
+int RunWatchMode(const std::string& root, const std::string& templateJob, int workers);
+
+#endif //WATCH_MODE_H
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "worker_pool.h"
+#include "numa.h"
+#include <algorithm>
+
+namespace {
+    thread_local const WorkerPool* currentPool = nullptr;
+
+    // Node index (into NumaTopology) of CPU slot 'slot' when CPUs are listed node by node
+    int NodeOfSlot(unsigned int slot)
+    {
+        const std::vector<NumaNode>& nodes = NumaTopology();
+        size_t cpus = 0;
+        for (const NumaNode& node : nodes) cpus += node.cpus.size();
+        slot %= static_cast<unsigned int>(cpus);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (slot < nodes[i].cpus.size()) return static_cast<int>(i);
+            slot -= static_cast<unsigned int>(nodes[i].cpus.size());
+        }
+        return 0;
+    }
+}
+
+WorkerPool::WorkerPool(unsigned int count, bool spreadOverNodes)
+{
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+    bool spread = spreadOverNodes && NumaNodeCount() > 1;
+    for (unsigned int i = 0; i < count; ++i) workers.push_back(std::make_unique<Worker>());
+    // Slot 0 is left to the thread that posts, which runs the first ParallelFor chunk itself
+    for (unsigned int i = 0; i < count; ++i) {
+        int node = spread ? NodeOfSlot(i + 1) : -1;
+        workers[i]->thread = std::thread([this, i, node] { Run(i, node); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto& worker : workers) worker->wake.notify_one();
+    }
+    for (auto& worker : workers) worker->thread.join();
+}
+
+void WorkerPool::WakeLocked(unsigned int index)
+{
+    Worker& worker = *workers[index];
+    if (!worker.waiting) return;
+    worker.waiting = false;
+    idle.erase(std::find(idle.begin(), idle.end(), index));
+    worker.wake.notify_one();
+}
+
+void WorkerPool::Post(std::function<void()> work)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    shared.push_back(std::move(work));
+    // Busy workers look at the shared queue when they finish, so waking one idle worker is enough
+    if (!idle.empty()) WakeLocked(idle.back());
+}
+
+void WorkerPool::PostTo(unsigned int index, std::function<void()> work)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    index %= ThreadCount();
+    workers[index]->queue.push_back(std::move(work));
+    WakeLocked(index);
+}
+
+bool WorkerPool::IsWorkerThread() const
+{
+    return currentPool == this;
+}
+
+void WorkerPool::Run(unsigned int index, int node)
+{
+    currentPool = this;
+    if (node >= 0) BindThreadToNode(static_cast<unsigned int>(node));
+    Worker& self = *workers[index];
+
+    for (;;) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping && self.queue.empty() && shared.empty()) {
+                self.waiting = true;
+                idle.push_back(index);
+                self.wake.wait(lock, [&] { return !self.waiting || stopping; });
+            }
+            // Queued work still runs on shutdown so no awaiting coroutine is left suspended
+            std::deque<std::function<void()>>& from = !self.queue.empty() ? self.queue : shared;
+            if (from.empty()) return;
+            work = std::move(from.front());
+            from.pop_front();
+        }
+        work();
+    }
+}
+
+WorkerPool& SharedWorkerPool()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+void TaskQueue::Post(std::function<void()> work)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(work));
+}
+
+size_t TaskQueue::RunPending()
+{
+    std::vector<std::function<void()>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(pending);
+    }
+    // Work posted while this batch runs waits for the next call
+    for (auto& work : batch) work();
+    return batch.size();
+}
@@ -0,0 +1,68 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running posted work. Used as the executor for async tasks
+// (async_task.h) and, as a separate NUMA-spread instance, for the chunks of ParallelFor.
+class WorkerPool {
+public:
+    // 0 threads: one per hardware thread. With 'spreadOverNodes' the workers are bound to
+    // NUMA nodes in blocks, in proportion to each node's CPUs (see numa.h).
+    explicit WorkerPool(unsigned int threads = 0, bool spreadOverNodes = false);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Runs 'work' on the next free worker, in FIFO order
+    void Post(std::function<void()> work);
+    // Runs 'work' on worker 'index' (modulo ThreadCount()). A caller that always hands the
+    // same part of a buffer to the same worker keeps that part on the worker's node.
+    void PostTo(unsigned int index, std::function<void()> work);
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+    // True when called from one of this pool's threads
+    bool IsWorkerThread() const;
+
+private:
+    struct Worker {
+        std::deque<std::function<void()>> queue;   // Work posted to this worker only
+        std::condition_variable wake;
+        bool waiting = false;
+        std::thread thread;
+    };
+
+    void Run(unsigned int index, int node);
+    void WakeLocked(unsigned int index);
+
+    std::mutex mutex;
+    std::deque<std::function<void()>> shared;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<unsigned int> idle;   // Waiting workers, most recent last
+    bool stopping = false;
+};
+
+// Pool shared by the GUI and all headless jobs of the process
+WorkerPool& SharedWorkerPool();
+
+// Work posted from any thread and run by one owner thread when it calls RunPending,
+// e.g. texture uploads that have to happen on the GUI thread between two frames
+class TaskQueue {
+public:
+    void Post(std::function<void()> work);
+    // Runs everything posted so far; returns the number of items run
+    size_t RunPending();
+
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> pending;
+};
+
+#endif //WORKER_POOL_H